@@ -0,0 +1,300 @@
+#include "DS2484.h"
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+//
+// For DS2484 programming, see:
+// https://datasheets.maximintegrated.com/en/ds/DS2484.pdf
+// https://www.maximintegrated.com/en/design/technical-documents/app-notes/3/3684.html (DS2482, same commands)
+//
+DS2484::DS2484(TwoWire &wire, uint8_t address) : wire(wire), address(address) {}
+
+bool DS2484::begin() {
+  uint8_t statusRegister;
+
+  readPointer = DS2484_STATUS_REGISTER;
+  if (!command(DS2484_DEVICE_RESET) || !readRegister(DS2484_STATUS_REGISTER, statusRegister)) return false;
+  // the device reset clears the configuration and sets RST.
+  if (!(statusRegister & DS2484_STATUS_RST)) return false;
+
+  speed = SPEED_STANDARD;
+  return writeConfig(DS2484_CONFIG_APU);
+}
+
+uint32_t DS2484::getLinkSpeed() const {
+  return wire.getClock();
+}
+
+bool DS2484::command(uint8_t cmd) {
+  wire.beginTransmission(address);
+  wire.write(cmd);
+  stats.bytesSent++;
+  // the function commands leave the read pointer at the status register.
+  readPointer = DS2484_STATUS_REGISTER;
+  return wire.endTransmission() == 0;
+}
+
+bool DS2484::command(uint8_t cmd, uint8_t param) {
+  wire.beginTransmission(address);
+  wire.write(cmd);
+  wire.write(param);
+  stats.bytesSent += 2;
+  readPointer = cmd == DS2484_SET_READ_POINTER ? param : cmd == DS2484_WRITE_CONFIG ? DS2484_CONFIG_REGISTER : DS2484_STATUS_REGISTER;
+  return wire.endTransmission() == 0;
+}
+
+bool DS2484::readRegister(uint8_t pointer, uint8_t &value) {
+  if (readPointer != pointer && !command(DS2484_SET_READ_POINTER, pointer)) return false;
+  if (wire.requestFrom(address, (uint8_t)1) != 1) return false;
+
+  stats.bytesReceived++;
+  value = wire.read();
+  return true;
+}
+
+bool DS2484::writeConfig(uint8_t newConfig) {
+  uint8_t readBack;
+
+  // the upper nibble is the complement of the lower, the DS2484 reads back only the lower.
+  if (!command(DS2484_WRITE_CONFIG, (~newConfig << 4) | (newConfig & 0x0F)) ||
+      !readRegister(DS2484_CONFIG_REGISTER, readBack) || readBack != (newConfig & 0x0F)) {
+    status = ONEWIRE_TIMEOUT;
+    return false;
+  }
+
+  // the DS2484 clears SPU by itself when the strong pullup ends.
+  config = newConfig & ~DS2484_CONFIG_SPU;
+  return true;
+}
+
+//
+// Poll the status register until the 1-Wire busy bit is cleared, the CPU is given away
+// while the command can't be done yet, the same way as DS2480B::waitForReply().
+//
+bool DS2484::waitUntilIdle(uint32_t expected, uint8_t &statusRegister) {
+  stats.roundTrips++;
+  int64_t started = esp_timer_get_time();
+  int64_t done = started + expected;
+  int64_t deadline = done + DS2484_TIMEOUT_MARGIN_US;
+
+  for (;;) {
+    int64_t now = esp_timer_get_time();
+
+    // no point in polling before the command can be done.
+    if (now < done) {
+      if (done - now >= portTICK_PERIOD_MS * 1000) {
+        vTaskDelay(1);
+      } else {
+        taskYIELD();
+      }
+      continue;
+    }
+
+    if (!readRegister(DS2484_STATUS_REGISTER, statusRegister)) {
+      status = ONEWIRE_TIMEOUT;
+      return false;
+    }
+    if (!(statusRegister & DS2484_STATUS_1WB)) break;
+
+    if (esp_timer_get_time() >= deadline) {
+      status = ONEWIRE_TIMEOUT;
+      return false;
+    }
+    taskYIELD();
+  }
+
+  status = ONEWIRE_OK;
+  return true;
+}
+
+//
+// Perform the onewire reset function, always at standard speed.
+// Returns 1 if a device asserted a presence pulse, 0 otherwise.
+// getStatus() tells if the bus was shorted, nothing answered or the DS2484 didn't reply.
+//
+uint8_t DS2484::reset() {
+  uint8_t statusRegister;
+
+  setSpeed(SPEED_STANDARD);
+  if (!command(DS2484_ONEWIRE_RESET)) {
+    status = ONEWIRE_TIMEOUT;
+    return 0;
+  }
+  if (!waitUntilIdle(DS2484_RESET_US, statusRegister)) return 0;
+
+  if (statusRegister & DS2484_STATUS_SD) {
+    status = ONEWIRE_SHORTED;
+    return 0;
+  }
+  if (!(statusRegister & DS2484_STATUS_PPD)) {
+    status = ONEWIRE_NO_PRESENCE;
+    return 0;
+  }
+  return 1;
+}
+
+void DS2484::setSpeed(uint8_t newSpeed) {
+  if (speed != newSpeed) {
+    // 1WS selects the speed of the following 1-Wire commands, there is no bus activity.
+    if (writeConfig(newSpeed == SPEED_OVERDRIVE ? config | DS2484_CONFIG_1WS : config & ~DS2484_CONFIG_1WS)) {
+      speed = newSpeed;
+    }
+  }
+}
+
+//
+// Write a byte.
+//
+void DS2484::write(uint8_t v) {
+  uint8_t statusRegister;
+
+  if (!command(DS2484_ONEWIRE_WRITE_BYTE, v)) {
+    status = ONEWIRE_TIMEOUT;
+    return;
+  }
+  waitUntilIdle(8 * slotTime(), statusRegister);
+}
+
+//
+// Read a byte, the result is fetched from the data register.
+//
+uint8_t DS2484::read() {
+  uint8_t statusRegister, value;
+
+  if (!command(DS2484_ONEWIRE_READ_BYTE)) {
+    status = ONEWIRE_TIMEOUT;
+    return 0;
+  }
+  if (!waitUntilIdle(8 * slotTime(), statusRegister)) return 0;
+
+  if (!readRegister(DS2484_DATA_REGISTER, value)) {
+    status = ONEWIRE_SHORT_READ;
+    return 0;
+  }
+  return value;
+}
+
+//
+// Block transfer, one write or read byte command per byte. A written byte reads back as
+// itself, the same as the DS2480B echo when no device pulls the bus low.
+// The verifier sees each byte as it is read, the transfer stops at the first failure.
+//
+bool DS2484::block(uint8_t *buf, uint16_t count, BlockVerifier *verifier) {
+  for (uint16_t i = 0; i < count; i++) {
+    if (buf[i] == 0xFF) {
+      buf[i] = read();
+    } else {
+      write(buf[i]);
+    }
+    if (status != ONEWIRE_OK) return false;
+
+    if (verifier != nullptr && !verifier->received(buf[i])) {
+      status = ONEWIRE_CRC_ERROR;
+      return false;
+    }
+  }
+  return true;
+}
+
+//
+// Write a bit - actually returns the bit read back in case you care.
+//
+uint8_t DS2484::write_bit(uint8_t v) {
+  uint8_t statusRegister;
+
+  if (!command(DS2484_ONEWIRE_SINGLE_BIT, v ? 0x80 : 0x00)) {
+    status = ONEWIRE_TIMEOUT;
+    return 0;
+  }
+  if (!waitUntilIdle(slotTime(), statusRegister)) return 0;
+
+  return (statusRegister & DS2484_STATUS_SBR) ? 1 : 0;
+}
+
+//
+// SPU has to be set right before the command that needs the extra power, the strong pullup
+// then starts when the byte is written and lasts until the next 1-Wire command or until
+// the configuration is written again.
+//
+bool DS2484::writeStrongPullup(uint8_t v) {
+  if (!writeConfig(config | DS2484_CONFIG_SPU)) return false;
+
+  write(v);
+  return status == ONEWIRE_OK;
+}
+
+void DS2484::endStrongPullup() {
+  writeConfig(config & ~DS2484_CONFIG_SPU);
+}
+
+bool DS2484::triplet(bool direction, uint8_t &statusRegister) {
+  if (!command(DS2484_ONEWIRE_TRIPLET, direction ? 0x80 : 0x00)) {
+    status = ONEWIRE_TIMEOUT;
+    return false;
+  }
+  return waitUntilIdle(3 * slotTime(), statusRegister);
+}
+
+//
+// Perform a search using the 1-Wire triplet command, the DS2484 reads the id bit and its
+// complement and writes the direction in one command. The direction is only used at a
+// discrepancy, DIR tells which way was taken. Same search state and result as search_bitwise(),
+// see AN3684 "How to Use the DS2482 I2C 1-Wire Master".
+//
+bool DS2484::search(uint8_t *newAddr, bool search_mode) {
+  bool search_result = false;
+
+  // if the last call was not the last one
+  if (!LastDeviceFlag && reset()) {
+    uint8_t last_zero = 0;
+    uint8_t last_family_zero = 0;
+    uint8_t id_bit_number = 1;
+
+    // issue the search command
+    write(search_mode ? SEARCH_ROM : ALARM_SEARCH);
+
+    for (; id_bit_number <= 64 && status == ONEWIRE_OK; id_bit_number++) {
+      uint8_t i = id_bit_number - 1;
+      uint8_t statusRegister;
+      bool direction;
+
+      // same path as the previous search up to LastDiscrepancy, then take the 1 branch there.
+      if (id_bit_number < LastDiscrepancy)
+        direction = ROM_NO[i / 8] & (1 << (i % 8));
+      else
+        direction = id_bit_number == LastDiscrepancy;
+
+      if (!triplet(direction, statusRegister)) break;
+
+      bool id_bit = statusRegister & DS2484_STATUS_SBR;
+      bool cmp_id_bit = statusRegister & DS2484_STATUS_TSB;
+      direction = statusRegister & DS2484_STATUS_DIR;
+
+      // check for no devices on 1-wire
+      if (id_bit && cmp_id_bit) break;
+
+      // record the last discrepancy where the 0 branch was taken, that's where the next search continues.
+      if (!id_bit && !cmp_id_bit && !direction) {
+        last_zero = id_bit_number;
+        if (last_zero < 9) last_family_zero = last_zero;
+      }
+
+      if (direction)
+        ROM_NO[i / 8] |= 1 << (i % 8);
+      else
+        ROM_NO[i / 8] &= ~(1 << (i % 8));
+    }
+
+    if (id_bit_number > 64 && crc8(ROM_NO, 7) == ROM_NO[7]) {
+      LastDiscrepancy = last_zero;
+      LastFamilyDiscrepancy = last_family_zero;
+
+      // check for last device
+      if (LastDiscrepancy == 0) LastDeviceFlag = true;
+
+      search_result = true;
+    }
+  }
+
+  return finishSearch(search_result, newAddr);
+}
@@ -0,0 +1,105 @@
+#ifndef DS2484_h
+#define DS2484_h
+
+#include <OneWireMaster.h>
+#include <Wire.h>
+
+// 7-bit I2C address of the DS2484.
+#define DS2484_ADDRESS 0x18
+
+// DS2484 function commands
+#define DS2484_DEVICE_RESET 0xF0
+#define DS2484_SET_READ_POINTER 0xE1
+#define DS2484_WRITE_CONFIG 0xD2
+#define DS2484_ADJUST_PORT 0xC3
+#define DS2484_ONEWIRE_RESET 0xB4
+#define DS2484_ONEWIRE_SINGLE_BIT 0x87
+#define DS2484_ONEWIRE_WRITE_BYTE 0xA5
+#define DS2484_ONEWIRE_READ_BYTE 0x96
+#define DS2484_ONEWIRE_TRIPLET 0x78
+
+// Read pointer codes of the DS2484 registers.
+#define DS2484_STATUS_REGISTER 0xF0
+#define DS2484_DATA_REGISTER 0xE1
+#define DS2484_CONFIG_REGISTER 0xC3
+#define DS2484_PORT_CONFIG_REGISTER 0xB4
+
+// Status register bits.
+#define DS2484_STATUS_1WB 0x01  // 1-Wire busy
+#define DS2484_STATUS_PPD 0x02  // presence pulse detected
+#define DS2484_STATUS_SD 0x04   // short detected
+#define DS2484_STATUS_LL 0x08   // logic level of the 1-Wire line
+#define DS2484_STATUS_RST 0x10  // device reset has occurred
+#define DS2484_STATUS_SBR 0x20  // single bit result
+#define DS2484_STATUS_TSB 0x40  // triplet second bit
+#define DS2484_STATUS_DIR 0x80  // branch direction taken
+
+// Device configuration bits, written together with their complement in the upper nibble.
+#define DS2484_CONFIG_APU 0x01  // active pullup
+#define DS2484_CONFIG_PDN 0x02  // 1-Wire power down
+#define DS2484_CONFIG_SPU 0x04  // strong pullup
+#define DS2484_CONFIG_1WS 0x08  // 1-Wire overdrive speed
+
+// 1-Wire time of the DS2484 commands in microseconds, standard / overdrive speed (default port configuration).
+#define DS2484_RESET_US 1148
+#define DS2484_RESET_OVERDRIVE_US 146
+#define DS2484_SLOT_US 70
+#define DS2484_SLOT_OVERDRIVE_US 11
+
+// Extra time allowed for a 1-Wire command to finish, on top of the expected time.
+#define DS2484_TIMEOUT_MARGIN_US 10000
+
+/**
+ * DS2484 I2C 1-Wire master, see https://datasheets.maximintegrated.com/en/ds/DS2484.pdf.
+ * Each 1-Wire reset, bit, byte or search triplet is one I2C command, the DS2484 is then polled
+ * until the 1-Wire side is done. There is no echo, written bytes don't have to be read back.
+ */
+class DS2484 : public OneWireMaster {
+ private:
+  TwoWire &wire;
+  uint8_t address;
+  uint8_t config = DS2484_CONFIG_APU;
+  uint8_t readPointer = DS2484_STATUS_REGISTER;
+
+  uint32_t slotTime() const { return speed == SPEED_OVERDRIVE ? DS2484_SLOT_OVERDRIVE_US : DS2484_SLOT_US; }
+
+  bool command(uint8_t cmd);
+  bool command(uint8_t cmd, uint8_t param);
+  bool readRegister(uint8_t pointer, uint8_t &value);
+  bool writeConfig(uint8_t config);
+  // Wait until the 1-Wire command in progress is done, expected is its 1-Wire time in microseconds.
+  // The last status register value is left in statusRegister.
+  bool waitUntilIdle(uint32_t expected, uint8_t &statusRegister);
+  // One search step, returns the status register with the SBR, TSB and DIR bits.
+  bool triplet(bool direction, uint8_t &statusRegister);
+
+ public:
+  DS2484(TwoWire &wire, uint8_t address = DS2484_ADDRESS);
+
+  // Reset the DS2484 and configure the active pullup, the I2C bus should be started already.
+  // Returns false if no DS2484 answers on the address.
+  bool begin();
+
+  uint32_t getLinkSpeed() const override;
+
+  uint8_t reset() override;
+
+  void setSpeed(uint8_t speed) override;
+
+  void write(uint8_t v) override;
+
+  uint8_t read() override;
+
+  // Byte by byte, 0xFF is sent as a read byte command. A failed verifier stops the transfer at once.
+  bool block(uint8_t *buf, uint16_t count, BlockVerifier *verifier = nullptr) override;
+
+  uint8_t write_bit(uint8_t v) override;
+
+  bool writeStrongPullup(uint8_t v) override;
+  void endStrongPullup() override;
+
+  // Uses the 1-Wire triplet command, one command per ROM bit.
+  bool search(uint8_t *newAddr, bool search_mode = true) override;
+};
+
+#endif
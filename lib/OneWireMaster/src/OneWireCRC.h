@@ -0,0 +1,125 @@
+#ifndef OneWireCRC_h
+#define OneWireCRC_h
+
+#include <stdint.h>
+
+//
+// 1-Wire CRC8 (X^8 + X^5 + X^4 + 1) and CRC16 (X^16 + X^15 + X^2 + 1), both bit reflected,
+// see Maxim Application Note 27. The lookup tables are generated by the compiler, C++11
+// constexpr only allows recursion so the tables are built from an index sequence.
+// (The ESP32 ROM CRC16 routines use the CCITT polynomial, so they can't be used here.)
+//
+
+namespace onewire_crc {
+
+constexpr uint8_t crc8Bits(uint8_t crc, uint8_t bits) {
+  return bits == 0 ? crc : crc8Bits((crc & 0x01) ? (crc >> 1) ^ 0x8C : crc >> 1, bits - 1);
+}
+
+constexpr uint16_t crc16Bits(uint16_t crc, uint8_t bits) {
+  return bits == 0 ? crc : crc16Bits((crc & 0x0001) ? (crc >> 1) ^ 0xA001 : crc >> 1, bits - 1);
+}
+
+template <uint16_t... I>
+struct Sequence {};
+
+template <uint16_t N, uint16_t... I>
+struct MakeSequence : MakeSequence<N - 1, N - 1, I...> {};
+
+template <uint16_t... I>
+struct MakeSequence<0, I...> {
+  typedef Sequence<I...> type;
+};
+
+struct Table8 {
+  uint8_t value[256];
+};
+
+struct Table16 {
+  uint16_t value[256];
+};
+
+template <uint16_t... I>
+constexpr Table8 makeTable8(Sequence<I...>) {
+  return Table8{{crc8Bits(I, 8)...}};
+}
+
+template <uint16_t... I>
+constexpr Table16 makeTable16(Sequence<I...>) {
+  return Table16{{crc16Bits(I, 8)...}};
+}
+
+// Class template so the tables can be defined in this header without breaking the one definition rule.
+template <typename T = void>
+struct Tables {
+  static constexpr Table8 crc8 = makeTable8(MakeSequence<256>::type());
+  static constexpr Table16 crc16 = makeTable16(MakeSequence<256>::type());
+};
+
+template <typename T>
+constexpr Table8 Tables<T>::crc8;
+
+template <typename T>
+constexpr Table16 Tables<T>::crc16;
+
+static_assert(Tables<>::crc8.value[1] == 0x5E, "CRC8 table");
+static_assert(Tables<>::crc16.value[1] == 0xC0C1, "CRC16 table");
+
+}  // namespace onewire_crc
+
+/**
+ * CRC8 accumulator, updated one byte at a time as the bytes are received.
+ */
+class OneWireCRC8 {
+ private:
+  uint8_t crc;
+
+ public:
+  OneWireCRC8(uint8_t crc = 0) : crc(crc) {}
+
+  uint8_t update(uint8_t value) {
+    crc = onewire_crc::Tables<>::crc8.value[crc ^ value];
+    return crc;
+  }
+
+  uint8_t update(const uint8_t *buf, uint16_t len) {
+    while (len--) update(*buf++);
+    return crc;
+  }
+
+  uint8_t value() const { return crc; }
+
+  // Running the CRC over the data followed by its CRC gives 0.
+  bool isValid() const { return crc == 0; }
+};
+
+/**
+ * CRC16 accumulator, updated one byte at a time as the bytes are received.
+ */
+class OneWireCRC16 {
+ private:
+  uint16_t crc;
+
+ public:
+  OneWireCRC16(uint16_t crc = 0) : crc(crc) {}
+
+  uint16_t update(uint8_t value) {
+    crc = (crc >> 8) ^ onewire_crc::Tables<>::crc16.value[(crc ^ value) & 0xFF];
+    return crc;
+  }
+
+  uint16_t update(const uint8_t *buf, uint16_t len) {
+    while (len--) update(*buf++);
+    return crc;
+  }
+
+  uint16_t value() const { return crc; }
+
+  // Devices send the CRC16 inverted, LSB first. Running the CRC over the data followed
+  // by the two CRC bytes gives 0xB001.
+  bool isValid() const { return crc == 0xB001; }
+
+  void reset(uint16_t value = 0) { crc = value; }
+};
+
+#endif
@@ -0,0 +1,272 @@
+#include "OneWireMaster.h"
+//
+// Bus master independent parts of the 1-Wire protocol: ROM commands, the search
+// algorithm and CRCs. See https://www.maximintegrated.com/en/design/technical-documents/app-notes/1/187.html
+//
+
+const char *OneWireMaster::statusToString(OneWireStatus status) {
+  switch (status) {
+    case ONEWIRE_OK:
+      return "ok";
+    case ONEWIRE_TIMEOUT:
+      return "timeout";
+    case ONEWIRE_SHORT_READ:
+      return "short read";
+    case ONEWIRE_SHORTED:
+      return "bus shorted";
+    case ONEWIRE_NO_PRESENCE:
+      return "no presence";
+    case ONEWIRE_CRC_ERROR:
+      return "crc error";
+    default:
+      return "unknown";
+  }
+}
+
+bool OneWireMaster::write_bytes(const uint8_t *buf, uint16_t count) {
+  uint8_t chunk[ONEWIRE_WRITE_CHUNK];
+
+  while (count > 0) {
+    uint16_t len = count > ONEWIRE_WRITE_CHUNK ? ONEWIRE_WRITE_CHUNK : count;
+    memcpy(chunk, buf, len);
+    // echoes ends up in chunk and are thrown away.
+    if (!block(chunk, len)) return false;
+    buf += len;
+    count -= len;
+  }
+  return true;
+}
+
+bool OneWireMaster::read_bytes(uint8_t *buf, uint16_t count) {
+  memset(buf, 0xFF, count);
+  return block(buf, count);
+}
+
+//
+// Do a ROM select
+//
+void OneWireMaster::select(const uint8_t rom[8]) {
+  uint8_t buf[9];
+  buf[0] = MATCH_ROM;
+  memcpy(buf + 1, rom, 8);
+
+  write_bytes(buf, sizeof(buf));
+}
+
+//
+// Do a ROM skip
+//
+void OneWireMaster::skip() {
+  write(SKIP_ROM);
+}
+
+//
+// Do a ROM select at overdrive speed, the command itself is sent at standard speed.
+//
+void OneWireMaster::selectOverdrive(const uint8_t rom[8]) {
+  write(OVERDRIVE_MATCH_ROM);
+  setSpeed(SPEED_OVERDRIVE);
+  write_bytes(rom, 8);
+}
+
+//
+// Do a ROM skip at overdrive speed
+//
+void OneWireMaster::skipOverdrive() {
+  write(OVERDRIVE_SKIP_ROM);
+  setSpeed(SPEED_OVERDRIVE);
+}
+
+// returns true if parasite mode is used (Data + GND) by device
+// returns false if normal mode is used (VCC + Data + GND) by device
+bool OneWireMaster::isParasitePowered(const uint8_t rom[8]) {
+  // https://github.com/milesburton/Arduino-Temperature-Control-Library/blob/master/DallasTemperature.cpp#L231 "readPowerSupply()"
+  bool parasiteMode = false;
+
+  reset();
+  select(rom);
+
+  write(READ_POWER_SUPPLY);
+
+  if (read_bit() == 0) {
+    parasiteMode = true;
+  }
+
+  reset();
+
+  return parasiteMode;
+}
+
+//
+// You need to use this function to start a search again from the beginning.
+// You do not need to do it for the first search, though you could.
+//
+void OneWireMaster::reset_search() {
+  // reset the search state
+  LastDiscrepancy = 0;
+  LastDeviceFlag = false;
+  LastFamilyDiscrepancy = 0;
+  for (int i = 7;; i--) {
+    ROM_NO[i] = 0;
+    if (i == 0) break;
+  }
+}
+
+// Setup the search to find the device type 'family_code' on the next call
+// to search(*newAddr) if it is present.
+//
+void OneWireMaster::target_search(uint8_t family_code) {
+  // set the search state to find SearchFamily type devices
+  ROM_NO[0] = family_code;
+  for (uint8_t i = 1; i < 8; i++) ROM_NO[i] = 0;
+  LastDiscrepancy = 64;
+  LastFamilyDiscrepancy = 0;
+  LastDeviceFlag = false;
+}
+
+bool OneWireMaster::finishSearch(bool search_result, uint8_t *newAddr) {
+  // if no device found then reset counters so next 'search' will be like a
+  // first
+  if (!search_result || !ROM_NO[0]) {
+    LastDiscrepancy = 0;
+    LastDeviceFlag = false;
+    LastFamilyDiscrepancy = 0;
+    search_result = false;
+  }
+  for (int i = 0; i < 8; i++) newAddr[i] = ROM_NO[i];
+  return search_result;
+}
+
+//
+// Perform a search. If this function returns a '1' then it has
+// enumerated the next device and you may retrieve the ROM from the
+// newAddr variable. If there are no devices, no further
+// devices, or something horrible happens in the middle of the
+// enumeration then a 0 is returned.  If a new device is found then
+// its address is copied to newAddr.  Use reset_search() to
+// start over.
+//
+// --- Replaced by the one from the Dallas Semiconductor web site ---
+//--------------------------------------------------------------------------
+// Perform the 1-Wire Search Algorithm on the 1-Wire bus using the existing
+// search state.
+// Return true  : device found, ROM number in ROM_NO buffer
+//        false : device not found, end of search
+//
+// This is the bit by bit version, backends override search() with an accelerated one.
+bool OneWireMaster::search_bitwise(uint8_t *newAddr, bool search_mode) {
+  uint8_t id_bit_number;
+  uint8_t last_zero, rom_byte_number;
+  uint8_t id_bit, cmp_id_bit;
+  bool search_result;
+
+  unsigned char rom_byte_mask, search_direction;
+
+  // initialize for search
+  id_bit_number = 1;
+  last_zero = 0;
+  rom_byte_number = 0;
+  rom_byte_mask = 1;
+  search_result = false;
+
+  // if the last call was not the last one
+  if (!LastDeviceFlag) {
+    // 1-Wire reset
+    if (!reset()) {
+      // reset the search
+      LastDiscrepancy = 0;
+      LastDeviceFlag = false;
+      LastFamilyDiscrepancy = 0;
+      return false;
+    }
+
+    // issue the search command
+    write(search_mode ? SEARCH_ROM : ALARM_SEARCH);
+
+    // loop to do the search
+    do {
+      // read a bit and its complement
+      id_bit = read_bit();
+      cmp_id_bit = read_bit();
+
+      // check for no devices on 1-wire
+      if ((id_bit == 1) && (cmp_id_bit == 1))
+        break;
+      else {
+        // all devices coupled have 0 or 1
+        if (id_bit != cmp_id_bit)
+          search_direction = id_bit;  // bit write value for search
+        else {
+          // if this discrepancy if before the Last Discrepancy
+          // on a previous next then pick the same as last time
+          if (id_bit_number < LastDiscrepancy)
+            search_direction = ((ROM_NO[rom_byte_number] & rom_byte_mask) > 0);
+          else
+            // if equal to last pick 1, if not then pick 0
+            search_direction = (id_bit_number == LastDiscrepancy);
+
+          // if 0 was picked then record its position in LastZero
+          if (search_direction == 0) {
+            last_zero = id_bit_number;
+
+            // check for Last discrepancy in family
+            if (last_zero < 9) LastFamilyDiscrepancy = last_zero;
+          }
+        }
+
+        // set or clear the bit in the ROM byte rom_byte_number
+        // with mask rom_byte_mask
+        if (search_direction == 1)
+          ROM_NO[rom_byte_number] |= rom_byte_mask;
+        else
+          ROM_NO[rom_byte_number] &= ~rom_byte_mask;
+
+        // serial number search direction write bit
+        write_bit(search_direction);
+
+        // increment the byte counter id_bit_number
+        // and shift the mask rom_byte_mask
+        id_bit_number++;
+        rom_byte_mask <<= 1;
+
+        // if the mask is 0 then go to new SerialNum byte rom_byte_number and
+        // reset mask
+        if (rom_byte_mask == 0) {
+          rom_byte_number++;
+          rom_byte_mask = 1;
+        }
+      }
+    } while (rom_byte_number < 8);  // loop until through all ROM bytes 0-7
+
+    // if the search was successful then
+    if (!(id_bit_number < 65)) {
+      // search successful so set LastDiscrepancy,LastDeviceFlag,search_result
+      LastDiscrepancy = last_zero;
+
+      // check for last device
+      if (LastDiscrepancy == 0) LastDeviceFlag = true;
+
+      search_result = true;
+    }
+  }
+
+  return finishSearch(search_result, newAddr);
+}
+
+// The 1-Wire CRC scheme is described in Maxim Application Note 27:
+// "Understanding and Using Cyclic Redundancy Checks with Maxim iButton
+// Products". The lookup tables are generated at compile time, see OneWireCRC.h.
+//
+uint8_t OneWireMaster::crc8(const uint8_t *addr, uint8_t len) {
+  return OneWireCRC8().update(addr, len);
+}
+
+bool OneWireMaster::check_crc16(const uint8_t *input, uint16_t len,
+                                const uint8_t *inverted_crc, uint16_t crc) {
+  crc = ~crc16(input, len, crc);
+  return (crc & 0xFF) == inverted_crc[0] && (crc >> 8) == inverted_crc[1];
+}
+
+uint16_t OneWireMaster::crc16(const uint8_t *input, uint16_t len, uint16_t crc) {
+  return OneWireCRC16(crc).update(input, len);
+}
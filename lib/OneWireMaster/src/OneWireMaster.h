@@ -0,0 +1,288 @@
+#ifndef OneWireMaster_h
+#define OneWireMaster_h
+
+#include <Arduino.h>
+#include "OneWireCRC.h"
+
+// ROM commands
+#define SEARCH_ROM 0xF0
+#define ALARM_SEARCH 0xEC
+#define SKIP_ROM 0xCC
+#define MATCH_ROM 0x55
+#define RESUME 0xA5  // reselect the device selected by the last MATCH ROM
+#define READ_POWER_SUPPLY 0xB4
+#define OVERDRIVE_SKIP_ROM 0x3C
+#define OVERDRIVE_MATCH_ROM 0x69
+
+// 1-Wire speed, the values are the DS2480B speed bits (bits 3-2 of its communication commands).
+#define SPEED_STANDARD 0x00
+#define SPEED_OVERDRIVE 0x08
+
+// Supported 1-Wire devices
+// https://github.com/owfs/owfs-doc/wiki/1Wire-Device-List
+#define DS2405 0x5    // 1-channel switch
+#define DS2406 0x12   // 2-channel switch
+#define DS2413 0x3A   // 2-channel switch
+#define DS2408 0x29   // 8-channel switch
+#define DS18S20 0x10  // temperature sensor
+#define DS1822 0x22   // temperature sensor
+#define DS18B20 0x28  // temperature sensor
+#define DS2423 0x1D   // dual counter
+#define DS2450 0x20   // quad A/D converters
+
+// Largest number of bytes write_bytes() hands to block() at a time.
+#define ONEWIRE_WRITE_CHUNK 64
+
+// Result of the last operation.
+enum OneWireStatus : uint8_t {
+  ONEWIRE_OK = 0,
+  ONEWIRE_TIMEOUT,      // no (valid) reply from the bus master in time
+  ONEWIRE_SHORT_READ,   // some but not all of the expected bytes were received in time
+  ONEWIRE_SHORTED,      // the 1-Wire bus is shorted
+  ONEWIRE_NO_PRESENCE,  // no device answered the reset with a presence pulse
+  ONEWIRE_CRC_ERROR,    // a BlockVerifier found a CRC error in the received bytes
+};
+
+// Traffic between host and bus master, used for benchmarking.
+struct OneWireStats {
+  uint32_t bytesSent = 0;
+  uint32_t bytesReceived = 0;
+  uint32_t roundTrips = 0;  // number of times we waited for a reply
+};
+
+/**
+ * Checks the bytes of a block() transfer as they are received, the transfer is abandoned
+ * as soon as the bus master allows once the check has failed.
+ */
+class BlockVerifier {
+ public:
+  virtual ~BlockVerifier() {}
+  // Called with every received byte in order, return false once the transfer has failed.
+  virtual bool received(uint8_t value) = 0;
+};
+
+/**
+ * Verifies the CRC8 that follows length bytes, after skipping the first skip bytes (e.g. a MATCH ROM).
+ */
+class CRC8Verifier : public BlockVerifier {
+ private:
+  OneWireCRC8 crc;
+  uint16_t skip;
+  uint16_t remaining;
+
+ public:
+  CRC8Verifier(uint16_t skip, uint16_t length) : skip(skip), remaining(length + 1) {}
+
+  bool received(uint8_t value) override {
+    if (skip > 0) {
+      skip--;
+    } else if (remaining > 0) {
+      crc.update(value);
+      if (--remaining == 0) return crc.isValid();
+    }
+    return true;
+  }
+};
+
+/**
+ * Verifies the inverted CRC16 that follows firstLength bytes, after skipping the first skip bytes,
+ * and then one after every following length bytes if length isn't 0 (e.g. DS2423 memory pages).
+ */
+class CRC16Verifier : public BlockVerifier {
+ private:
+  OneWireCRC16 crc;
+  uint16_t skip;
+  uint16_t segment;
+  uint16_t length;
+  uint16_t position = 0;
+  uint16_t verified = 0;
+
+ public:
+  CRC16Verifier(uint16_t skip, uint16_t firstLength, uint16_t length = 0) : skip(skip), segment(firstLength), length(length) {}
+
+  // Number of segments received with a valid CRC16, tells where a failed transfer can continue.
+  uint16_t getVerified() const { return verified; }
+
+  bool received(uint8_t value) override {
+    if (skip > 0) {
+      skip--;
+      return true;
+    }
+    if (segment == 0) return true;
+
+    crc.update(value);
+    if (++position < segment + 2) return true;
+
+    bool valid = crc.isValid();
+    if (valid) verified++;
+    crc.reset();
+    position = 0;
+    segment = length;
+    return valid;
+  }
+};
+
+/**
+ * A 1-Wire bus master, the device drivers in src/ only talk to the bus through this interface.
+ * Implemented by DS2480B (serial) and DS2484 (I2C).
+ *
+ * The ROM commands, byte transfers and the bit by bit search are built on the primitives
+ * the backends implement: reset(), write_bit(), write(), read(), block() and setSpeed().
+ */
+class OneWireMaster {
+ protected:
+  uint8_t speed = SPEED_STANDARD;
+  OneWireStats stats;
+  OneWireStatus status = ONEWIRE_OK;
+
+  // global search state
+  unsigned char ROM_NO[8];
+  uint8_t LastDiscrepancy;
+  uint8_t LastFamilyDiscrepancy;
+  bool LastDeviceFlag;
+
+  // Store the result of a search pass in the search state and newAddr, see search_bitwise().
+  bool finishSearch(bool search_result, uint8_t *newAddr);
+
+ public:
+  OneWireMaster() { reset_search(); }
+  virtual ~OneWireMaster() {}
+
+  // Perform a 1-Wire reset cycle. Returns 1 if a device responds
+  // with a presence pulse.  Returns 0 if there is no device or the
+  // bus is shorted or otherwise held low for more than 250uS
+  // The reset is always done at standard speed, which also returns
+  // all overdrive devices on the bus to standard speed.
+  virtual uint8_t reset() = 0;
+
+  // Set the speed (SPEED_STANDARD or SPEED_OVERDRIVE) used by the bus master
+  // for the following bytes and bits, without any activity on the bus.
+  virtual void setSpeed(uint8_t speed) = 0;
+
+  uint8_t getSpeed() const { return speed; }
+
+  // Host link speed in bit/s, the UART baud rate or the I2C clock.
+  virtual uint32_t getLinkSpeed() const = 0;
+
+  // Issue a 1-Wire rom select command, you do the reset first.
+  virtual void select(const uint8_t rom[8]);
+
+  // Issue a 1-Wire rom skip command, to address all on bus.
+  virtual void skip();
+
+  // Issue a 1-Wire overdrive match rom command, the selected device and the
+  // bus master then continue at overdrive speed until the next reset().
+  // Only for devices supporting overdrive, you do the reset first.
+  virtual void selectOverdrive(const uint8_t rom[8]);
+
+  // Issue a 1-Wire overdrive skip rom command, all overdrive capable devices
+  // on the bus and the bus master then continue at overdrive speed until the next reset().
+  virtual void skipOverdrive();
+
+  // Write a byte.
+  virtual void write(uint8_t v) = 0;
+
+  // Write several bytes, returns false if the transfer failed.
+  virtual bool write_bytes(const uint8_t *buf, uint16_t count);
+
+  // Read a byte.
+  virtual uint8_t read() = 0;
+
+  // Read several bytes, returns false if not all bytes were received.
+  virtual bool read_bytes(uint8_t *buf, uint16_t count);
+
+  // Full duplex block transfer, all bytes in buf are sent to the 1-Wire bus and buf
+  // is overwritten with the bytes read back from the bus.
+  // Send 0xFF for the bytes that should be read from a device.
+  // Returns false if not all bytes were transferred, or if verifier rejected them.
+  virtual bool block(uint8_t *buf, uint16_t count, BlockVerifier *verifier = nullptr) = 0;
+
+  // Write a bit, returns the bit read back.
+  virtual uint8_t write_bit(uint8_t v) = 0;
+
+  // Read a bit.
+  uint8_t read_bit() { return write_bit(1); }
+
+  // Write a byte and then keep the bus at a strong pullup, to power parasite devices through
+  // e.g. a temperature conversion. The pullup stays on until endStrongPullup() is called.
+  // Returns false if the byte couldn't be written.
+  virtual bool writeStrongPullup(uint8_t v) = 0;
+
+  // Return the bus to the normal, resistive, pullup.
+  virtual void endStrongPullup() = 0;
+
+  // Check if device is parasite powered (no VCC)
+  bool isParasitePowered(const uint8_t rom[8]);
+
+  // Clear the search state so that if will start from the beginning again.
+  void reset_search();
+
+  // Setup the search to find the device type 'family_code' on the next call
+  // to search(*newAddr) if it is present.
+  void target_search(uint8_t family_code);
+
+  // Look for the next device. Returns 1 if a new address has been
+  // returned. A zero might mean that the bus is shorted, there are
+  // no devices, or you have already retrieved all of them.  It
+  // might be a good idea to check the CRC to make sure you didn't
+  // get garbage.  The order is deterministic. You will always get
+  // the same devices in the same order.
+  // With search_mode false only devices in an alarm state answer (ALARM SEARCH, the
+  // conditional search), use the same search_mode until the search is done.
+  // Backends override this with their hardware assisted search.
+  virtual bool search(uint8_t *newAddr, bool search_mode = true) { return search_bitwise(newAddr, search_mode); }
+
+  // Same as search(), but walks the ROM one bit at a time (three bit transfers per bit).
+  bool search_bitwise(uint8_t *newAddr, bool search_mode = true);
+
+  // Result of the last reset or transfer, tells why an operation failed.
+  OneWireStatus getStatus() const { return status; }
+
+  static const char *statusToString(OneWireStatus status);
+
+  const OneWireStats &getStats() const { return stats; }
+  void resetStats() { stats = OneWireStats(); }
+
+  // Compute a Dallas Semiconductor 8 bit CRC, these are used in the
+  // ROM and scratchpad registers.
+  static uint8_t crc8(const uint8_t *addr, uint8_t len);
+
+  // Compute the 1-Wire CRC16 and compare it against the received CRC.
+  // Example usage (reading a DS2408):
+  //    // Put everything in a buffer so we can compute the CRC easily.
+  //    uint8_t buf[13];
+  //    buf[0] = 0xF0;    // Read PIO Registers
+  //    buf[1] = 0x88;    // LSB address
+  //    buf[2] = 0x00;    // MSB address
+  //    WriteBytes(net, buf, 3);    // Write 3 cmd bytes
+  //    ReadBytes(net, buf+3, 10);  // Read 6 data bytes, 2 0xFF, 2 CRC16
+  //    if (!CheckCRC16(buf, 11, &buf[11])) {
+  //        // Handle error.
+  //    }
+  //
+  // @param input - Array of bytes to checksum.
+  // @param len - How many bytes to use.
+  // @param inverted_crc - The two CRC16 bytes in the received data.
+  //                       This should just point into the received data,
+  //                       *not* at a 16-bit integer.
+  // @param crc - The crc starting value (optional)
+  // @return True, iff the CRC matches.
+  static bool check_crc16(const uint8_t *input, uint16_t len,
+                          const uint8_t *inverted_crc, uint16_t crc = 0);
+
+  // Compute a Dallas Semiconductor 16 bit CRC.  This is required to check
+  // the integrity of data received from many 1-Wire devices.  Note that the
+  // CRC computed here is *not* what you'll get from the 1-Wire network,
+  // for two reasons:
+  //   1) The CRC is transmitted bitwise inverted.
+  //   2) Depending on the endian-ness of your processor, the binary
+  //      representation of the two-byte return value may have a different
+  //      byte order than the two bytes you get from 1-Wire.
+  // @param input - Array of bytes to checksum.
+  // @param len - How many bytes to use.
+  // @param crc - The crc starting value (optional)
+  // @return The CRC16, as defined by Dallas Semiconductor.
+  static uint16_t crc16(const uint8_t *input, uint16_t len, uint16_t crc = 0);
+};
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+// Minimal Arduino API for building the 1-Wire drivers on the host (env:native).
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+
+#include "esp_timer.h"
+#include "native_clock.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define B00000000 0
+#define B11111111 255
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Logging is silent on the host unless NATIVE_LOG is defined. The message is formatted either way, so the
+// arguments are checked against the format and evaluated as on the controller.
+inline void nativeLog(const char *level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+inline void nativeLog(const char *level, const char *tag, const char *format, ...) {
+  char message[256];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+#ifdef NATIVE_LOG
+  printf("[%s] %s: %s\n", level, tag, message);
+#endif
+}
+#define NATIVE_LOG_PRINT(level, tag, format, ...) nativeLog(level, tag, format, ##__VA_ARGS__)
+#define ESP_LOGE(tag, format, ...) NATIVE_LOG_PRINT("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) NATIVE_LOG_PRINT("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) NATIVE_LOG_PRINT("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) NATIVE_LOG_PRINT("D", tag, format, ##__VA_ARGS__)
+
+inline unsigned long millis() { return native::clock() / 1000; }
+inline unsigned long micros() { return native::clock(); }
+inline void delay(unsigned long ms) { native::advance(ms * 1000LL); }
+inline void delayMicroseconds(unsigned int us) { native::advance(us); }
+inline void yield() { native::advance(1); }
+
+class String {
+ private:
+  std::string str;
+
+  static std::string format(unsigned long long value, int base) {
+    if (value == 0) return "0";
+    std::string s;
+    while (value > 0) {
+      s.insert(s.begin(), "0123456789abcdef"[value % base]);
+      value /= base;
+    }
+    return s;
+  }
+
+ public:
+  String() {}
+  String(const char *s) : str(s != nullptr ? s : "") {}
+  String(const std::string &s) : str(s) {}
+  explicit String(char c) : str(1, c) {}
+  String(int value, int base = DEC) : str(base == DEC ? std::to_string(value) : format((unsigned int)value, base)) {}
+  String(unsigned int value, int base = DEC) : str(format(value, base)) {}
+  String(long value, int base = DEC) : str(base == DEC ? std::to_string(value) : format((unsigned long)value, base)) {}
+  String(unsigned long value, int base = DEC) : str(format(value, base)) {}
+  String(float value, unsigned int decimals = 2) : String((double)value, decimals) {}
+  String(double value, unsigned int decimals = 2) {
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    str = buf;
+  }
+
+  const char *c_str() const { return str.c_str(); }
+  unsigned int length() const { return str.length(); }
+  String substring(unsigned int from) const { return from < str.length() ? String(str.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const { return from < str.length() ? String(str.substr(from, to - from)) : String(); }
+  long toInt() const { return atol(str.c_str()); }
+  char operator[](unsigned int index) const { return str[index]; }
+
+  void trim() {
+    auto first = str.find_first_not_of(" \t\r\n");
+    auto last = str.find_last_not_of(" \t\r\n");
+    str = first == std::string::npos ? "" : str.substr(first, last - first + 1);
+  }
+
+  String &operator+=(const String &rhs) { str += rhs.str; return *this; }
+  String &operator+=(const char *rhs) { str += rhs; return *this; }
+  String &operator+=(char rhs) { str += rhs; return *this; }
+
+  bool operator==(const String &rhs) const { return str == rhs.str; }
+  bool operator==(const char *rhs) const { return str == rhs; }
+  bool operator!=(const String &rhs) const { return str != rhs.str; }
+  bool operator!=(const char *rhs) const { return rhs == nullptr || str != rhs; }
+
+  friend String operator+(const String &lhs, const String &rhs) { return String(lhs.str + rhs.str); }
+  friend String operator+(const String &lhs, const char *rhs) { return String(lhs.str + rhs); }
+  friend String operator+(const char *lhs, const String &rhs) { return String(lhs + rhs.str); }
+};
+
+// Serial console, prints to stdout.
+class NativeSerial {
+ public:
+  void begin(unsigned long baud) {}
+  size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+  size_t print(const char *s) { return fputs(s, stdout) == EOF ? 0 : strlen(s); }
+  size_t print(const String &s) { return print(s.c_str()); }
+  size_t print(int value, int base = DEC) { return print(String(value, base)); }
+  size_t println() { return print("\n"); }
+  template <typename T>
+  size_t println(const T &value) { return print(value) + println(); }
+  size_t printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int len = vprintf(format, args);
+    va_end(args);
+    return len < 0 ? 0 : len;
+  }
+};
+
+inline NativeSerial Serial;
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include "Arduino.h"
+
+#define SERIAL_8N1 0x800001c
+
+// Host version of the ESP32 HardwareSerial, the simulator derives from it.
+class HardwareSerial {
+ public:
+  virtual ~HardwareSerial() {}
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1, bool invert = false, unsigned long timeout_ms = 20000UL) {
+    updateBaudRate(baud);
+  }
+
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual size_t write(uint8_t v) { return 1; }
+  virtual size_t write(const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) write(buf[i]);
+    return len;
+  }
+  virtual void flush() {}
+  virtual void updateBaudRate(unsigned long baud) {}
+};
+
+#endif
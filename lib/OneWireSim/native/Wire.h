@@ -0,0 +1,28 @@
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "Arduino.h"
+
+// Host version of the ESP32 TwoWire (I2C master), the simulator derives from it.
+class TwoWire {
+ public:
+  virtual ~TwoWire() {}
+
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+    if (frequency != 0) setClock(frequency);
+    return true;
+  }
+
+  virtual bool setClock(uint32_t frequency) { return true; }
+  virtual uint32_t getClock() { return 100000; }
+
+  virtual void beginTransmission(uint8_t address) {}
+  virtual size_t write(uint8_t value) { return 1; }
+  // 0 on success, 2 if the address wasn't acknowledged, 3 if data wasn't.
+  virtual uint8_t endTransmission(bool sendStop = true) { return 2; }
+  virtual uint8_t requestFrom(uint8_t address, uint8_t quantity) { return 0; }
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef EspTaskWdt_h
+#define EspTaskWdt_h
+
+// There is no task watchdog on the host.
+inline int esp_task_wdt_reset() { return 0; }
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef EspTimer_h
+#define EspTimer_h
+
+#include "native_clock.h"
+
+inline int64_t esp_timer_get_time() { return native::clock(); }
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef FreeRTOS_h
+#define FreeRTOS_h
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xFFFFFFFF
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define pdMS_TO_TICKS(ms) (ms)
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef FreeRTOSQueue_h
+#define FreeRTOSQueue_h
+
+#include <stdlib.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Queues of fixed size items copied in and out, the storage is allocated once by xQueueCreate() as on
+// the controller. A task that would wait on an empty queue is blocked instead, see native::runTasks().
+
+struct NativeQueue {
+  uint8_t *items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  UBaseType_t head;
+  UBaseType_t count;
+};
+
+typedef NativeQueue *QueueHandle_t;
+
+#define errQUEUE_FULL 0
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  auto queue = (NativeQueue *)malloc(sizeof(NativeQueue));
+  queue->items = (uint8_t *)malloc(length * itemSize);
+  queue->length = length;
+  queue->itemSize = itemSize;
+  queue->head = 0;
+  queue->count = 0;
+  return queue;
+}
+
+inline void vQueueDelete(QueueHandle_t queue) {
+  free(queue->items);
+  free(queue);
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) { return queue->count; }
+
+// Nothing else runs while a task waits for room, a full queue fails right away.
+inline BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+  if (queue->count == queue->length) return errQUEUE_FULL;
+  memcpy(queue->items + (queue->head + queue->count) % queue->length * queue->itemSize, item, queue->itemSize);
+  queue->count++;
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks) {
+  if (queue->count == queue->length) return errQUEUE_FULL;
+  queue->head = (queue->head + queue->length - 1) % queue->length;
+  memcpy(queue->items + queue->head * queue->itemSize, item, queue->itemSize);
+  queue->count++;
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+  return xQueueSendToBack(queue, item, ticks);
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+  if (queue->count == 0) {
+    if (ticks == portMAX_DELAY) native::blockTask();
+    return pdFALSE;
+  }
+  memcpy(item, queue->items + queue->head * queue->itemSize, queue->itemSize);
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  return pdTRUE;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef FreeRTOSTask_h
+#define FreeRTOSTask_h
+
+#include "FreeRTOS.h"
+#include "../native_clock.h"
+
+// Tasks don't run concurrently on the host. xTaskCreatePinnedToCore() only registers a task, it runs when
+// another task delays or yields, until it waits on an empty queue. It's unwound then and started again the
+// next time, so a task may only block at the top of its loop, as OneWireEngine::taskMain() does.
+
+typedef void (*TaskFunction_t)(void *param);
+
+struct NativeTask {
+  TaskFunction_t function;
+  void *param;
+};
+
+typedef NativeTask *TaskHandle_t;
+
+#define NATIVE_TASK_COUNT 8
+
+namespace native {
+
+struct TaskBlocked {};
+
+inline NativeTask *tasks() {
+  static NativeTask registered[NATIVE_TASK_COUNT];
+  return registered;
+}
+
+inline bool &inTask() {
+  static bool running = false;
+  return running;
+}
+
+// Run every task until it waits, not from a task, it would wait for the others.
+inline void runTasks() {
+  if (inTask()) return;
+
+  inTask() = true;
+  for (int i = 0; i < NATIVE_TASK_COUNT; i++) {
+    if (tasks()[i].function == nullptr) continue;
+    try {
+      tasks()[i].function(tasks()[i].param);
+    } catch (const TaskBlocked &) {
+    }
+  }
+  inTask() = false;
+}
+
+// Called by a task waiting for a queue, outside a task there's nothing to wait for.
+inline void blockTask() {
+  if (inTask()) throw TaskBlocked();
+}
+
+// Forget all tasks, e.g. in tearDown() when the objects they run on are deleted.
+inline void deleteTasks() {
+  for (int i = 0; i < NATIVE_TASK_COUNT; i++) tasks()[i] = NativeTask{};
+}
+
+}  // namespace native
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *param,
+                                          UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+  for (int i = 0; i < NATIVE_TASK_COUNT; i++) {
+    auto &task = native::tasks()[i];
+    if (task.function == nullptr) {
+      task = NativeTask{function, param};
+      if (handle != nullptr) *handle = &task;
+      return pdPASS;
+    }
+  }
+  return pdFAIL;
+}
+
+// On the host a task delay or yield lets the other tasks run and moves the simulated clock forward.
+inline void vTaskDelay(TickType_t ticks) {
+  native::runTasks();
+  native::advance(ticks * portTICK_PERIOD_MS * 1000LL);
+}
+
+inline void taskYIELD() {
+  native::runTasks();
+  native::advance(5);
+}
+
+#endif
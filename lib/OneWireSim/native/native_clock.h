@@ -0,0 +1,21 @@
+#ifndef NativeClock_h
+#define NativeClock_h
+
+#include <stdint.h>
+
+// Simulated time in microseconds, shared by the Arduino/ESP-IDF shims and the simulator.
+// Nothing runs in real time on the host, waiting just moves the clock forward.
+namespace native {
+
+inline int64_t &clock() {
+  static int64_t micros = 0;
+  return micros;
+}
+
+inline void advance(int64_t micros) {
+  clock() += micros;
+}
+
+}  // namespace native
+
+#endif
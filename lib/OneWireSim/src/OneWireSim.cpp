@@ -0,0 +1,599 @@
+#include "OneWireSim.h"
+
+// ROM function commands
+#define SIM_READ_ROM 0x33
+#define SIM_MATCH_ROM 0x55
+#define SIM_SKIP_ROM 0xCC
+#define SIM_SEARCH_ROM 0xF0
+#define SIM_ALARM_SEARCH 0xEC
+#define SIM_RESUME 0xA5
+#define SIM_OVERDRIVE_SKIP_ROM 0x3C
+#define SIM_OVERDRIVE_MATCH_ROM 0x69
+
+// DS2480B mode switch bytes
+#define SIM_DATA_MODE 0xE1
+#define SIM_COMMAND_MODE 0xE3
+
+//
+// SimDevice
+//
+SimDevice::SimDevice(const uint8_t id[8]) { memcpy(rom, id, 8); }
+
+int64_t SimDevice::now() const { return bus != nullptr ? bus->now() : native::clock(); }
+
+bool SimDevice::reset(bool overdriveSpeed) {
+  // a standard speed device doesn't notice an overdrive reset pulse.
+  if (overdriveSpeed && !overdrive) return false;
+
+  overdrive = overdriveSpeed;
+  romState = ROM_COMMAND;
+  bitIndex = 0;
+  inByte = 0;
+  functionReset();
+  return true;
+}
+
+bool SimDevice::driveBit() {
+  switch (romState) {
+    case ROM_SEARCH:
+      if (searchPhase == 0) return romBit(bitIndex);
+      if (searchPhase == 1) return !romBit(bitIndex);
+      return true;
+    case ROM_READ:
+      return romBit(bitIndex);
+    case ROM_FUNCTION:
+      return functionDriveBit();
+    default:
+      return true;
+  }
+}
+
+void SimDevice::sampleBit(bool value) {
+  switch (romState) {
+    case ROM_COMMAND:
+      if (value) inByte |= 1 << bitIndex;
+      if (++bitIndex == 8) {
+        uint8_t command = inByte;
+        bitIndex = 0;
+        inByte = 0;
+        romByteReceived(command);
+      }
+      break;
+
+    case ROM_MATCH:
+      if (value != romBit(bitIndex)) {
+        romState = ROM_IDLE;
+        resumeFlag = false;
+      } else if (++bitIndex == 64) {
+        romState = ROM_FUNCTION;
+        resumeFlag = true;
+        bitIndex = 0;
+        functionMatched();
+      }
+      break;
+
+    case ROM_SEARCH:
+      if (searchPhase < 2) {
+        searchPhase++;
+      } else if (value != romBit(bitIndex)) {
+        // the master took the other branch.
+        romState = ROM_IDLE;
+        resumeFlag = false;
+      } else {
+        searchPhase = 0;
+        if (++bitIndex == 64) {
+          romState = ROM_FUNCTION;
+          resumeFlag = true;
+          bitIndex = 0;
+        }
+      }
+      break;
+
+    case ROM_READ:
+      if (++bitIndex == 64) {
+        romState = ROM_FUNCTION;
+        resumeFlag = true;
+        bitIndex = 0;
+      }
+      break;
+
+    case ROM_FUNCTION:
+      functionSampleBit(value);
+      break;
+
+    default:
+      break;
+  }
+}
+
+void SimDevice::romByteReceived(uint8_t command) {
+  searchPhase = 0;
+
+  switch (command) {
+    case SIM_MATCH_ROM:
+      romState = ROM_MATCH;
+      break;
+    case SIM_OVERDRIVE_MATCH_ROM:
+      // the ROM is sent at overdrive speed, devices that don't match stay at overdrive speed until the next reset.
+      romState = supportsOverdrive() ? ROM_MATCH : ROM_IDLE;
+      overdrive = supportsOverdrive();
+      break;
+    case SIM_SKIP_ROM:
+      romState = ROM_FUNCTION;
+      resumeFlag = false;
+      break;
+    case SIM_OVERDRIVE_SKIP_ROM:
+      romState = supportsOverdrive() ? ROM_FUNCTION : ROM_IDLE;
+      overdrive = supportsOverdrive();
+      resumeFlag = false;
+      break;
+    case SIM_SEARCH_ROM:
+      romState = ROM_SEARCH;
+      break;
+    case SIM_ALARM_SEARCH:
+      romState = isAlarming() ? ROM_SEARCH : ROM_IDLE;
+      break;
+    case SIM_READ_ROM:
+      romState = ROM_READ;
+      break;
+    case SIM_RESUME:
+      romState = resumeFlag ? ROM_FUNCTION : ROM_IDLE;
+      break;
+    default:
+      romState = ROM_IDLE;
+      break;
+  }
+}
+
+bool SimDevice::functionDriveBit() {
+  if (bitIndex == 0) outByte = functionRead();
+  return (outByte >> bitIndex) & 1;
+}
+
+void SimDevice::functionSampleBit(bool value) {
+  if (value) inByte |= 1 << bitIndex;
+  if (++bitIndex == 8) {
+    uint8_t received = inByte;
+    bitIndex = 0;
+    inByte = 0;
+    functionWrite(received);
+  }
+}
+
+void SimDevice::makeRom(uint8_t family, uint64_t serial, uint8_t rom[8]) {
+  rom[0] = family;
+  for (uint8_t i = 1; i < 7; i++) {
+    rom[i] = serial & 0xFF;
+    serial >>= 8;
+  }
+  rom[7] = crc8(rom, 7);
+}
+
+// Bitwise implementations, independent of the tables in the DS2480B library they are used to check.
+uint8_t SimDevice::crc8(const uint8_t *data, uint8_t len) {
+  uint8_t crc = 0;
+
+  while (len--) {
+    uint8_t value = *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      bool mix = (crc ^ value) & 0x01;
+      crc >>= 1;
+      if (mix) crc ^= 0x8C;
+      value >>= 1;
+    }
+  }
+  return crc;
+}
+
+uint16_t SimDevice::crc16(const uint8_t *data, uint16_t len, uint16_t crc) {
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc & 0x01) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+  }
+  return crc;
+}
+
+//
+// SimBus
+//
+void SimBus::attach(SimDevice *device) {
+  devices.push_back(device);
+  device->attach(this);
+}
+
+void SimBus::detach(SimDevice *device) {
+  devices.erase(std::remove(devices.begin(), devices.end(), device), devices.end());
+}
+
+uint8_t SimBus::reset(bool overdriveSpeed) {
+  if (shorted) return 0;
+
+  bool presence = false;
+  for (auto device : devices) {
+    presence |= device->reset(overdriveSpeed);
+  }
+  return presence ? 1 : 3;
+}
+
+bool SimBus::transferBit(bool bit, bool overdriveSpeed) {
+  this->overdriveSpeed = overdriveSpeed;
+  if (shorted) return false;
+
+  bool value = bit;
+  for (auto device : devices) {
+    if (participates(device)) value &= device->driveBit();
+  }
+  for (auto device : devices) {
+    if (participates(device)) device->sampleBit(value);
+  }
+  return value;
+}
+
+uint8_t SimBus::transferByte(uint8_t value, bool overdriveSpeed) {
+  uint8_t result = 0;
+
+  for (uint8_t i = 0; i < 8; i++) {
+    if (transferBit((value >> i) & 1, overdriveSpeed)) result |= 1 << i;
+  }
+  return result;
+}
+
+//
+// SimDS2480B
+//
+SimDS2480B::SimDS2480B(SimBus &bus, uint32_t seed) : bus(bus), rng(seed) {}
+
+int SimDS2480B::available() {
+  int count = 0;
+  for (auto i = replyHead; i < replies.size(); i++) {
+    if (replies[i].ready > native::clock()) break;
+    count++;
+  }
+  return count;
+}
+
+int SimDS2480B::read() {
+  if (replyHead == replies.size() || replies[replyHead].ready > native::clock()) return -1;
+
+  uint8_t value = replies[replyHead++].value;
+  if (replyHead == replies.size()) {
+    replies.clear();
+    replyHead = 0;
+  }
+  return value;
+}
+
+size_t SimDS2480B::write(uint8_t value) {
+  stats.hostBytes++;
+  txFree = std::max(txFree, native::clock()) + byteTime(hostBaud);
+
+  if (!connected) return 1;
+
+  // a null character at 4800 baud or slower holds the line low long enough for a master reset.
+  if (hostBaud <= 4800 && value == 0x00) {
+    masterReset();
+    return 1;
+  }
+
+  // bytes at the wrong or an unusable baud rate are garbage to the DS2480B.
+  if (hostBaud != chipBaud || hostBaud > maxBaud) return 1;
+
+  arrived = txFree;
+  receive(value);
+  return 1;
+}
+
+size_t SimDS2480B::write(const uint8_t *buf, size_t len) {
+  for (size_t i = 0; i < len; i++) write(buf[i]);
+  return len;
+}
+
+void SimDS2480B::flush() {
+  if (txFree > native::clock()) native::advance(txFree - native::clock());
+}
+
+void SimDS2480B::masterReset() {
+  mode = MODE_COMMAND;
+  accelerator = false;
+  overdriveSpeed = false;
+  calibrated = false;
+  chipBaud = 9600;
+  rbr = 0;
+  stats.masterResets++;
+}
+
+int64_t SimDS2480B::busOperation(int64_t duration) {
+  int64_t start = std::max(arrived, chipFree);
+  bus.setTime(start);
+  chipFree = start + duration;
+  return chipFree;
+}
+
+void SimDS2480B::reply(uint8_t value, int64_t ready) {
+  stats.replyBytes++;
+  if (dropCount > 0) {
+    dropCount--;
+    return;
+  }
+
+  rxFree = std::max(ready, rxFree) + byteTime(chipBaud);
+  replies.push_back({rxFree, value});
+}
+
+uint8_t SimDS2480B::corrupt(uint8_t value) {
+  if (corruptCount > 0) {
+    corruptCount--;
+    return value ^ (1 << (rng() % 8));
+  }
+  if (errorRate > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < errorRate) {
+    return value ^ (1 << (rng() % 8));
+  }
+  return value;
+}
+
+void SimDS2480B::receive(uint8_t value) {
+  // the first byte after a master reset calibrates the timing generator and gets no reply.
+  if (!calibrated) {
+    calibrated = true;
+    return;
+  }
+
+  switch (mode) {
+    case MODE_COMMAND:
+      command(value);
+      break;
+    case MODE_DATA:
+      if (value == SIM_COMMAND_MODE) {
+        mode = MODE_CHECK;
+      } else {
+        data(value);
+      }
+      break;
+    case MODE_CHECK:
+      // a doubled command mode byte is data, anything else is a command.
+      if (value == SIM_COMMAND_MODE) {
+        mode = MODE_DATA;
+        data(value);
+      } else {
+        mode = MODE_COMMAND;
+        command(value);
+      }
+      break;
+  }
+}
+
+void SimDS2480B::command(uint8_t value) {
+  static const uint32_t rates[] = {9600, 19200, 57600, 115200, 9600, 19200, 57600, 115200};
+
+  if (value == SIM_DATA_MODE) {
+    mode = MODE_DATA;
+    return;
+  }
+
+  if ((value & 0x81) == 0x81) {
+    // communication command "1 ff b ss p 1", speed code 10 is overdrive.
+    bool overdrive = ((value >> 2) & 0x03) == 0x02;
+
+    switch ((value >> 5) & 0x03) {
+      case 0: {  // single bit
+        overdriveSpeed = overdrive;
+        int64_t done = busOperation(slotTime());
+        stats.busBits++;
+        bool bit = bus.transferBit(value & 0x10, overdriveSpeed);
+        reply((value & 0xFC) | (bit ? 0x03 : 0x00), done);
+        // an armed bit is followed by the strong pullup, for the duration set by the SPUD parameter.
+        if (value & 0x02) bus.setStrongPullup(true);
+        break;
+      }
+      case 1:  // search accelerator on/off, no reply
+        overdriveSpeed = overdrive;
+        accelerator = value & 0x10;
+        break;
+      case 2: {  // reset, reply "110x xxrr"
+        overdriveSpeed = overdrive;
+        int64_t done = busOperation(overdrive ? SIM_RESET_OVERDRIVE_US : SIM_RESET_US);
+        stats.resets++;
+        reply(0xCC | bus.reset(overdriveSpeed), done);
+        break;
+      }
+      default:  // pulse, only terminating the strong pullup is simulated. Reply "111x xxxx".
+        bus.setStrongPullup(false);
+        reply(value & 0xFC, arrived);
+        break;
+    }
+  } else if (value & 0x01) {
+    // configuration command "0 ppp vvv 1", parameter 000 reads back the parameter in vvv.
+    uint8_t parameter = (value >> 4) & 0x07;
+
+    if (parameter == 0) {
+      reply(((value >> 1) & 0x07) == 0x07 ? rbr << 1 : 0x00, arrived);
+    } else {
+      reply(value & 0xFE, arrived);
+      if (parameter == 0x07) {
+        rbr = (value >> 1) & 0x07;
+        chipBaud = rates[rbr];
+      }
+    }
+  }
+}
+
+void SimDS2480B::data(uint8_t value) {
+  if (accelerator) {
+    // four ROM bits per byte: read id bit and complement, then write the chosen bit.
+    int64_t done = busOperation(12 * slotTime());
+    uint8_t result = 0;
+    stats.busBits += 12;
+
+    for (uint8_t i = 0; i < 4; i++) {
+      bool direction = (value >> (i * 2 + 1)) & 1;
+      bool idBit = bus.transferBit(1, overdriveSpeed);
+      bool cmpBit = bus.transferBit(1, overdriveSpeed);
+      bool discrepancy = idBit == cmpBit;
+      bool chosen = discrepancy ? direction : idBit;
+
+      bus.transferBit(chosen, overdriveSpeed);
+      if (discrepancy) result |= 1 << (i * 2);
+      if (chosen) result |= 1 << (i * 2 + 1);
+    }
+    reply(result, done);
+  } else {
+    int64_t done = busOperation(8 * slotTime());
+    stats.busBits += 8;
+    uint8_t result = bus.transferByte(value, overdriveSpeed);
+    reply(value == 0xFF ? corrupt(result) : result, done);
+  }
+}
+
+//
+// SimDS2484
+//
+SimDS2484::SimDS2484(SimBus &bus, uint8_t address, uint32_t seed) : bus(bus), address(address), rng(seed) {}
+
+void SimDS2484::beginTransmission(uint8_t address) {
+  txAddress = address;
+  txBuffer.clear();
+}
+
+size_t SimDS2484::write(uint8_t value) {
+  txBuffer.push_back(value);
+  return 1;
+}
+
+uint8_t SimDS2484::endTransmission(bool sendStop) {
+  transfer(txBuffer.size());
+  if (!connected || txAddress != address) return 2;
+
+  stats.hostBytes += txBuffer.size();
+  return command(txBuffer) ? 0 : 3;
+}
+
+uint8_t SimDS2484::requestFrom(uint8_t address, uint8_t quantity) {
+  transfer(quantity);
+  rxBuffer.clear();
+  if (!connected || address != this->address) return 0;
+
+  for (uint8_t i = 0; i < quantity; i++) rxBuffer.push_back(readRegister());
+  stats.replyBytes += quantity;
+  return quantity;
+}
+
+int SimDS2484::read() {
+  if (rxBuffer.empty()) return -1;
+
+  uint8_t value = rxBuffer.front();
+  rxBuffer.pop_front();
+  return value;
+}
+
+uint8_t SimDS2484::readRegister() const {
+  switch (readPointer) {
+    case 0xF0:
+      return statusRegister | (busy() ? 0x01 : 0x00);
+    case 0xE1:
+      return dataRegister;
+    case 0xC3:
+      return config;
+    default:
+      return 0x00;
+  }
+}
+
+void SimDS2484::busOperation(int64_t duration) {
+  bus.setTime(native::clock());
+  // the next 1-Wire command ends the strong pullup, which also clears SPU.
+  if (bus.isStrongPullup()) config &= ~0x04;
+  bus.setStrongPullup(false);
+  busyUntil = native::clock() + duration;
+}
+
+bool SimDS2484::command(const std::vector<uint8_t> &bytes) {
+  if (bytes.empty()) return true;
+
+  uint8_t cmd = bytes[0];
+  bool hasParam = bytes.size() > 1;
+  uint8_t param = hasParam ? bytes[1] : 0;
+
+  // only the read pointer can be moved while a 1-Wire command is running.
+  if (busy() && cmd != 0xE1) return false;
+
+  switch (cmd) {
+    case 0xF0:  // device reset
+      config = 0;
+      statusRegister = 0x10;
+      bus.setStrongPullup(false);
+      readPointer = 0xF0;
+      return true;
+    case 0xE1:  // set read pointer
+      if (!hasParam || (param != 0xF0 && param != 0xE1 && param != 0xC3 && param != 0xB4)) return false;
+      readPointer = param;
+      return true;
+    case 0xD2:  // write configuration, upper nibble is the complement of the lower
+      if (!hasParam || ((param >> 4) ^ 0x0F) != (param & 0x0F)) return false;
+      config = param & 0x0F;
+      if (!(config & 0x04)) bus.setStrongPullup(false);
+      statusRegister &= ~0x10;
+      readPointer = 0xC3;
+      return true;
+    case 0xC3:  // adjust 1-Wire port, accepted but not simulated
+      readPointer = 0xB4;
+      return hasParam;
+    case 0xB4: {  // 1-Wire reset
+      busOperation(overdriveSpeed() ? SIM_RESET_OVERDRIVE_US : SIM_RESET_US);
+      stats.resets++;
+      uint8_t presence = bus.reset(overdriveSpeed());
+      statusRegister &= ~0x0E;
+      if (presence == 0) statusRegister |= 0x04;                  // SD
+      if (presence == 1 || presence == 2) statusRegister |= 0x02;  // PPD
+      readPointer = 0xF0;
+      return true;
+    }
+    case 0x87: {  // 1-Wire single bit
+      if (!hasParam) return false;
+      busOperation(slotTime());
+      stats.busBits++;
+      bool bit = bus.transferBit(param & 0x80, overdriveSpeed());
+      statusRegister = (statusRegister & ~0x20) | (bit ? 0x20 : 0x00);
+      if (config & 0x04) bus.setStrongPullup(true);
+      readPointer = 0xF0;
+      return true;
+    }
+    case 0xA5:  // 1-Wire write byte
+      if (!hasParam) return false;
+      busOperation(8 * slotTime());
+      stats.busBits += 8;
+      bus.transferByte(param, overdriveSpeed());
+      if (config & 0x04) bus.setStrongPullup(true);
+      readPointer = 0xF0;
+      return true;
+    case 0x96: {  // 1-Wire read byte
+      busOperation(8 * slotTime());
+      stats.busBits += 8;
+      dataRegister = bus.transferByte(0xFF, overdriveSpeed());
+      if (corruptCount > 0) {
+        corruptCount--;
+        dataRegister ^= 1 << (rng() % 8);
+      }
+      if (config & 0x04) bus.setStrongPullup(true);
+      readPointer = 0xF0;
+      return true;
+    }
+    case 0x78: {  // 1-Wire triplet: id bit, complement, then write the chosen direction
+      if (!hasParam) return false;
+      busOperation(3 * slotTime());
+      stats.busBits += 3;
+      bool idBit = bus.transferBit(1, overdriveSpeed());
+      bool cmpBit = bus.transferBit(1, overdriveSpeed());
+      bool direction = idBit == cmpBit ? (param & 0x80) : idBit;
+      // with no device answering both bits read 1, the DS2484 then writes a 1.
+      if (idBit && cmpBit) direction = true;
+      bus.transferBit(direction, overdriveSpeed());
+      statusRegister = (statusRegister & ~0xE0) | (idBit ? 0x20 : 0) | (cmpBit ? 0x40 : 0) | (direction ? 0x80 : 0);
+      readPointer = 0xF0;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
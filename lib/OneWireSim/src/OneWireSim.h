@@ -0,0 +1,290 @@
+#ifndef OneWireSim_h
+#define OneWireSim_h
+
+#include <HardwareSerial.h>
+#include <Wire.h>
+#include <deque>
+#include <random>
+#include <vector>
+
+//
+// Host-side simulator of a DS2480B serial 1-Wire line driver, a DS2484 I2C 1-Wire master and
+// the devices on their bus, byte accurate on the UART and I2C side so the bus master libraries
+// can run unmodified against it.
+// See https://datasheets.maximintegrated.com/en/ds/DS2480B.pdf, AN192 and
+// https://datasheets.maximintegrated.com/en/ds/DS2484.pdf.
+//
+
+// 1-Wire time slots in microseconds, standard / overdrive speed.
+#define SIM_RESET_US 1100
+#define SIM_RESET_OVERDRIVE_US 150
+#define SIM_BIT_US 70
+#define SIM_BIT_OVERDRIVE_US 10
+
+class SimBus;
+
+/**
+ * A device on the simulated 1-Wire bus, implements the ROM function layer
+ * (MATCH, SKIP, SEARCH, RESUME, overdrive...) at bit level. Subclasses implement the
+ * device's function commands, by default byte by byte through functionReset(),
+ * functionRead() and functionWrite().
+ */
+class SimDevice {
+ private:
+  enum RomState : uint8_t { ROM_IDLE, ROM_COMMAND, ROM_MATCH, ROM_SEARCH, ROM_READ, ROM_FUNCTION };
+
+  RomState romState = ROM_IDLE;
+  bool overdrive = false;
+  bool resumeFlag = false;
+  uint8_t bitIndex = 0;     // bit within the ROM or the current byte
+  uint8_t searchPhase = 0;  // 0 = id bit, 1 = complement, 2 = direction
+  uint8_t inByte = 0;
+  uint8_t outByte = 0xFF;
+
+  bool romBit(uint8_t i) const { return (rom[i / 8] >> (i % 8)) & 1; }
+  void romByteReceived(uint8_t command);
+
+ protected:
+  SimBus *bus = nullptr;
+
+  // Function command layer, called once the device has been selected.
+  virtual void functionReset() {}
+  // Called when a MATCH ROM has selected the device, e.g. the DS2405 toggles its output.
+  virtual void functionMatched() {}
+  // Byte the device drives onto the bus during the next byte, 0xFF to only listen.
+  virtual uint8_t functionRead() { return 0xFF; }
+  // Byte seen on the bus, wired-AND of the master and all devices.
+  virtual void functionWrite(uint8_t value) {}
+
+  // Bit level access to the function layer, override for read slots that aren't byte aligned,
+  // e.g. polling for a finished temperature conversion.
+  virtual bool functionDriveBit();
+  virtual void functionSampleBit(bool value);
+
+  int64_t now() const;
+
+ public:
+  uint8_t rom[8];
+
+  SimDevice(const uint8_t id[8]);
+  virtual ~SimDevice() {}
+
+  void attach(SimBus *bus) { this->bus = bus; }
+
+  virtual bool supportsOverdrive() const { return false; }
+  // Responds to ALARM SEARCH.
+  virtual bool isAlarming() { return false; }
+
+  bool isOverdrive() const { return overdrive; }
+  bool isSelected() const { return romState == ROM_FUNCTION; }
+  // Not taking part until the next reset, e.g. not matching the ROM of a MATCH ROM.
+  bool isIdle() const { return romState == ROM_IDLE; }
+
+  // Reset pulse at the given speed, returns true if the device answers with a presence pulse.
+  bool reset(bool overdriveSpeed);
+  // Value the device pulls the bus to during the next time slot (true = released).
+  bool driveBit();
+  // Value of the bus during the time slot.
+  void sampleBit(bool value);
+
+  // Build a valid ROM with a CRC for the family code and serial number.
+  static void makeRom(uint8_t family, uint64_t serial, uint8_t rom[8]);
+  static uint8_t crc8(const uint8_t *data, uint8_t len);
+  static uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc = 0);
+};
+
+/**
+ * The 1-Wire bus, wired-AND of the master and all attached devices.
+ */
+class SimBus {
+ private:
+  std::vector<SimDevice *> devices;
+  bool shorted = false;
+  bool overdriveSpeed = false;
+  bool strongPullup = false;
+  int64_t time = 0;
+
+  bool participates(SimDevice *device) const { return !device->isIdle() && device->isOverdrive() == overdriveSpeed; }
+
+ public:
+  // Devices are owned by the caller.
+  void attach(SimDevice *device);
+  void detach(SimDevice *device);
+  void clear() { devices.clear(); }
+  const std::vector<SimDevice *> &getDevices() const { return devices; }
+
+  void setShorted(bool shorted) { this->shorted = shorted; }
+
+  // Bus held at a strong pullup by the master, e.g. to power a parasite conversion.
+  void setStrongPullup(bool on) { strongPullup = on; }
+  bool isStrongPullup() const { return strongPullup; }
+
+  // Bus time of the time slot in progress, devices use it for conversion timing.
+  int64_t now() const { return time; }
+  void setTime(int64_t time) { this->time = time; }
+
+  // Reset pulse, returns the DS2480B presence code: 0 shorted, 1 presence, 2 alarming presence, 3 no presence.
+  uint8_t reset(bool overdriveSpeed);
+  // One time slot, the master writes bit (1 = read slot). Returns the bus value.
+  bool transferBit(bool bit, bool overdriveSpeed);
+  uint8_t transferByte(uint8_t value, bool overdriveSpeed);
+};
+
+// Simulator counters, for checking round trips and bus usage in tests and benchmarks.
+struct SimStats {
+  uint32_t hostBytes = 0;   // bytes received from the host (I2C: written, without the address byte)
+  uint32_t replyBytes = 0;  // bytes sent to the host (I2C: read)
+  uint32_t resets = 0;      // 1-Wire reset pulses
+  uint32_t busBits = 0;     // 1-Wire time slots, including search accelerator slots
+  uint32_t masterResets = 0;
+};
+
+/**
+ * DS2480B as seen by the host UART: command, data and check mode, configuration,
+ * reset, single bit and search accelerator commands. Every byte is timestamped, the
+ * reply is available to the host when the UART transfers and 1-Wire time slots
+ * before it would have finished, in simulated time (native::clock()).
+ */
+class SimDS2480B : public HardwareSerial {
+ private:
+  enum Mode : uint8_t { MODE_COMMAND, MODE_DATA, MODE_CHECK };
+
+  struct Reply {
+    int64_t ready;
+    uint8_t value;
+  };
+
+  SimBus &bus;
+  Mode mode = MODE_COMMAND;
+  bool accelerator = false;
+  bool overdriveSpeed = false;
+  bool calibrated = false;   // first byte after a master reset is the timing byte
+  bool connected = true;
+  uint32_t hostBaud = 9600;
+  uint32_t chipBaud = 9600;
+  uint32_t maxBaud = 115200;
+  uint8_t rbr = 0;
+
+  int64_t txFree = 0;     // host to DS2480B line busy until
+  int64_t chipFree = 0;   // 1-Wire bus busy until
+  int64_t rxFree = 0;     // DS2480B to host line busy until
+  int64_t arrived = 0;    // when the byte being processed reached the DS2480B
+  std::vector<Reply> replies;  // from replyHead on not yet read, the storage is reused like a UART buffer.
+  size_t replyHead = 0;
+
+  uint32_t corruptCount = 0;
+  uint32_t dropCount = 0;
+  double errorRate = 0;
+  std::mt19937 rng;
+  SimStats stats;
+
+  int64_t byteTime(uint32_t baud) const { return 10 * 1000000LL / baud; }
+  int64_t slotTime() const { return overdriveSpeed ? SIM_BIT_OVERDRIVE_US : SIM_BIT_US; }
+  // Run count time slots (or a reset) on the bus, returns when they are done.
+  int64_t busOperation(int64_t duration);
+  void reply(uint8_t value, int64_t ready);
+  uint8_t corrupt(uint8_t value);
+
+  void receive(uint8_t value);
+  void command(uint8_t value);
+  void data(uint8_t value);
+  void masterReset();
+
+ public:
+  SimDS2480B(SimBus &bus, uint32_t seed = 1);
+
+  // HardwareSerial
+  int available() override;
+  int read() override;
+  size_t write(uint8_t value) override;
+  size_t write(const uint8_t *buf, size_t len) override;
+  void flush() override;
+  void updateBaudRate(unsigned long baud) override { hostBaud = baud; }
+
+  // Highest baud rate that works on the host link, faster rates garble every byte.
+  void setMaxBaudRate(uint32_t baud) { maxBaud = baud; }
+  uint32_t getChipBaudRate() const { return chipBaud; }
+  // A disconnected DS2480B never answers.
+  void setConnected(bool connected) { this->connected = connected; }
+
+  // Flip one bit in each of the next count bytes read from the 1-Wire bus, the bytes
+  // the host sends as 0xFF in data mode.
+  void corruptNext(uint32_t count) { corruptCount = count; }
+  // Flip one bit in bytes read from the 1-Wire bus with the given probability.
+  void setErrorRate(double probability) { errorRate = probability; }
+  // Lose the next count reply bytes on the way to the host.
+  void dropNext(uint32_t count) { dropCount = count; }
+
+  bool isCommandMode() const { return mode == MODE_COMMAND; }
+  bool isOverdriveSpeed() const { return overdriveSpeed; }
+
+  const SimStats &getStats() const { return stats; }
+  void resetStats() { stats = SimStats(); }
+};
+
+/**
+ * DS2484 as seen by the host I2C master: device reset, read pointer, configuration and the
+ * 1-Wire reset, bit, byte and triplet commands. A 1-Wire command runs on the bus at once but
+ * the status register shows the DS2484 busy (1WB) until it would have finished, and every
+ * I2C transfer moves simulated time forward by its duration at the I2C clock.
+ */
+class SimDS2484 : public TwoWire {
+ private:
+  SimBus &bus;
+  uint8_t address;
+  uint32_t clock = 100000;
+  bool connected = true;
+
+  uint8_t config = 0;
+  uint8_t statusRegister = 0x10;  // RST after power up
+  uint8_t dataRegister = 0;
+  uint8_t readPointer = 0xF0;
+  int64_t busyUntil = 0;
+
+  uint8_t txAddress = 0;
+  std::vector<uint8_t> txBuffer;
+  std::deque<uint8_t> rxBuffer;
+
+  uint32_t corruptCount = 0;
+  std::mt19937 rng;
+  SimStats stats;
+
+  bool overdriveSpeed() const { return config & 0x08; }
+  int64_t slotTime() const { return overdriveSpeed() ? SIM_BIT_OVERDRIVE_US : SIM_BIT_US; }
+  bool busy() const { return native::clock() < busyUntil; }
+  // The I2C transfer of count bytes, plus the address byte.
+  void transfer(size_t count) { native::advance((count + 1) * 9 * 1000000LL / clock); }
+  // Start a 1-Wire command taking duration, ends any strong pullup.
+  void busOperation(int64_t duration);
+  bool command(const std::vector<uint8_t> &bytes);
+  uint8_t readRegister() const;
+
+ public:
+  SimDS2484(SimBus &bus, uint8_t address = 0x18, uint32_t seed = 1);
+
+  // TwoWire
+  bool setClock(uint32_t frequency) override {
+    clock = frequency;
+    return true;
+  }
+  uint32_t getClock() override { return clock; }
+  void beginTransmission(uint8_t address) override;
+  size_t write(uint8_t value) override;
+  uint8_t endTransmission(bool sendStop = true) override;
+  uint8_t requestFrom(uint8_t address, uint8_t quantity) override;
+  int available() override { return rxBuffer.size(); }
+  int read() override;
+
+  // A disconnected DS2484 never acknowledges its address.
+  void setConnected(bool connected) { this->connected = connected; }
+  // Flip one bit in each of the next count bytes read by the 1-Wire read byte command.
+  void corruptNext(uint32_t count) { corruptCount = count; }
+
+  bool isOverdriveSpeed() const { return overdriveSpeed(); }
+  uint8_t getConfig() const { return config; }
+
+  const SimStats &getStats() const { return stats; }
+  void resetStats() { stats = SimStats(); }
+};
+
+#endif
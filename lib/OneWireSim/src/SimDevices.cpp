@@ -0,0 +1,703 @@
+#include "SimDevices.h"
+
+//
+// SimDS18x20
+//
+SimDS18x20::SimDS18x20(const uint8_t id[8], bool parasite) : SimDevice(id), parasite(parasite) {
+  // power-on value of the temperature register is 85 degrees.
+  scratchpad[0] = isS20() ? 0xAA : 0x50;
+  scratchpad[1] = isS20() ? 0x00 : 0x05;
+  scratchpad[2] = eeprom[0];
+  scratchpad[3] = eeprom[1];
+  scratchpad[4] = isS20() ? 0xFF : eeprom[2];
+  scratchpad[5] = 0xFF;
+  scratchpad[6] = 0x0C;
+  scratchpad[7] = 0x10;
+  scratchpad[8] = crc8(scratchpad, 8);
+}
+
+int64_t SimDS18x20::conversionTime() const {
+  if (isS20()) return 750000;
+  return 93750LL << ((scratchpad[4] >> 5) & 0x03);
+}
+
+void SimDS18x20::update() {
+  if (converting && now() >= conversionDone) {
+    converting = false;
+    latchTemperature();
+  }
+}
+
+void SimDS18x20::latchTemperature() {
+  int16_t raw;
+
+  if (isS20()) {
+    // half degrees, the fraction is given by COUNT_REMAIN.
+    raw = lround(temperature * 2);
+    scratchpad[6] = 12 - lround((temperature - (raw >> 1)) * 16);
+  } else {
+    // 1/16 degrees, the undefined low bits at lower resolution are zeroed.
+    raw = lround(temperature * 16);
+    raw &= ~((1 << (3 - ((scratchpad[4] >> 5) & 0x03))) - 1);
+  }
+
+  scratchpad[0] = raw & 0xFF;
+  scratchpad[1] = raw >> 8;
+  scratchpad[8] = crc8(scratchpad, 8);
+
+  int8_t whole = (int8_t)floor(temperature);
+  alarm = whole >= (int8_t)scratchpad[2] || whole <= (int8_t)scratchpad[3];
+  conversions++;
+}
+
+bool SimDS18x20::isAlarming() {
+  update();
+  return alarm;
+}
+
+uint8_t SimDS18x20::functionRead() {
+  if (state == FN_READ_SCRATCHPAD && index < sizeof(scratchpad)) {
+    // a conversion ending halfway through a read shows up in the next one, not as a torn scratchpad.
+    if (index == 0) update();
+    return scratchpad[index];
+  }
+  return 0xFF;
+}
+
+void SimDS18x20::functionWrite(uint8_t value) {
+  switch (state) {
+    case FN_COMMAND:
+      index = 0;
+      switch (value) {
+        case 0x44:  // Convert T
+          update();
+          converting = true;
+          conversionDone = now() + conversionTime();
+          state = FN_READ_SLOTS;
+          break;
+        case 0xBE:  // Read Scratchpad
+          state = FN_READ_SCRATCHPAD;
+          break;
+        case 0x4E:  // Write Scratchpad
+          state = FN_WRITE_SCRATCHPAD;
+          break;
+        case 0x48:  // Copy Scratchpad
+          eeprom[0] = scratchpad[2];
+          eeprom[1] = scratchpad[3];
+          if (!isS20()) eeprom[2] = scratchpad[4];
+          state = FN_READ_SLOTS;
+          break;
+        case 0xB8:  // Recall E2
+          scratchpad[2] = eeprom[0];
+          scratchpad[3] = eeprom[1];
+          if (!isS20()) scratchpad[4] = eeprom[2];
+          scratchpad[8] = crc8(scratchpad, 8);
+          state = FN_READ_SLOTS;
+          break;
+        case 0xB4:  // Read Power Supply
+          state = FN_POWER_SUPPLY;
+          break;
+        default:
+          state = FN_IDLE;
+          break;
+      }
+      break;
+
+    case FN_READ_SCRATCHPAD:
+      index++;
+      break;
+
+    case FN_WRITE_SCRATCHPAD:
+      // TH, TL and, for the DS18B20, the resolution bits of the configuration register.
+      if (index < 2) {
+        scratchpad[2 + index] = value;
+      } else if (index == 2 && !isS20()) {
+        scratchpad[4] = (value & 0x60) | 0x1F;
+      }
+      index++;
+      scratchpad[8] = crc8(scratchpad, 8);
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool SimDS18x20::functionDriveBit() {
+  switch (state) {
+    case FN_READ_SLOTS:
+      // an externally powered device answers read slots with 0 while converting, a parasite powered can't.
+      update();
+      return parasite || !converting;
+    case FN_POWER_SUPPLY:
+      return !parasite;
+    default:
+      return SimDevice::functionDriveBit();
+  }
+}
+
+void SimDS18x20::functionSampleBit(bool value) {
+  if (state != FN_READ_SLOTS && state != FN_POWER_SUPPLY) SimDevice::functionSampleBit(value);
+}
+
+//
+// SimDS2408
+//
+uint8_t SimDS2408::getRegister(uint16_t address) const {
+  switch (address) {
+    case 0x88:
+      return pio();
+    case 0x89:
+      return latch;
+    case 0x8A:
+      return activity;
+    case 0x8B:
+      return conditionalMask;
+    case 0x8C:
+      return conditionalPolarity;
+    case 0x8D:
+      return control;
+    default:
+      return 0xFF;
+  }
+}
+
+void SimDS2408::setPio(uint8_t newLatch, uint8_t newInputs) {
+  uint8_t before = pio();
+  latch = newLatch;
+  inputs = newInputs;
+  activity |= before ^ pio();
+}
+
+bool SimDS2408::isAlarming() {
+  // the power-on reset latch makes the device respond until cleared.
+  if (control & 0x08) return true;
+  if (conditionalMask == 0) return false;
+
+  uint8_t source = (control & 0x01) ? activity : pio();
+  uint8_t matching = ~(source ^ conditionalPolarity) & conditionalMask;
+  return (control & 0x02) ? matching == conditionalMask : matching != 0;
+}
+
+uint8_t SimDS2408::functionRead() {
+  switch (state) {
+    case FN_READ_REGISTERS:
+      return getRegister(address);
+    case FN_CRC:
+      return index == 0 ? ~crc & 0xFF : ~crc >> 8;
+    case FN_CHANNEL_READ:
+      return pio();
+    case FN_WRITE_CONFIRM:
+    case FN_CONFIRM:
+      return 0xAA;
+    case FN_WRITE_PIO:
+      return pio();
+    default:
+      return 0xFF;
+  }
+}
+
+void SimDS2408::functionWrite(uint8_t value) {
+  if (state != FN_CRC) crc = crc16(&value, 1, crc);
+
+  switch (state) {
+    case FN_COMMAND:
+      command = value;
+      index = 0;
+      address = 0;
+      crc = crc16(&value, 1);
+      switch (value) {
+        case 0xF0:  // Read PIO Registers
+        case 0xCC:  // Write Conditional Search Register
+          state = FN_ADDRESS;
+          break;
+        case 0xF5:  // Channel-Access Read
+          state = FN_CHANNEL_READ;
+          break;
+        case 0x5A:  // Channel-Access Write
+          state = FN_WRITE_DATA;
+          break;
+        case 0xC3:  // Reset Activity Latches
+          activity = 0;
+          state = FN_CONFIRM;
+          break;
+        default:
+          state = FN_IDLE;
+          break;
+      }
+      break;
+
+    case FN_ADDRESS:
+      address |= value << (index * 8);
+      if (++index == 2) {
+        index = 0;
+        state = command == 0xF0 ? FN_READ_REGISTERS : FN_WRITE_CONDITIONAL;
+      }
+      break;
+
+    case FN_READ_REGISTERS:
+      // registers up to 8Fh, then the inverted CRC16 of the command, address and data.
+      if (++address > 0x8F) state = FN_CRC;
+      break;
+
+    case FN_CRC:
+      if (++index == 2) {
+        // following reads are 1s, a new CRC16 would follow a Channel-Access Read block.
+        state = command == 0xF5 ? FN_CHANNEL_READ : FN_IDLE;
+        index = 0;
+        crc = 0;
+      }
+      break;
+
+    case FN_CHANNEL_READ:
+      // CRC16 after every 32 samples.
+      if (++index == 32) {
+        index = 0;
+        state = FN_CRC;
+      }
+      break;
+
+    case FN_WRITE_DATA:
+      written = value;
+      state = FN_WRITE_INVERTED;
+      break;
+
+    case FN_WRITE_INVERTED:
+      if ((uint8_t)~value == written) {
+        setPio(written, inputs);
+        channelWrites++;
+        state = FN_WRITE_CONFIRM;
+      } else {
+        state = FN_IDLE;
+      }
+      break;
+
+    case FN_WRITE_CONFIRM:
+      state = FN_WRITE_PIO;
+      break;
+
+    case FN_WRITE_PIO:
+      state = FN_WRITE_DATA;
+      break;
+
+    case FN_WRITE_CONDITIONAL:
+      if (address == 0x8B) {
+        conditionalMask = value;
+      } else if (address == 0x8C) {
+        conditionalPolarity = value;
+      } else if (address == 0x8D) {
+        // PLS, CT and ROS are writable, PORL is cleared by writing 0.
+        control = (control & 0x80) | (value & 0x07) | (control & value & 0x08);
+      } else {
+        state = FN_IDLE;
+      }
+      address++;
+      break;
+
+    default:
+      break;
+  }
+}
+
+//
+// SimDS2423
+//
+uint8_t SimDS2423::counterByte() const {
+  uint8_t page = address / 32;
+  uint32_t counter = page >= 12 ? counters[page - 12] : 0xFFFFFFFF;
+  return counter >> (index * 8);
+}
+
+uint8_t SimDS2423::functionRead() {
+  switch (state) {
+    case FN_DATA:
+      return memory[address];
+    case FN_COUNTER:
+      return counterByte();
+    case FN_ZEROS:
+      return 0x00;
+    case FN_CRC:
+      return index == 0 ? ~crc & 0xFF : ~crc >> 8;
+    default:
+      return 0xFF;
+  }
+}
+
+void SimDS2423::functionWrite(uint8_t value) {
+  if (state != FN_CRC) crc = crc16(&value, 1, crc);
+
+  switch (state) {
+    case FN_COMMAND:
+      command = value;
+      index = 0;
+      address = 0;
+      crc = crc16(&value, 1);
+      state = (value == 0xA5 || value == 0xF0) ? FN_ADDRESS : FN_IDLE;
+      break;
+
+    case FN_ADDRESS:
+      address |= value << (index * 8);
+      if (++index == 2) {
+        index = 0;
+        address &= 0x1FF;
+        state = FN_DATA;
+      }
+      break;
+
+    case FN_DATA:
+      // Read Memory + Counter continues with the counter at the end of each page.
+      address++;
+      if (command == 0xA5 && address % 32 == 0) {
+        address--;
+        state = FN_COUNTER;
+      } else if (address >= sizeof(memory)) {
+        state = FN_IDLE;
+      }
+      break;
+
+    case FN_COUNTER:
+      if (++index == 4) {
+        index = 0;
+        state = FN_ZEROS;
+      }
+      break;
+
+    case FN_ZEROS:
+      if (++index == 4) {
+        index = 0;
+        state = FN_CRC;
+      }
+      break;
+
+    case FN_CRC:
+      if (++index == 2) {
+        // the next page follows, its CRC16 only covers the page, counter and zeros.
+        index = 0;
+        crc = 0;
+        address++;
+        state = address < sizeof(memory) ? FN_DATA : FN_IDLE;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+//
+// SimDS2450
+//
+SimDS2450::SimDS2450(const uint8_t id[8]) : SimDevice(id) {
+  // power-on values: 8 bits resolution, 2.56 V input range and the power-on reset flag set.
+  for (uint8_t channel = 0; channel < 4; channel++) {
+    memory[8 + channel * 2] = 0x08;
+    memory[9 + channel * 2] = 0x8C;
+    memory[16 + channel * 2] = 0x00;
+    memory[17 + channel * 2] = 0xFF;
+  }
+}
+
+int64_t SimDS2450::conversionTime(uint8_t mask) const {
+  int64_t time = 160;
+  for (uint8_t channel = 0; channel < 4; channel++) {
+    if (mask & (1 << channel)) {
+      uint8_t bits = memory[8 + channel * 2] & 0x0F;
+      time += 80 * (bits == 0 ? 16 : bits);
+    }
+  }
+  return time;
+}
+
+void SimDS2450::update() {
+  if (converting && now() >= conversionDone) {
+    converting = false;
+    latchResults();
+  }
+}
+
+void SimDS2450::latchResults() {
+  for (uint8_t channel = 0; channel < 4; channel++) {
+    if (!(convertMask & (1 << channel))) continue;
+
+    uint8_t bits = memory[8 + channel * 2] & 0x0F;
+    float range = (memory[9 + channel * 2] & 0x01) ? 5.12 : 2.56;
+    double scaled = inputs[channel] / range * 65536;
+    uint16_t result = scaled < 0 ? 0 : scaled > 65535 ? 65535 : (uint16_t)scaled;
+
+    // left aligned, the bits below the resolution are 0.
+    result &= 0xFFFF << (16 - (bits == 0 ? 16 : bits));
+    memory[channel * 2] = result & 0xFF;
+    memory[channel * 2 + 1] = result >> 8;
+  }
+  conversions++;
+}
+
+uint8_t SimDS2450::functionRead() {
+  switch (state) {
+    case FN_READ_DATA:
+      update();
+      return memory[address];
+    case FN_READ_CRC:
+    case FN_WRITE_CRC:
+    case FN_CONVERT_CRC:
+      return index == 0 ? ~crc & 0xFF : ~crc >> 8;
+    case FN_WRITE_READBACK:
+      return memory[address];
+    default:
+      return 0xFF;
+  }
+}
+
+void SimDS2450::functionWrite(uint8_t value) {
+  if (state != FN_READ_CRC && state != FN_WRITE_CRC && state != FN_CONVERT_CRC && state != FN_WRITE_READBACK) {
+    crc = crc16(&value, 1, crc);
+  }
+
+  switch (state) {
+    case FN_COMMAND:
+      command = value;
+      index = 0;
+      address = 0;
+      crc = crc16(&value, 1);
+      switch (value) {
+        case 0xAA:  // Read Memory
+        case 0x55:  // Write Memory
+          state = FN_ADDRESS;
+          break;
+        case 0x3C:  // Convert
+          state = FN_CONVERT_MASK;
+          break;
+        default:
+          state = FN_IDLE;
+          break;
+      }
+      break;
+
+    case FN_ADDRESS:
+      address |= value << (index * 8);
+      if (++index == 2) {
+        index = 0;
+        address &= 0x1F;
+        state = command == 0xAA ? FN_READ_DATA : FN_WRITE_DATA;
+      }
+      break;
+
+    case FN_READ_DATA:
+      // the inverted CRC16 follows at the end of each page.
+      if (++address % 8 == 0) state = FN_READ_CRC;
+      break;
+
+    case FN_READ_CRC:
+      if (++index == 2) {
+        // the next page follows, its CRC16 only covers the page.
+        index = 0;
+        crc = 0;
+        state = address < sizeof(memory) ? FN_READ_DATA : FN_IDLE;
+      }
+      break;
+
+    case FN_WRITE_DATA:
+      // only the control/status, alarm and the VCC flag of the calibration page are writable, AFL/AFH are read only.
+      if (address >= 8 && address < 16) {
+        memory[address] = address % 2 == 0 ? value & 0xCF : (memory[address] & 0x30) | (value & 0x8D);
+      } else if (address >= 16 && address < 24) {
+        memory[address] = value;
+      } else if (address == 0x1C) {
+        memory[address] = value & 0x40;
+      }
+      state = FN_WRITE_CRC;
+      break;
+
+    case FN_WRITE_CRC:
+      if (++index == 2) {
+        index = 0;
+        state = FN_WRITE_READBACK;
+      }
+      break;
+
+    case FN_WRITE_READBACK: {
+      // the CRC16 of the next byte covers the incremented address and the byte.
+      address++;
+      uint8_t next[2] = {(uint8_t)(address & 0xFF), (uint8_t)(address >> 8)};
+      crc = crc16(next, 2);
+      state = address < sizeof(memory) ? FN_WRITE_DATA : FN_IDLE;
+      break;
+    }
+
+    case FN_CONVERT_MASK:
+      convertMask = value & 0x0F;
+      state = FN_CONVERT_CONTROL;
+      break;
+
+    case FN_CONVERT_CONTROL:
+      convertControl = value;
+      state = FN_CONVERT_CRC;
+      break;
+
+    case FN_CONVERT_CRC:
+      if (++index == 2) {
+        index = 0;
+        // the results of the converted channels are preset to all 0s or 1s, then the conversion starts.
+        for (uint8_t channel = 0; channel < 4; channel++) {
+          uint8_t preset = (convertControl >> (channel * 2)) & 0x03;
+          if ((convertMask & (1 << channel)) && (preset == 1 || preset == 2)) {
+            memory[channel * 2] = memory[channel * 2 + 1] = preset == 1 ? 0x00 : 0xFF;
+          }
+        }
+        update();
+        converting = true;
+        conversionDone = now() + conversionTime(convertMask);
+        state = FN_READ_SLOTS;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool SimDS2450::functionDriveBit() {
+  if (state == FN_READ_SLOTS) {
+    // read slots are answered with 0 while converting, when VCC powered.
+    update();
+    return !converting;
+  }
+  return SimDevice::functionDriveBit();
+}
+
+void SimDS2450::functionSampleBit(bool value) {
+  if (state != FN_READ_SLOTS) SimDevice::functionSampleBit(value);
+}
+
+//
+// SimDS2413
+//
+uint8_t SimDS2413::status() const {
+  uint8_t pins = latch & inputs;
+  uint8_t value = (pins & 0x01) | (latch & 0x01) << 1 | (pins & 0x02) << 1 | (latch & 0x02) << 2;
+  return value | (~value & 0x0F) << 4;
+}
+
+uint8_t SimDS2413::functionRead() {
+  switch (state) {
+    case FN_READ_STATUS:
+    case FN_WRITE_STATUS:
+      return status();
+    case FN_WRITE_CONFIRM:
+      return 0xAA;
+    default:
+      return 0xFF;
+  }
+}
+
+void SimDS2413::functionWrite(uint8_t value) {
+  switch (state) {
+    case FN_COMMAND:
+      if (value == 0xF5) {  // PIO Access Read, the status is repeated until the next reset
+        state = FN_READ_STATUS;
+      } else if (value == 0x5A) {  // PIO Access Write
+        state = FN_WRITE_DATA;
+      } else {
+        state = FN_IDLE;
+      }
+      break;
+
+    case FN_WRITE_DATA:
+      written = value;
+      state = FN_WRITE_INVERTED;
+      break;
+
+    case FN_WRITE_INVERTED:
+      // bits 2-7 of the data have to be 1s.
+      if ((uint8_t)~value == written && (written & 0xFC) == 0xFC) {
+        latch = written & 0x03;
+        writes++;
+        state = FN_WRITE_CONFIRM;
+      } else {
+        state = FN_IDLE;
+      }
+      break;
+
+    case FN_WRITE_CONFIRM:
+      state = FN_WRITE_STATUS;
+      break;
+
+    case FN_WRITE_STATUS:
+      state = FN_WRITE_DATA;
+      break;
+
+    default:
+      break;
+  }
+}
+
+//
+// SimDS2406
+//
+uint8_t SimDS2406::functionRead() {
+  switch (state) {
+    case FN_READ_DATA:
+    case FN_WRITE_READBACK:
+      return status[address];
+    case FN_READ_CRC:
+    case FN_WRITE_CRC:
+      return index == 0 ? ~crc & 0xFF : ~crc >> 8;
+    default:
+      return 0xFF;
+  }
+}
+
+void SimDS2406::functionWrite(uint8_t value) {
+  if (state != FN_READ_CRC && state != FN_WRITE_CRC && state != FN_WRITE_READBACK) crc = crc16(&value, 1, crc);
+
+  switch (state) {
+    case FN_COMMAND:
+      command = value;
+      index = 0;
+      address = 0;
+      crc = crc16(&value, 1);
+      state = (value == 0xAA || value == 0x55) ? FN_ADDRESS : FN_IDLE;
+      break;
+
+    case FN_ADDRESS:
+      address |= value << (index * 8);
+      if (++index == 2) {
+        index = 0;
+        address &= 0x07;
+        state = command == 0xAA ? FN_READ_DATA : FN_WRITE_DATA;
+      }
+      break;
+
+    case FN_READ_DATA:
+      // the CRC16 follows the last byte of the status memory.
+      if (++address == sizeof(status)) state = FN_READ_CRC;
+      break;
+
+    case FN_READ_CRC:
+      if (++index == 2) state = FN_IDLE;
+      break;
+
+    case FN_WRITE_DATA:
+      // only byte 7 is SRAM, the supply indication is read only. The EPROM bytes aren't simulated.
+      if (address == 7) {
+        status[7] = (status[7] & 0x80) | (value & 0x7F);
+        writes++;
+      }
+      state = FN_WRITE_CRC;
+      break;
+
+    case FN_WRITE_CRC:
+      if (++index == 2) {
+        index = 0;
+        state = FN_WRITE_READBACK;
+      }
+      break;
+
+    case FN_WRITE_READBACK:
+      state = FN_IDLE;
+      break;
+
+    default:
+      break;
+  }
+}
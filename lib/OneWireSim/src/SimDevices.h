@@ -0,0 +1,278 @@
+#ifndef SimDevices_h
+#define SimDevices_h
+
+#include "OneWireSim.h"
+
+/**
+ * DS18B20, DS1822 and DS18S20 temperature sensor, family 0x28, 0x22 and 0x10.
+ * https://datasheets.maximintegrated.com/en/ds/DS18B20.pdf
+ */
+class SimDS18x20 : public SimDevice {
+ private:
+  enum State : uint8_t { FN_COMMAND, FN_READ_SCRATCHPAD, FN_WRITE_SCRATCHPAD, FN_READ_SLOTS, FN_POWER_SUPPLY, FN_IDLE };
+
+  State state = FN_COMMAND;
+  uint8_t index = 0;
+  uint8_t scratchpad[9];
+  uint8_t eeprom[3] = {75, 70, 0x7F};  // TH, TL, configuration
+  float temperature = 25;
+  bool parasite = false;
+  bool converting = false;
+  bool alarm = false;
+  int64_t conversionDone = 0;
+  uint32_t conversions = 0;
+
+  bool isS20() const { return rom[0] == 0x10; }
+  void update();
+  void latchTemperature();
+
+ protected:
+  void functionReset() override { state = FN_COMMAND; }
+  uint8_t functionRead() override;
+  void functionWrite(uint8_t value) override;
+  bool functionDriveBit() override;
+  void functionSampleBit(bool value) override;
+
+ public:
+  SimDS18x20(const uint8_t id[8], bool parasite = false);
+
+  bool isAlarming() override;
+
+  // Temperature measured by the next conversion.
+  void setTemperature(float temperature) { this->temperature = temperature; }
+  void setParasite(bool parasite) { this->parasite = parasite; }
+
+  // Conversion time in microseconds at the configured resolution.
+  int64_t conversionTime() const;
+  bool isConverting() { update(); return converting; }
+  uint32_t getConversions() const { return conversions; }
+
+  const uint8_t *getScratchpad() { update(); return scratchpad; }
+  const uint8_t *getEeprom() const { return eeprom; }
+};
+
+/**
+ * DS2408 8-channel addressable switch, family 0x29.
+ * https://datasheets.maximintegrated.com/en/ds/DS2408.pdf
+ */
+class SimDS2408 : public SimDevice {
+ private:
+  enum State : uint8_t {
+    FN_COMMAND, FN_ADDRESS, FN_READ_REGISTERS, FN_CRC, FN_CHANNEL_READ,
+    FN_WRITE_DATA, FN_WRITE_INVERTED, FN_WRITE_CONFIRM, FN_WRITE_PIO,
+    FN_WRITE_CONDITIONAL, FN_CONFIRM, FN_IDLE
+  };
+
+  State state = FN_COMMAND;
+  uint8_t command = 0;
+  uint16_t address = 0;
+  uint8_t index = 0;
+  uint8_t written = 0;
+  uint16_t crc = 0;
+
+  uint8_t inputs = 0xFF;    // pins as driven from the outside, 1 = not pulled low
+  uint8_t latch = 0xFF;     // output latch, 0 = output transistor on
+  uint8_t activity = 0;
+  uint8_t conditionalMask = 0;
+  uint8_t conditionalPolarity = 0;
+  uint8_t control = 0x88;   // VCC powered and power-on reset latch set
+  uint32_t channelWrites = 0;
+
+  uint8_t pio() const { return latch & inputs; }
+  uint8_t getRegister(uint16_t address) const;
+  void setPio(uint8_t latch, uint8_t inputs);
+
+ protected:
+  void functionReset() override { state = FN_COMMAND; }
+  uint8_t functionRead() override;
+  void functionWrite(uint8_t value) override;
+
+ public:
+  SimDS2408(const uint8_t id[8]) : SimDevice(id) {}
+
+  bool supportsOverdrive() const override { return true; }
+  bool isAlarming() override;
+
+  // Pins pulled low from the outside (0 bits), e.g. a switch on an input.
+  void setInputs(uint8_t inputs) { setPio(latch, inputs); }
+  uint8_t getLatch() const { return latch; }
+  uint8_t getPio() const { return pio(); }
+  uint8_t getActivity() const { return activity; }
+  uint8_t getControl() const { return control; }
+  uint32_t getChannelWrites() const { return channelWrites; }
+};
+
+/**
+ * DS2423 4kbit RAM with counter, family 0x1D. Counter A and B count the external
+ * inputs and belong to memory page 14 and 15.
+ * https://datasheets.maximintegrated.com/en/ds/DS2423.pdf
+ */
+class SimDS2423 : public SimDevice {
+ private:
+  enum State : uint8_t { FN_COMMAND, FN_ADDRESS, FN_DATA, FN_COUNTER, FN_ZEROS, FN_CRC, FN_IDLE };
+
+  State state = FN_COMMAND;
+  uint8_t command = 0;
+  uint16_t address = 0;
+  uint8_t index = 0;
+  uint16_t crc = 0;
+  uint8_t memory[512] = {};
+  uint32_t counters[4] = {};  // page 12 to 15
+
+  uint8_t counterByte() const;
+
+ protected:
+  void functionReset() override { state = FN_COMMAND; }
+  uint8_t functionRead() override;
+  void functionWrite(uint8_t value) override;
+
+ public:
+  SimDS2423(const uint8_t id[8]) : SimDevice(id) {}
+
+  bool supportsOverdrive() const override { return true; }
+
+  // counter 0 = A, 1 = B.
+  void setCounter(uint8_t counter, uint32_t value) { counters[2 + counter] = value; }
+  void count(uint8_t counter, uint32_t pulses = 1) { counters[2 + counter] += pulses; }
+  uint32_t getCounter(uint8_t counter) const { return counters[2 + counter]; }
+  uint8_t *getMemory() { return memory; }
+};
+
+/**
+ * DS2450 quad A/D converter, family 0x20. Page 0 holds the conversion results, page 1 the
+ * control/status, page 2 the alarm settings and page 3 the calibration, of channel A to D.
+ * https://datasheets.maximintegrated.com/en/ds/DS2450.pdf
+ */
+class SimDS2450 : public SimDevice {
+ private:
+  enum State : uint8_t {
+    FN_COMMAND, FN_ADDRESS, FN_READ_DATA, FN_READ_CRC, FN_WRITE_DATA, FN_WRITE_CRC, FN_WRITE_READBACK,
+    FN_CONVERT_MASK, FN_CONVERT_CONTROL, FN_CONVERT_CRC, FN_READ_SLOTS, FN_IDLE
+  };
+
+  State state = FN_COMMAND;
+  uint8_t command = 0;
+  uint16_t address = 0;
+  uint8_t index = 0;
+  uint16_t crc = 0;
+  uint8_t memory[32] = {};
+  uint8_t convertMask = 0;
+  uint8_t convertControl = 0;
+  float inputs[4] = {};  // volts
+  bool converting = false;
+  int64_t conversionDone = 0;
+  uint32_t conversions = 0;
+
+  void update();
+  void latchResults();
+
+ protected:
+  void functionReset() override { state = FN_COMMAND; }
+  uint8_t functionRead() override;
+  void functionWrite(uint8_t value) override;
+  bool functionDriveBit() override;
+  void functionSampleBit(bool value) override;
+
+ public:
+  SimDS2450(const uint8_t id[8]);
+
+  bool supportsOverdrive() const override { return true; }
+
+  // Voltage on the input of channel 0 (A) to 3 (D), converted by the next conversion.
+  void setInput(uint8_t channel, float volts) { inputs[channel] = volts; }
+  // Conversion time in microseconds of the channels in mask, at their resolution.
+  int64_t conversionTime(uint8_t mask) const;
+  bool isConverting() { update(); return converting; }
+  uint32_t getConversions() const { return conversions; }
+  uint8_t *getMemory() { return memory; }
+};
+
+/**
+ * DS2413 dual channel addressable switch, family 0x3A.
+ * https://datasheets.maximintegrated.com/en/ds/DS2413.pdf
+ */
+class SimDS2413 : public SimDevice {
+ private:
+  enum State : uint8_t { FN_COMMAND, FN_READ_STATUS, FN_WRITE_DATA, FN_WRITE_INVERTED, FN_WRITE_CONFIRM, FN_WRITE_STATUS, FN_IDLE };
+
+  State state = FN_COMMAND;
+  uint8_t written = 0;
+  uint8_t inputs = 0x03;  // pins as driven from the outside, 1 = not pulled low
+  uint8_t latch = 0x03;   // output latches of PIOA and PIOB, 0 = output transistor on
+  uint32_t writes = 0;
+
+  uint8_t status() const;
+
+ protected:
+  void functionReset() override { state = FN_COMMAND; }
+  uint8_t functionRead() override;
+  void functionWrite(uint8_t value) override;
+
+ public:
+  SimDS2413(const uint8_t id[8]) : SimDevice(id) {}
+
+  bool supportsOverdrive() const override { return true; }
+
+  void setInputs(uint8_t inputs) { this->inputs = inputs; }
+  uint8_t getLatch() const { return latch; }
+  void setLatch(uint8_t latch) { this->latch = latch; }
+  uint32_t getWrites() const { return writes; }
+};
+
+/**
+ * DS2406 dual addressable switch, family 0x12. Only the channel flip-flops in status memory
+ * byte 7 are simulated, written with Write Status and read with Read Status.
+ * https://datasheets.maximintegrated.com/en/ds/DS2406.pdf
+ */
+class SimDS2406 : public SimDevice {
+ private:
+  enum State : uint8_t { FN_COMMAND, FN_ADDRESS, FN_READ_DATA, FN_READ_CRC, FN_WRITE_DATA, FN_WRITE_CRC, FN_WRITE_READBACK, FN_IDLE };
+
+  State state = FN_COMMAND;
+  uint8_t command = 0;
+  uint16_t address = 0;
+  uint8_t index = 0;
+  uint16_t crc = 0;
+  uint8_t status[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};  // flip-flops off, VCC powered
+  uint32_t writes = 0;
+
+ protected:
+  void functionReset() override { state = FN_COMMAND; }
+  uint8_t functionRead() override;
+  void functionWrite(uint8_t value) override;
+
+ public:
+  SimDS2406(const uint8_t id[8]) : SimDevice(id) {}
+
+  bool supportsOverdrive() const override { return true; }
+
+  // Channel flip-flops of PIOA and PIOB, 0 = output transistor on.
+  uint8_t getLatch() const { return (status[7] >> 5) & 0x03; }
+  void setLatch(uint8_t latch) { status[7] = (status[7] & 0x9F) | (latch & 0x03) << 5; }
+  uint32_t getWrites() const { return writes; }
+};
+
+/**
+ * DS2405 addressable switch, family 0x05. Every MATCH ROM toggles the output, the read time
+ * slots that follow give the level of the PIO pin.
+ * https://datasheets.maximintegrated.com/en/ds/DS2405.pdf
+ */
+class SimDS2405 : public SimDevice {
+ private:
+  bool on = false;  // output transistor on, pulling the PIO pin low
+  uint32_t toggles = 0;
+
+ protected:
+  void functionMatched() override { on = !on; toggles++; }
+  bool functionDriveBit() override { return !on; }
+  void functionSampleBit(bool value) override {}
+
+ public:
+  SimDS2405(const uint8_t id[8]) : SimDevice(id) {}
+
+  bool isOn() const { return on; }
+  void setOn(bool on) { this->on = on; }
+  uint32_t getToggles() const { return toggles; }
+};
+
+#endif
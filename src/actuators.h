@@ -0,0 +1,193 @@
+#ifndef Actuators_h
+#define Actuators_h
+
+#include <Arduino.h>
+#include <vector>
+#include "onewire.h"
+#include "onewireengine.h"
+#include "switches.h"
+#include "tinyowc.h"
+
+/**
+ * A switch board and the sensors bound to its pins, with the pin states the sensors want this cycle.
+ */
+struct ActuatorBoard {
+  uint8_t rom[8];
+  uint16_t node;                  // index of the board in the node list
+  uint8_t channels;               // number of pins, see switchChannels()
+  std::vector<uint16_t> sensors;  // index of every sensor bound to the board, on any bus
+  uint8_t plannedPins = 0;        // pins a sensor wants set this cycle
+  uint8_t plannedState = 0;       // wanted state of those pins, 1 means on
+};
+
+/**
+ * Drives the switches of one 1-Wire bus, DS2408 relay boards and the DS2413, DS2406 and DS2405, any
+ * number of them can share the bus since each one is addressed by its ROM. All writes are done by the
+ * engine of the bus, through setActuator().
+ *
+ * The sensors plan the pin states they want during a sampling cycle, flush() then merges them with
+ * the forced states of the bound sensors and writes each board at most once, only if it changes.
+ */
+class ActuatorManager {
+ private:
+  OneWireEngine *engine = nullptr;
+  uint8_t bus = 0;
+  std::vector<ActuatorBoard> boards;
+
+  ActuatorBoard *findBoard(const uint8_t rom[8]) {
+    for (auto &board : boards) {
+      if (memcmp(board.rom, rom, 8) == 0) return &board;
+    }
+    return nullptr;
+  }
+
+  // Queue one write of the planned pins, first in the queue of the bus. txn.result is 1 if the board was written.
+  bool write(const onewireNode &board, uint8_t pins, uint8_t state, OneWireCompletion onComplete) {
+    return engine->submit(board.id, [pins, state](OneWireMaster &ds, onewireNode *board, OneWireTransaction &txn) {
+      if (board == nullptr) {
+        return false;
+      }
+
+      // merged with the current state here, a write queued before this one may just have been done.
+      auto oldState = board->pinStates;
+      uint8_t newState = (oldState & ~pins) | (state & pins);
+      txn.result = 0;
+      if (newState == oldState) {
+        return true;
+      }
+
+      if (!setActuator(ds, *board, newState)) {
+        return false;
+      }
+
+      board->pinStates = newState;
+      txn.result = 1;
+      char oldPins[8 + 1], newPins[8 + 1];
+      formatPinStates(oldState, oldPins);
+      formatPinStates(newState, newPins);
+      ESP_LOGI(TAG, "Adjusted actuator state, old value: %s, new value: %s.", oldPins, newPins);
+      return true;
+    }, onComplete, true);
+  }
+
+ public:
+  void begin(OneWireEngine &engine, uint8_t bus) {
+    this->engine = &engine;
+    this->bus = bus;
+  }
+
+  /**
+   * Rebuild the boards of the bus and the reverse index from each board to its bound sensors,
+   * call this whenever the node list or a binding changes. The pin states planned for the boards
+   * still on the bus are kept, a binding can change in the middle of a sampling cycle.
+   */
+  void indexBindings(const std::vector<onewireNode> &nodes) {
+    std::vector<ActuatorBoard> planned;
+    planned.swap(boards);
+
+    for (uint16_t i = 0; i < nodes.size(); i++) {
+      if (switchChannels(nodes[i].familyId) > 0 && nodes[i].bus == bus) {
+        ActuatorBoard board;
+        memcpy(board.rom, nodes[i].id, 8);
+        board.node = i;
+        board.channels = switchChannels(nodes[i].familyId);
+        for (auto &old : planned) {
+          if (memcmp(old.rom, board.rom, 8) == 0) {
+            board.plannedPins = old.plannedPins;
+            board.plannedState = old.plannedState;
+          }
+        }
+        boards.push_back(board);
+      }
+    }
+
+    for (uint16_t i = 0; i < nodes.size(); i++) {
+      auto &sensor = nodes[i];
+      if (sensor.actuatorPin < 0) continue;
+
+      auto board = findBoard(sensor.actuatorId);
+      if (board == nullptr) continue;
+      if (sensor.actuatorPin >= board->channels) {
+        ESP_LOGW(TAG, "Sensor %s is bound to pin %d, the actuator %s has no such pin.", sensor.idStr, sensor.actuatorPin, nodes[board->node].idStr);
+        continue;
+      }
+
+      for (auto other : board->sensors) {
+        if (nodes[other].actuatorPin == sensor.actuatorPin) {
+          ESP_LOGW(TAG, "Sensors %s and %s are bound to the same actuator pin %d.", nodes[other].idStr, sensor.idStr, sensor.actuatorPin);
+        }
+      }
+      board->sensors.push_back(i);
+    }
+  }
+
+  /**
+   * Plan the state of one pin for the end of the cycle, the last plan of a pin wins.
+   * @return false if the board isn't a switch on this bus or the pin is invalid.
+   */
+  bool planPin(const uint8_t boardRom[8], int8_t pin, bool pinState) {
+    auto board = findBoard(boardRom);
+    if (board == nullptr || pin < 0 || pin >= board->channels) {
+      return false;
+    }
+
+    bitSet(board->plannedPins, pin);
+    bitWrite(board->plannedState, pin, pinState);
+    return true;
+  }
+
+  /**
+   * Write the planned pin states, together with the forced ('1'/'0') states of the bound sensors.
+   * Each board gets at most one write, and none if its pins already have the planned states.
+   * onComplete runs for every queued write, txn.result tells if the board was changed.
+   * @return number of writes queued.
+   */
+  uint8_t flush(const std::vector<onewireNode> &nodes, OneWireCompletion onComplete = nullptr) {
+    uint8_t queued = 0;
+
+    for (auto &board : boards) {
+      for (auto i : board.sensors) {
+        auto &sensor = nodes[i];
+        if (sensor.stateOverride == '1' || sensor.stateOverride == '0') {
+          bitSet(board.plannedPins, sensor.actuatorPin);
+          bitWrite(board.plannedState, sensor.actuatorPin, sensor.stateOverride == '1');
+        }
+      }
+
+      auto pins = board.plannedPins;
+      auto state = board.plannedState;
+      board.plannedPins = 0;
+      board.plannedState = 0;
+
+      auto &boardNode = nodes[board.node];
+      if (engine == nullptr || ((boardNode.pinStates ^ state) & pins) == 0) {
+        continue;  // nothing changes
+      }
+
+      if (write(boardNode, pins, state, onComplete)) {
+        queued++;
+      }
+    }
+    return queued;
+  }
+
+  // Set every switch on the bus to a known state, all outputs off. A DS2408 also gets testmode off and strobe out.
+  void resetBoards() {
+    if (engine == nullptr) {
+      return;
+    }
+
+    for (auto &board : boards) {
+      engine->submit(board.rom, [](OneWireMaster &ds, onewireNode *node, OneWireTransaction &) {
+        if (node == nullptr) return false;
+        if (node->familyId == DS2408) {
+          ds2408_reset(ds, *node);
+          return true;
+        }
+        return setActuator(ds, *node, 0);
+      });
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef Benchmark_h
+#define Benchmark_h
+
+#include <OneWireMaster.h>
+#include "tinyowc.h"
+
+// Benchmarks are only built when "-DTINYOWC_BENCHMARK" is added to build_flags in platformio.ini.
+// They also run on the host against the simulator, see test/test_benchmark.
+#ifdef TINYOWC_BENCHMARK
+
+#include <algorithm>
+#include <esp_task_wdt.h>
+#include <vector>
+#include "ds18x20.h"
+#include "ds2408.h"
+#include "ds2423.h"
+#include "onewire.h"
+
+// Timed runs of each primitive, after one warm-up run.
+#define BENCHMARK_ITERATIONS 50
+
+/**
+ * Latency samples and serial traffic of one benchmarked primitive.
+ */
+struct BenchmarkResult {
+  uint32_t samples[BENCHMARK_ITERATIONS];  // microseconds
+  uint16_t count = 0;
+  OneWireStats stats;  // total over all timed runs
+
+  void add(uint32_t micros) {
+    if (count < BENCHMARK_ITERATIONS) samples[count++] = micros;
+  }
+
+  // Nearest-rank percentile, sorts the samples.
+  uint32_t percentile(uint8_t percent) {
+    if (count == 0) return 0;
+    std::sort(samples, samples + count);
+    uint16_t rank = (percent * count + 99) / 100;
+    return samples[rank > 0 ? rank - 1 : 0];
+  }
+
+  uint32_t mean() const {
+    uint64_t sum = 0;
+    for (uint16_t i = 0; i < count; i++) sum += samples[i];
+    return count > 0 ? sum / count : 0;
+  }
+};
+
+/**
+ * Print one result as a line of JSON, the lines can be collected from the serial console
+ * (or stdout on the host) by grepping for "tinyowc-benchmark".
+ */
+void printBenchmarkResult(const char *name, uint16_t devices, uint32_t linkSpeed, BenchmarkResult &result) {
+  uint16_t n = result.count > 0 ? result.count : 1;
+  uint32_t p50 = result.percentile(50);
+  uint32_t p99 = result.percentile(99);  // samples are sorted from here on
+
+  Serial.printf("{\"type\":\"tinyowc-benchmark\",\"benchmark\":\"%s\",\"devices\":%u,\"link_speed\":%u,\"iterations\":%u,"
+    "\"p50_us\":%u,\"p99_us\":%u,\"min_us\":%u,\"max_us\":%u,\"mean_us\":%u,"
+    "\"bytes_sent\":%u,\"bytes_received\":%u,\"round_trips\":%u}\n",
+    name, devices, linkSpeed, result.count,
+    p50, p99, result.samples[0], result.samples[n - 1], result.mean(),
+    result.stats.bytesSent / n, result.stats.bytesReceived / n, result.stats.roundTrips / n);
+}
+
+/**
+ * Time operation, prepare runs before each timed run and is neither timed nor counted.
+ */
+template <typename Prepare, typename Operation>
+void runBenchmark(OneWireMaster &ds, const char *name, uint16_t devices, Prepare prepare, Operation operation) {
+  BenchmarkResult result;
+
+  prepare();
+  operation();
+
+  for (uint16_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    prepare();
+
+    auto before = ds.getStats();
+    auto started = esp_timer_get_time();
+    operation();
+    uint32_t elapsed = esp_timer_get_time() - started;
+    auto after = ds.getStats();
+
+    result.add(elapsed);
+    result.stats.bytesSent += after.bytesSent - before.bytesSent;
+    result.stats.bytesReceived += after.bytesReceived - before.bytesReceived;
+    result.stats.roundTrips += after.roundTrips - before.roundTrips;
+    esp_task_wdt_reset();
+  }
+
+  printBenchmarkResult(name, devices, ds.getLinkSpeed(), result);
+}
+
+/**
+ * The bus work of one sampling cycle in actOnSensors(): start the conversion on all sensors,
+ * then read every temperature sensor and counter. The 1 second wait for the conversion is left out.
+ */
+void benchmarkCycle(OneWireMaster &ds, std::vector<onewireNode> &nodes) {
+  startSimultaneousConversion(ds);
+
+  for (auto &node : nodes) {
+    if (isTemperatureSensor(node.familyId)) {
+      readConversion(ds, node);
+    } else if (node.familyId == DS2423) {
+      getCounters(ds, node);
+    }
+  }
+}
+
+/**
+ * Benchmark the bus primitives against the first device of each kind in nodes, and a whole
+ * sampling cycle over all of them. Results are printed as JSON lines, see printBenchmarkResult().
+ * Note that setState() turns all outputs of the first DS2408 off.
+ */
+void benchmarkBus(OneWireMaster &ds, std::vector<onewireNode> &nodes) {
+  uint16_t devices = nodes.size();
+  onewireNode *sensor = nullptr;
+  onewireNode *actuator = nullptr;
+  onewireNode *counter = nullptr;
+
+  for (auto &node : nodes) {
+    if (sensor == nullptr && isTemperatureSensor(node.familyId)) sensor = &node;
+    if (actuator == nullptr && node.familyId == DS2408) actuator = &node;
+    if (counter == nullptr && node.familyId == DS2423) counter = &node;
+  }
+
+  auto nothing = []() {};
+
+  runBenchmark(ds, "reset", devices, nothing, [&]() { ds.reset(); });
+
+  if (nodes.size() > 0) {
+    runBenchmark(ds, "select", devices, [&]() { ds.reset(); }, [&]() { ds.select(nodes[0].id); });
+  }
+
+  if (sensor != nullptr) {
+    runBenchmark(ds, "readConversion", devices, nothing, [&]() { _readConversion(ds, sensor->id); });
+  }
+
+  if (actuator != nullptr) {
+    runBenchmark(ds, "setState", devices, nothing, [&]() { setState(ds, *actuator, B11111111); });
+  }
+
+  if (counter != nullptr) {
+    runBenchmark(ds, "getCounters", devices, nothing, [&]() { getCounters(ds, *counter); });
+  }
+
+  runBenchmark(ds, "cycle", devices, nothing, [&]() { benchmarkCycle(ds, nodes); });
+}
+
+/**
+ * Enumerate all devices on the bus with the bit by bit search and with the Search Accelerator,
+ * and print the time and serial traffic each of them needed.
+ */
+void benchmarkSearch(OneWireMaster &ds) {
+  uint8_t addr[8];
+
+  for (uint8_t accelerated = 0; accelerated < 2; accelerated++) {
+    BenchmarkResult result;
+    uint16_t devices = 0;
+
+    ds.reset_search();
+    ds.resetStats();
+    auto started = esp_timer_get_time();
+
+    while (accelerated ? ds.search(addr) : ds.search_bitwise(addr)) {
+      devices++;
+      esp_task_wdt_reset();
+    }
+
+    result.add(esp_timer_get_time() - started);
+    result.stats = ds.getStats();
+    printBenchmarkResult(accelerated ? "search" : "search_bitwise", devices, ds.getLinkSpeed(), result);
+  }
+
+  ds.reset_search();
+}
+
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef Counters_h
+#define Counters_h
+
+#include <stdint.h>
+
+// number of samples in the moving window of a counter, at SAMPLE_DELAY (15 s) that's about 2 minutes.
+#define COUNTER_WINDOW 8
+
+/**
+ * Pulse total and rates of one DS2423 counter, fed with every successful read of it.
+ * The 32-bit counter of the device is extended to 64 bits, a wraparound between two reads
+ * is handled by the modular difference. Times are from esp_timer_get_time(), in microseconds.
+ */
+struct PulseCounter {
+  uint64_t total = 0;   // pulses counted by the device, continued across wraparounds and reboots.
+  uint32_t last = 0;    // counter value of the last read.
+  bool valid = false;   // last and total are known, from a read or restored from the settings.
+  float rate = 0;       // pulses/second between the last two reads.
+  float averageRate = 0; // pulses/second over the moving window.
+
+  /**
+   * Add a counter value read at time.
+   */
+  void update(uint32_t value, int64_t time) {
+    if (valid) {
+      total += (uint32_t)(value - last);  // unsigned difference, also right when the counter wrapped.
+    } else {
+      total = value;
+      valid = true;
+    }
+    last = value;
+
+    // a sample older than the window is dropped, the oldest remaining one is the start of the window.
+    if (samples == COUNTER_WINDOW) {
+      oldest = (oldest + 1) % COUNTER_WINDOW;
+      samples--;
+    }
+    auto &sample = window[(oldest + samples++) % COUNTER_WINDOW];
+    sample.time = time / 1000;
+    sample.total = total;
+
+    if (samples > 1) {
+      auto &first = window[oldest];
+      auto &previous = window[(oldest + samples - 2) % COUNTER_WINDOW];
+      rate = pulsesPerSecond(previous, sample);
+      averageRate = pulsesPerSecond(first, sample);
+    }
+  }
+
+  /**
+   * Continue from a total and counter value saved before a reboot. The rates start over, since
+   * the time of the saved value isn't known, but the pulses counted meanwhile are added by the next read.
+   */
+  void restore(uint64_t savedTotal, uint32_t savedLast) {
+    total = savedTotal;
+    last = savedLast;
+    valid = true;
+    samples = 0;
+    rate = averageRate = 0;
+  }
+
+ private:
+  // 32 bits are enough within the window, the differences are taken modulo 2^32 like the counter itself.
+  struct Sample {
+    uint32_t time;   // milliseconds
+    uint32_t total;  // lower 32 bits of total
+  };
+
+  Sample window[COUNTER_WINDOW];
+  uint8_t oldest = 0;
+  uint8_t samples = 0;
+
+  static float pulsesPerSecond(const Sample &from, const Sample &to) {
+    uint32_t elapsed = to.time - from.time;
+    if (elapsed == 0 || elapsed > UINT32_MAX / 2) return 0;  // not after from
+    return (uint32_t)(to.total - from.total) * 1000.0 / elapsed;
+  }
+};
+
+/**
+ * Counter state saved in the settings, so the totals survive a reboot. See PulseCounter::restore().
+ */
+struct CounterRecord {
+  uint8_t rom[8];
+  uint32_t last[2];
+  uint64_t total[2];
+};
+
+#endif
@@ -1,8 +1,12 @@
 #ifndef DS18x20_h
 #define DS18x20_h
 
-#include <DS2480B.h>
+#include <OneWireMaster.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "onewire.h"
+#include "tinyowc.h"
 // Code from https://community.particle.io/t/success-multiple-single-ds18b20-temp-sensors-on-a-single-onewire-bus/50318/17
 
 // DS18x20 Function commands
@@ -49,7 +53,12 @@ enum DS18B20_CONVERSION_TIME   : uint16_t {
   DS18B20_12BIT_TIME = 750,         //  12 bit  750.00 ms conversion time w/pad
 };
 
-bool isConnected(DS2480B &ds, const uint8_t rom[8]) {
+// How often externally powered sensors are polled for a finished conversion.
+#define DS18X20_POLL_INTERVAL_MS 5
+// Time in ms needed by COPY SCRATCHPAD to write the EEPROM.
+#define DS18X20_COPY_SCRATCHPAD_TIME 10
+
+bool isConnected(OneWireMaster &ds, const uint8_t rom[8]) {
   if (ds.reset()) {     // onewire initialization sequence, to be followed by other commands
     ds.select(rom);     // issues onewire "MATCH ROM" address which selects a SPECIFIC device
     ds.write(READ_SCRATCHPAD); // onewire "READ SCRATCHPAD" command, to access selected DS18B20's scratchpad
@@ -69,7 +78,7 @@ bool isConnected(DS2480B &ds, const uint8_t rom[8]) {
       return false;
     }
 
-    auto crc = DS2480B::crc8(data, 8);
+    auto crc = OneWireMaster::crc8(data, 8);
     if (crc != data[8]) {
       return false;
     }
@@ -82,12 +91,12 @@ bool isConnected(DS2480B &ds, const uint8_t rom[8]) {
 }
 
 // whether the actuator the temperature sensor is connected to should be active or not (open/closed)
-bool shouldActuatorBeActive(onewireNode &node) {
+bool shouldActuatorBeActive(const onewireNode &node) {
   return node.temperature < node.lowLimit;;
 }
 
 // this function sets the resolution for ALL DS18B20s on an instantiated OneWire
-void setResolution(DS2480B &ds, uint8_t resolution)  
+void setResolution(OneWireMaster &ds, uint8_t resolution)  
 {
   if (ds.reset()) { // onewire intialization sequence, to be followed by other commands
     ds.write(SKIP_ROM);    // onewire "SKIP ROM" command, selects ALL DS18B20s on bus
@@ -98,8 +107,26 @@ void setResolution(DS2480B &ds, uint8_t resolution)
   }
 }
 
+// Worst case conversion time in ms at the resolution of the sensor, the DS18S20 always needs 750 ms.
+uint16_t conversionTime(const onewireNode &node) {
+  if (node.familyId == DS18S20) {
+    return DS18B20_12BIT_TIME;
+  }
+
+  switch (node.resolution) {
+    case 9:
+      return DS18B20_9BIT_TIME;
+    case 10:
+      return DS18B20_10BIT_TIME;
+    case 11:
+      return DS18B20_11BIT_TIME;
+    default:
+      return DS18B20_12BIT_TIME;
+  }
+}
+
 // this function intitalizes simultaneous temperature conversions for ALL DS18B20s on an instantiated OneWire
-void startSimultaneousConversion(DS2480B &ds)    
+void startSimultaneousConversion(OneWireMaster &ds)    
 {
   if (ds.reset()) {      // onewire initialization sequence, to be followed by other commands
     ds.write(SKIP_ROM);  // onewire "SKIP ROM" command, addresses ALL DS18B20s on bus
@@ -107,7 +134,43 @@ void startSimultaneousConversion(DS2480B &ds)
   }
 }
 
-void startConversion(DS2480B &ds, const uint8_t addr[8])    
+// Convert the temperature on ALL sensors of the bus and return once they are done.
+// conversionTime is the worst case time in ms of the slowest sensor on the bus. Parasite powered sensors get
+// their power through a strong pullup for all of that time, externally powered sensors answer read time slots
+// with 1 as soon as they are done, so then the bus is polled instead.
+// Returns false if the conversion couldn't be started.
+bool convertTemperatures(OneWireMaster &ds, uint16_t conversionTime, bool parasite) {
+  if (!ds.reset()) {
+    return false;
+  }
+  ds.skip();
+
+  if (parasite) {
+    if (!ds.writeStrongPullup(CONVERT_T)) {
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(conversionTime));
+    ds.endStrongPullup();
+    return true;
+  }
+
+  ds.write(CONVERT_T);
+  if (ds.getStatus() != ONEWIRE_OK) {
+    return false;
+  }
+
+  auto deadline = esp_timer_get_time() + conversionTime * 1000LL;
+  while (!ds.read_bit()) {
+    if (esp_timer_get_time() >= deadline) {
+      ESP_LOGW(TAG, "Temperature conversion not done after %u ms.", conversionTime);
+      break;
+    }
+    vTaskDelay(pdMS_TO_TICKS(DS18X20_POLL_INTERVAL_MS));
+  }
+  return true;
+}
+
+void startConversion(OneWireMaster &ds, const uint8_t addr[8])    
 {
   if (ds.reset()) {      // onewire initialization sequence, to be followed by other commands
     ds.select(addr);     // issues onewire "MATCH ROM" address which selects a SPECIFIC (only one) DS18B20 device
@@ -115,64 +178,76 @@ void startConversion(DS2480B &ds, const uint8_t addr[8])
   }
 }
 
-// this function returns the RAW temperature conversion result of a SINGLE selected DS18B20 device (via it's address)
-int16_t _readConversion(DS2480B &ds, const uint8_t addr[8]) {
-  if (ds.reset()) {     // onewire initialization sequence, to be followed by other commands
-    ds.select(addr);    // issues onewire "MATCH ROM" address which selects a SPECIFIC (only one) DS18B20 device
-    ds.write(READ_SCRATCHPAD); // onewire "READ SCRATCHPAD" command, to access selected DS18B20's scratchpad
-    
-    byte data[9];
-
-    // https://www.maximintegrated.com/en/design/technical-documents/app-notes/4/4377.html
- 	  //        DS18S20               DS18B20
-    //byte 0	Temperature LSB (AAh)	Temperature LSB (50h)
-    //byte 1	Temperature MSB (00h)	Temperature MSB (05h)
-    //byte 2	TH Register	          TH Register
-    //byte 3	TL Register	          TL Register
-    //byte 4	Reserved (FFh)        Configuration Register
-    //byte 5	Reserved (FFh)        Reserved (FFh)
-    //byte 6	Count Remain (0Ch)	  Reserved
-    //byte 7	Count Per °C (10h)	  Reserved (10h)
-    //byte 8	CRC                   CRC
-    for (auto i = 0; i < 9; i++) {           // we need 9 bytes
-      data[i] = ds.read();
-    //  Serial.print(data[i], HEX);
-    //  Serial.print(" ");
-    }
+// Read the 9 byte scratchpad of a SINGLE selected sensor (via it's address), the CRC is checked.
+bool readScratchpad(OneWireMaster &ds, const uint8_t addr[8], uint8_t data[9]) {
+  if (!ds.reset()) {  // onewire initialization sequence, to be followed by other commands
+    return false;
+  }
 
-    //Serial.print(" CRC=");
-    //Serial.print(DS2480B::crc8(data, 8), HEX);
-    //Serial.print(":");
-    //Serial.print(data[8], HEX);
-    //Serial.println();
-    auto crc = DS2480B::crc8(data, 8);
-    if (crc != data[8]) {
-      Serial.printf("Missmatched CRC=%X:%X.\n", crc, data[8]);
-      return UNSET_TEMPERATURE;
-    }
-    
-    // Convert the data to actual temperature
-    // because the result is a 16 bit signed integer, it should
-    // be stored to an "int16_t" type, which is always 16 bits
-    // even when compiled on a 32 bit processor.
-    int16_t raw = (data[1] << 8) | data[0];
-
-    if (addr[0] == DS18S20) {  // old DS18S20 or DS1820
-      raw = raw << 3; // 9 bit resolution default
-      if (data[7] == 0x10) {
-        // "count remain" gives full 12 bit resolution
-        raw = (raw & 0xFFF0) + 12 - data[6];
-      }
-    } else {
-      byte cfg = (data[4] & 0x60);
-      // at lower res, the low bits are undefined, so let's zero them
-      if (cfg == 0x00) raw = raw & ~7;  // 9 bit resolution, 93.75 ms
-      else if (cfg == 0x20) raw = raw & ~3; // 10 bit res, 187.5 ms
-      else if (cfg == 0x40) raw = raw & ~1; // 11 bit res, 375 ms
-      // default is 12 bit resolution, 750 ms conversion time
+  // MATCH ROM, READ SCRATCHPAD and the 9 scratchpad bytes are sent as one block transfer.
+  byte buf[19];
+  buf[0] = MATCH_ROM;                 // issues onewire "MATCH ROM" address which selects a SPECIFIC (only one) DS18B20 device
+  memcpy(buf + 1, addr, 8);
+  buf[9] = READ_SCRATCHPAD;           // onewire "READ SCRATCHPAD" command, to access selected DS18B20's scratchpad
+  memset(buf + 10, 0xFF, 9);          // we need 9 bytes
+  CRC8Verifier crc(10, 8);            // scratchpad CRC is checked as the bytes are received
+
+  if (!ds.block(buf, sizeof(buf), &crc)) {
+    Serial.printf("Reading scratchpad failed: %s.\n", OneWireMaster::statusToString(ds.getStatus()));
+    return false;
+  }
+
+  memcpy(data, buf + 10, 9);
+  return true;
+}
+
+// The RAW temperature of a scratchpad read from a sensor of the family, its CRC already checked.
+// The resolution in bits is returned in resolution, if given.
+int16_t scratchpadToRaw(uint8_t familyId, const uint8_t data[9], uint8_t *resolution = nullptr) {
+  // https://www.maximintegrated.com/en/design/technical-documents/app-notes/4/4377.html
+  //        DS18S20               DS18B20
+  //byte 0	Temperature LSB (AAh)	Temperature LSB (50h)
+  //byte 1	Temperature MSB (00h)	Temperature MSB (05h)
+  //byte 2	TH Register	          TH Register
+  //byte 3	TL Register	          TL Register
+  //byte 4	Reserved (FFh)        Configuration Register
+  //byte 5	Reserved (FFh)        Reserved (FFh)
+  //byte 6	Count Remain (0Ch)	  Reserved
+  //byte 7	Count Per °C (10h)	  Reserved (10h)
+  //byte 8	CRC                   CRC
+  // Convert the data to actual temperature
+  // because the result is a 16 bit signed integer, it should
+  // be stored to an "int16_t" type, which is always 16 bits
+  // even when compiled on a 32 bit processor.
+  int16_t raw = (data[1] << 8) | data[0];
+
+  if (familyId == DS18S20) {  // old DS18S20 or DS1820
+    raw = raw << 3; // 9 bit resolution default
+    if (data[7] == 0x10) {
+      // "count remain" gives full 12 bit resolution
+      raw = (raw & 0xFFF0) + 12 - data[6];
     }
+  } else {
+    byte cfg = (data[4] & 0x60);
+    // at lower res, the low bits are undefined, so let's zero them
+    if (cfg == 0x00) raw = raw & ~7;  // 9 bit resolution, 93.75 ms
+    else if (cfg == 0x20) raw = raw & ~3; // 10 bit res, 187.5 ms
+    else if (cfg == 0x40) raw = raw & ~1; // 11 bit res, 375 ms
+    // default is 12 bit resolution, 750 ms conversion time
+
+    if (resolution != nullptr) *resolution = 9 + (cfg >> 5);
+  }
 
-    return raw;
+  return raw;
+}
+
+// this function returns the RAW temperature conversion result of a SINGLE selected DS18B20 device (via it's address)
+// The resolution in bits is returned in resolution, if given.
+int16_t _readConversion(OneWireMaster &ds, const uint8_t addr[8], uint8_t *resolution = nullptr) {
+  byte data[9];
+
+  if (readScratchpad(ds, addr, data)) {
+    return scratchpadToRaw(addr[0], data, resolution);
   } else {
     return UNSET_TEMPERATURE;
   }
@@ -181,15 +256,22 @@ int16_t _readConversion(DS2480B &ds, const uint8_t addr[8]) {
 // This function returns the RAW temperature conversion result of a SINGLE selected DS18B20 device (via it's address).
 // Multiple retries are done in case of bus error or CRC missmatch.
 // UNSET_TEMPERATURE is returned if no temperature could be read.
-int16_t readConversion(DS2480B &ds, onewireNode &node) {
+int16_t readConversion(OneWireMaster &ds, onewireNode &node) {
   uint8_t consecutiveReadTries = 0;
   int16_t temp = UNSET_TEMPERATURE;
 
   do {
-    temp = _readConversion(ds, node.id);
+    temp = _readConversion(ds, node.id, &node.resolution);
 
     if (temp == UNSET_TEMPERATURE) {
       node.errors++;
+
+      // retrying won't help if nothing answers or the bus is shorted.
+      auto status = ds.getStatus();
+      if (status == ONEWIRE_NO_PRESENCE || status == ONEWIRE_SHORTED) {
+        ESP_LOGW(TAG, "Reading %s failed: %s.", node.idStr, OneWireMaster::statusToString(status));
+        break;
+      }
     } else {
       node.success++;
     }
@@ -199,12 +281,121 @@ int16_t readConversion(DS2480B &ds, onewireNode &node) {
   return temp;
 }
 
+// Write TH, TL and, for the DS18B20 and DS1822, the configuration register of a SINGLE sensor (via MATCH ROM).
+// The scratchpad is checked and then copied to the sensor's EEPROM, so the values survive a power loss.
+bool writeScratchpad(OneWireMaster &ds, onewireNode &node, int8_t th, int8_t tl, uint8_t config) {
+  uint8_t data[9];
+  uint8_t buf[4] = {WRITE_SCRATCHPAD, (uint8_t)th, (uint8_t)tl, config};
+  bool hasConfig = node.familyId != DS18S20;  // the DS18S20 only has TH and TL
+
+  if (!ds.reset()) {
+    return false;
+  }
+  ds.select(node.id);
+  if (!ds.write_bytes(buf, hasConfig ? 4 : 3)) {
+    return false;
+  }
+
+  // check what arrived before it is made permanent.
+  if (!readScratchpad(ds, node.id, data) || data[HIGH_ALARM_TEMP] != buf[1] || data[LOW_ALARM_TEMP] != buf[2] ||
+      (hasConfig && data[CONFIGURATION] != config) || !ds.reset()) {
+    return false;
+  }
+
+  // the copy takes up to 10 ms, a parasite powered sensor needs the strong pullup for it.
+  ds.select(node.id);
+  if (node.parasite) {
+    if (!ds.writeStrongPullup(COPY_SCRATCHPAD)) {
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(DS18X20_COPY_SCRATCHPAD_TIME));
+    ds.endStrongPullup();
+  } else {
+    ds.write(COPY_SCRATCHPAD);
+    vTaskDelay(pdMS_TO_TICKS(DS18X20_COPY_SCRATCHPAD_TIME));
+  }
+
+  return ds.getStatus() == ONEWIRE_OK;
+}
+
+// Set the resolution (9-12 bits) of a SINGLE DS18B20 or DS1822 (via MATCH ROM), the alarm registers are kept.
+// Returns true if the sensor has the new resolution, the DS18S20 can't be changed.
+bool setResolution(OneWireMaster &ds, onewireNode &node, uint8_t resolution) {
+  if (node.familyId == DS18S20 || resolution < 9 || resolution > 12) {
+    return false;
+  }
+
+  uint8_t data[9];
+
+  // TH and TL are written together with the configuration, so read them first.
+  if (!readScratchpad(ds, node.id, data) ||
+      !writeScratchpad(ds, node, data[HIGH_ALARM_TEMP], data[LOW_ALARM_TEMP], ((resolution - 9) << 5) | 0x1F)) {  // same as DS18B20_RESOLUTION
+    return false;
+  }
+
+  node.resolution = resolution;
+  return true;
+}
+
+// The sensor alarms when the whole degrees of a conversion are >= TH or <= TL, so TH and TL are set to
+// alarm on every temperature above highLimit or below lowLimit. A missing limit never alarms.
+int8_t alarmHigh(const onewireNode &node) {
+  return node.highLimit > UNSET_TEMPERATURE ? constrain(floor(node.highLimit), -128, 127) : 127;
+}
+
+int8_t alarmLow(const onewireNode &node) {
+  return node.lowLimit > UNSET_TEMPERATURE ? constrain(ceil(node.lowLimit) - 1, -128, 127) : -128;
+}
+
+// Program the alarm registers of a SINGLE sensor from its lowLimit and highLimit, so an ALARM SEARCH
+// finds it when it is outside its limits. The resolution is kept.
+bool setAlarmLimits(OneWireMaster &ds, onewireNode &node) {
+  uint8_t data[9];
+
+  if (!readScratchpad(ds, node.id, data)) {
+    node.alarmLimits = false;
+  } else if ((int8_t)data[HIGH_ALARM_TEMP] == alarmHigh(node) && (int8_t)data[LOW_ALARM_TEMP] == alarmLow(node)) {
+    node.alarmLimits = true;  // already there, spare the EEPROM
+  } else {
+    node.alarmLimits = writeScratchpad(ds, node, alarmHigh(node), alarmLow(node), data[CONFIGURATION]);
+  }
+  return node.alarmLimits;
+}
+
+// Find the sensors on the bus that are outside their alarm limits after the last conversion, they get
+// alarming set. Returns false if the search failed, it isn't known then which sensors are alarming.
+bool findAlarmingSensors(OneWireMaster &ds) {
+  uint8_t addr[8];
+
+  ds.reset_search();
+  while (ds.search(addr, false)) {
+    auto node = getOneWireNode(addr);
+    if (node != nullptr) {
+      node->alarming = true;
+    }
+  }
+  ds.reset_search();
+
+  // finding no alarming sensor isn't an error, the status tells if the bus failed.
+  return ds.getStatus() == ONEWIRE_OK;
+}
+
+// Find out how the sensor is powered and its resolution, which decides how its bus is converted.
+bool probeSensor(OneWireMaster &ds, onewireNode &node) {
+  node.parasite = ds.isParasitePowered(node.id);
+  if (ds.getStatus() != ONEWIRE_OK) {
+    return false;
+  }
+
+  return readConversion(ds, node) != UNSET_TEMPERATURE;
+}
+
 float rawToCelsius(int16_t raw) {
   return (float)raw / 16.0;
 }
 
 bool isTemperatureSensor(uint8_t familyId) {
-  return familyId == DS1822 || familyId == DS18S20 || familyId == DS18B20;
+  return deviceFamily(familyId).has(FAMILY_TEMPERATURE);
 }
 
 #endif
\ No newline at end of file
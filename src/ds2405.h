@@ -0,0 +1,43 @@
+//https://datasheets.maximintegrated.com/en/ds/DS2405.pdf
+#ifndef DS2405_h
+#define DS2405_h
+
+#include <OneWireMaster.h>
+#include "onewire.h"
+#include "tinyowc.h"
+
+// Each MATCH ROM toggles the output, so a wrong level is corrected by selecting the DS2405 once more.
+#define DS2405_MAX_TOGGLES 3
+
+/**
+ * Turn the output transistor of the DS2405 on or off. Every MATCH ROM toggles the output, the read
+ * time slot that follows gives the level of the PIO pin, low when the output is on. The DS2405 is
+ * selected again until the pin has the wanted level. It has no overdrive and no RESUME.
+ * @return false if the output couldn't be set.
+ */
+bool setDS2405State(OneWireMaster &ds, onewireNode &node, bool on) {
+  if (node.id[0] != DS2405) {
+    ESP_LOGW(TAG, "Device is not a DS2405!");
+    return false;
+  }
+
+  for (uint8_t toggles = 0; toggles < DS2405_MAX_TOGGLES; toggles++) {
+    if (!ds.reset()) {
+      ESP_LOGW(TAG, "Reset DS2405 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+      node.errors++;
+      return false;
+    }
+
+    ds.select(node.id);
+    if (ds.read_bit() != on) {
+      node.success++;
+      return true;
+    }
+  }
+
+  ESP_LOGW(TAG, "DS2405 %s doesn't turn %s.", node.idStr, on ? "on" : "off");
+  node.errors++;
+  return false;
+}
+
+#endif
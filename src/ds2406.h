@@ -0,0 +1,107 @@
+//https://datasheets.maximintegrated.com/en/ds/DS2406.pdf
+#ifndef DS2406_h
+#define DS2406_h
+
+#include <OneWireMaster.h>
+#include "onewire.h"
+#include "tinyowc.h"
+
+#define DS2406_READ_STATUS 0xAA
+#define DS2406_WRITE_STATUS 0x55
+
+// Status memory byte 7 holds the channel flip-flops, 0 = output transistor on.
+#define DS2406_STATUS_ADDRESS 0x07
+#define DS2406_PIOA 0x20
+#define DS2406_PIOB 0x40
+#define DS2406_SUPPLY 0x80  // read only, VCC powered
+
+/**
+ * The flip-flops of PIOA (bit 0) and PIOB (bit 1) in status byte 7.
+ */
+uint8_t ds2406Latch(uint8_t status) {
+  return (status >> 5) & 0x03;
+}
+
+/**
+ * Set the channel flip-flops of PIOA (bit 0) and PIOB (bit 1), a 0 bit turns the output transistor on.
+ * Status byte 7 is written with the conditional search off. The DS2406 answers with the inverted CRC16
+ * of the command, address and data, then reads the byte back. Both are checked.
+ * @return false if the write failed.
+ */
+bool setDS2406State(OneWireMaster &ds, onewireNode &node, uint8_t latch) {
+  if (node.id[0] != DS2406) {
+    ESP_LOGW(TAG, "Device is not a DS2406!");
+    return false;
+  }
+
+  if (!ds.reset()) {
+    ESP_LOGW(TAG, "Reset DS2406 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return false;
+  }
+
+  selectNode(ds, node);
+  uint8_t data = (latch & 0x03) << 5;
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+
+  do {
+    uint8_t buf[7] = {DS2406_WRITE_STATUS, DS2406_STATUS_ADDRESS, 0x00, data, 0xFF, 0xFF, 0xFF};  // command, address, data, CRC16, data read back
+
+    if (!ds.block(buf, sizeof(buf))) {
+      ESP_LOGW(TAG, "DS2406 write transfer failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    } else if (!OneWireMaster::check_crc16(buf, 4, buf + 4)) {
+      ESP_LOGW(TAG, "CRC failure writing DS2406 %s, trying again...", node.idStr);
+    } else if ((buf[6] & ~DS2406_SUPPLY) != data) {
+      ESP_LOGW(TAG, "DS2406 read back %02X instead of %02X, trying again...", buf[6], data);
+    } else {
+      node.success++;
+      return true;
+    }
+
+    node.errors++;
+    if (!resumeNode(ds, node, "setDS2406State")) {
+      return false;
+    }
+  } while (--retries);
+
+  return false;
+}
+
+/**
+ * Read status byte 7 of the DS2406, CRC16 checked.
+ * @return the status byte, -1 if it couldn't be read.
+ */
+int16_t readDS2406(OneWireMaster &ds, onewireNode &node) {
+  if (!ds.reset()) {
+    ESP_LOGW(TAG, "Reset DS2406 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return -1;
+  }
+
+  selectNode(ds, node);
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+
+  do {
+    uint8_t buf[6] = {DS2406_READ_STATUS, DS2406_STATUS_ADDRESS, 0x00, 0xFF, 0xFF, 0xFF};  // command, address, byte 7, CRC16
+    CRC16Verifier crc(0, 4);
+
+    if (ds.block(buf, sizeof(buf), &crc)) {
+      node.success++;
+      return buf[3];
+    }
+
+    node.errors++;
+    if (ds.getStatus() == ONEWIRE_CRC_ERROR) {
+      ESP_LOGW(TAG, "CRC failure reading DS2406 %s, trying again...", node.idStr);
+    } else {
+      ESP_LOGW(TAG, "Reading DS2406 failed: %s, trying again...", OneWireMaster::statusToString(ds.getStatus()));
+    }
+    if (!resumeNode(ds, node, "readDS2406")) {
+      return -1;
+    }
+  } while (--retries);
+
+  return -1;
+}
+
+#endif
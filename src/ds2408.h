@@ -3,107 +3,272 @@
 #ifndef DS2408_h
 #define DS2408_h
 
-#include <DS2480B.h>
+#include <OneWireMaster.h>
 #include "onewire.h"
 #include "tinyowc.h"
 
 #define PIO_LOGIC_STATE_REGISTER 0x88
 #define OUTPUT_LATCH_STATE_REGISTER 0x89
-#define RESUME 0xA5
+#define CONDITIONAL_SEARCH_MASK_REGISTER 0x8B
 #define READ_PIO_REGISTERS 0xF0
+#define CHANNEL_ACCESS_WRITE 0x5A
+#define CHANNEL_ACCESS_CONFIRMATION 0xAA
+#define RESET_ACTIVITY_LATCHES 0xC3
+#define WRITE_CONDITIONAL_SEARCH_REGISTER 0xCC
 
-int16_t setState(DS2480B &ds, onewireNode &node, uint8_t state) {
+// Control/status register bits.
+#define DS2408_PLS 0x01   // the conditional search looks at the activity latches instead of the pins
+#define DS2408_ROS 0x04   // RSTZ is a strobe output
+#define DS2408_PORL 0x08  // power-on reset latch, set until written to 0
+
+// Conditional search setup, a board answers the ALARM SEARCH when any pin has changed since the
+// activity latches were reset (all pins selected, polarity 1, OR:ed) or when it has been power cycled.
+#define DS2408_SEARCH_MASK 0xFF
+#define DS2408_SEARCH_POLARITY 0xFF
+#define DS2408_SEARCH_CONTROL (DS2408_PLS | DS2408_ROS)
+
+/**
+ * The DS2408 registers from the PIO logic state to the control/status register.
+ */
+struct DS2408Registers {
+  uint8_t pio;       // 88h, sampled pin states
+  uint8_t latch;     // 89h, output latches, 0 = output transistor on
+  uint8_t activity;  // 8Ah, 1 = pin has changed since the activity latches were reset
+  uint8_t mask;      // 8Bh, conditional search channel selection
+  uint8_t polarity;  // 8Ch, conditional search channel polarity
+  uint8_t control;   // 8Dh, control/status
+};
+
+// Each DS2408 is addressed with MATCH ROM, so several can share a bus. A retry after a failed transfer
+// reselects the same device with RESUME instead of sending the 64 ROM bits again.
+// SKIP ROM was used here before, since MATCH ROM gave CRC errors: ROM bytes E1h and F1h were doubled in
+// the DS2480B data mode and put twice on the bus. Now only E3h is doubled, see DS2480B::write().
+
+/**
+ * Set the output latches of the pins, a 0 bit turns the output transistor on.
+ * The channel-access write sends the state and its inverse, the DS2408 confirms with AAh and then
+ * samples the pins. The write is verified, every pin with the output on has to read low.
+ * @return the sampled pin states, -1 if the write failed.
+ */
+int16_t setState(OneWireMaster &ds, onewireNode &node, uint8_t state) {
   if (node.id[0] != DS2408) {
     ESP_LOGW(TAG, "Device is not a DS2408!");
     return -1;
   }
 
-  if (ds.reset()) {      // onewire initialization sequence, to be followed by other commands
-    ESP_LOGD(TAG, "Set DS2408 state to: %s.", String(state, BIN));
-    
-    uint8_t retries = MAX_CONSECUTIVE_RETRIES;
-    //ds.select(node.id); // issues onewire "MATCH ROM" address which selects a SPECIFIC (only one) 1-Wire device
-    ds.write(SKIP_ROM); // HACK, this select all devices on the bus, but we should select only this single device. Though I get CRC-errors using above line.
+  if (!ds.reset()) {      // onewire initialization sequence, to be followed by other commands
+    ESP_LOGW(TAG, "Reset DS2408 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return -1;
+  }
 
-    do {
-      ds.write(0x5A);   // Issue Channel-access Write command
-      ds.write(state);  // Write byte to PIO
-      ds.write(~state); // Write inverted byte to PIO
-      auto status = ds.read();  // Read for verification (AAh = success)
-      auto newState = ds.read();  // DS2408 samples PIO pin status
-
-      if (status == 0xAA) {  // AAh = success
-        ESP_LOGD(TAG, "DS2408 current state: %s.", String(newState, BIN));
-        node.success++;
-        return newState;
-      } else {
-        node.errors++;
-        ESP_LOGW(TAG, "DS2408 setState failed, trying again...");
+  char wanted[8 + 1], pins[8 + 1];
+  formatPinStates(state, wanted);
+  ESP_LOGD(TAG, "Set DS2408 state to: %s.", wanted);
+  selectNode(ds, node); // issues onewire "MATCH ROM" address which selects a SPECIFIC (only one) 1-Wire device
 
-        if (ds.reset()) {
-          ds.write(RESUME); // reselect last selected device.
-        } else {
-          ESP_LOGW(TAG, "Reset DS2408 failed after non-success setState.");
-          node.errors++;
-          return -1;
-        }
-      }
-    } while (--retries);
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+
+  do {
+    uint8_t buf[5] = {CHANNEL_ACCESS_WRITE, state, (uint8_t)~state, 0xFF, 0xFF};  // command, state, inverted state, confirmation, pin states
+
+    if (!ds.block(buf, sizeof(buf))) {
+      ESP_LOGW(TAG, "DS2408 setState transfer failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    } else if (buf[3] != CHANNEL_ACCESS_CONFIRMATION) {
+      ESP_LOGW(TAG, "DS2408 setState not confirmed (%02X), trying again...", buf[3]);
+    } else if (buf[4] & ~state) {
+      formatPinStates(buf[4], pins);
+      ESP_LOGW(TAG, "DS2408 pins %s don't follow the written state %s, trying again...", pins, wanted);
+    } else {
+      formatPinStates(buf[4], pins);
+      ESP_LOGD(TAG, "DS2408 current state: %s.", pins);
+      node.success++;
+      return buf[4];
+    }
 
-    return -1;
-  } else {
-    ESP_LOGW(TAG, "Reset DS2408 failed.");
     node.errors++;
-    return -1;
-  }
+    if (!resumeNode(ds, node, "setState")) {
+      return -1;
+    }
+  } while (--retries);
+
+  return -1;
 }
 
 /**
- * Get current state of pins.
- * @return lower half (8-bit) of integer repressent the eight inputs, -1 is returned if we failed to read device.
+ * Read the registers of the DS2408 in one CRC checked transfer.
+ * @return false if we failed to read device.
  */
-int16_t getState(DS2480B &ds, onewireNode &node) {
+bool readRegisters(OneWireMaster &ds, onewireNode &node, DS2408Registers &registers) {
   if (node.id[0] != DS2408) {
     ESP_LOGW(TAG, "Device is not a DS2408!");
-    return -1;
+    return false;
   }
 
   if (ds.reset()) {      // onewire initialization sequence, to be followed by other commands
-    //ds.select(node.id);  // issues onewire "MATCH ROM" address which selects a SPECIFIC (only one) 1-Wire device
-    ds.write(SKIP_ROM); // HACK, this select all devices on the bus, but we should select only this single device. Though I get CRC-errors using above line.
+    selectNode(ds, node);  // issues onewire "MATCH ROM" address which selects a SPECIFIC (only one) 1-Wire device
 
     uint8_t retries = MAX_CONSECUTIVE_RETRIES;
 
     do {
-      uint8_t buf[13];  // Put everything in the buffer so we can compute CRC easily.
+      uint8_t buf[13];  // Put everything in the buffer so the CRC is checked as the bytes are received.
       buf[0] = READ_PIO_REGISTERS;    // Read PIO Registers
       buf[1] = PIO_LOGIC_STATE_REGISTER;    // LSB address
       buf[2] = 0x00;    // MSB address
-      ds.write_bytes(buf, 3);
-      ds.read_bytes(buf + 3, 10);     // 3 cmd bytes, 6 data bytes, 2 0xFF, 2 CRC16
+      memset(buf + 3, 0xFF, 10);  // 3 cmd bytes, 6 data bytes, 2 0xFF, 2 CRC16
+      CRC16Verifier crc(0, 11);
 
-      if (!ds.check_crc16(buf, 11, &buf[11])) {
+      if (!ds.block(buf, sizeof(buf), &crc)) {
         node.errors++;
-        ESP_LOGW(TAG, "CRC(%s) failure in getState() for DS2408, trying again...", String(buf[11], HEX));
-
-        if (ds.reset()) {
-          ds.write(RESUME); // reselect last selected device.
+        if (ds.getStatus() == ONEWIRE_CRC_ERROR) {
+          ESP_LOGW(TAG, "CRC(%02X) failure in readRegisters() for DS2408, trying again...", buf[11]);
         } else {
-          ESP_LOGW(TAG, "Reset DS2408 failed after non-success getState.");
-          node.errors++;
-          return -1;
+          ESP_LOGW(TAG, "Reading DS2408 failed: %s, trying again...", OneWireMaster::statusToString(ds.getStatus()));
+        }
+
+        if (!resumeNode(ds, node, "readRegisters")) {
+          return false;
         }
       } else {
+        memcpy(&registers, buf + 3, sizeof(registers));
         node.success++;
-        return buf[3];
+        return true;
       }
     } while (--retries);
   } else {
-    ESP_LOGW(TAG, "Reset DS2408 failed.");
+    ESP_LOGW(TAG, "Reset DS2408 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
     node.errors++;
   }
 
-  return -1;
+  return false;
+}
+
+/**
+ * Get current state of pins.
+ * @return lower half (8-bit) of integer repressent the eight inputs, -1 is returned if we failed to read device.
+ */
+int16_t getState(OneWireMaster &ds, onewireNode &node) {
+  DS2408Registers registers;
+
+  if (!readRegisters(ds, node, registers)) {
+    return -1;
+  }
+  return registers.pio;
+}
+
+/**
+ * Clear the activity latches, the DS2408 confirms with AAh.
+ */
+bool resetActivityLatches(OneWireMaster &ds, onewireNode &node) {
+  if (!ds.reset()) {
+    ESP_LOGW(TAG, "Reset DS2408 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return false;
+  }
+
+  selectNode(ds, node);
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+
+  do {
+    uint8_t buf[2] = {RESET_ACTIVITY_LATCHES, 0xFF};
+
+    if (ds.block(buf, sizeof(buf)) && buf[1] == CHANNEL_ACCESS_CONFIRMATION) {
+      node.success++;
+      return true;
+    }
+
+    ESP_LOGW(TAG, "Reset of DS2408 activity latches not confirmed, trying again...");
+    node.errors++;
+    if (!resumeNode(ds, node, "resetActivityLatches")) {
+      return false;
+    }
+  } while (--retries);
+
+  return false;
+}
+
+/**
+ * Set up the conditional search to find the DS2408 when a pin changes, also clears the power-on reset latch.
+ */
+bool configureActivitySearch(OneWireMaster &ds, onewireNode &node) {
+  if (!ds.reset()) {
+    ESP_LOGW(TAG, "Reset DS2408 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return false;
+  }
+
+  selectNode(ds, node);
+  // the target address increments after each byte, 8Bh to 8Dh are written in one go.
+  uint8_t buf[6] = {WRITE_CONDITIONAL_SEARCH_REGISTER, CONDITIONAL_SEARCH_MASK_REGISTER, 0x00,
+                    DS2408_SEARCH_MASK, DS2408_SEARCH_POLARITY, DS2408_SEARCH_CONTROL};
+
+  if (!ds.write_bytes(buf, sizeof(buf))) {
+    ESP_LOGW(TAG, "Configuring DS2408 conditional search failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Find the DS2408s that answer the conditional search, since a pin changed or they have been power cycled.
+ * They get alarming set, the other nodes aren't touched.
+ * @return false if the search failed, it isn't known then which boards have changed.
+ */
+bool findActiveBoards(OneWireMaster &ds) {
+  uint8_t addr[8];
+
+  ds.reset_search();
+  while (ds.search(addr, false)) {
+    auto node = getOneWireNode(addr);
+    // alarming temperature sensors answer the same search.
+    if (node != nullptr && node->familyId == DS2408) {
+      node->alarming = true;
+    }
+  }
+  ds.reset_search();
+
+  return ds.getStatus() == ONEWIRE_OK;
+}
+
+/**
+ * Verify the output latches against pinStates and write them again if they differ. The activity
+ * latches are then reset, so the board doesn't answer the conditional search until a pin changes again.
+ * A board that has been power cycled gets its conditional search set up again.
+ * @return 1 if the latches had to be written again, 0 if they were as expected, -1 if the board couldn't be read or corrected.
+ */
+int8_t reconcileState(OneWireMaster &ds, onewireNode &node) {
+  DS2408Registers registers;
+
+  if (!readRegisters(ds, node, registers)) {
+    return -1;
+  }
+
+  uint8_t expected = ~node.pinStates;  // invert, low means On (reversed logic)
+
+  if ((registers.control & DS2408_PORL) || registers.mask != DS2408_SEARCH_MASK || registers.polarity != DS2408_SEARCH_POLARITY) {
+    ESP_LOGW(TAG, "DS2408 %s has been reset, configuring it again.", node.idStr);
+    if (!configureActivitySearch(ds, node)) {
+      return -1;
+    }
+  }
+
+  int8_t result = 0;
+  if (registers.latch != expected) {
+    char latched[8 + 1], wanted[8 + 1];
+    formatPinStates(registers.latch, latched);
+    formatPinStates(expected, wanted);
+    ESP_LOGW(TAG, "DS2408 %s state %s differs from the actuator state %s, writing it again.", node.idStr, latched, wanted);
+    if (setState(ds, node, expected) < 0) {
+      return -1;
+    }
+    result = 1;
+  }
+
+  if (!resetActivityLatches(ds, node)) {
+    return -1;
+  }
+  return result;
 }
 
 /**
@@ -112,7 +277,7 @@ int16_t getState(DS2480B &ds, onewireNode &node) {
  * feature enabled. When this occurs, the P0 port does not respond to the Channel Access Write command."
  * @return 0=failed, 1=success
  */
-bool existTestMode(DS2480B &ds, onewireNode &node) {
+bool existTestMode(OneWireMaster &ds, onewireNode &node) {
   // RST PD 96h <64-bit DS2408 ROM Code> 3Ch RST PD
   if (ds.reset()) {  // onewire initialization sequence, to be followed by other commands
     ds.write(0x96);
@@ -129,36 +294,25 @@ bool existTestMode(DS2480B &ds, onewireNode &node) {
   return 0;
 }
 
-void ds2408_reset(DS2480B &ds, onewireNode &node) {
-  ESP_LOGD(TAG, "Reset DS2408, id: %s.", node.idStr.c_str());
+void ds2408_reset(OneWireMaster &ds, onewireNode &node) {
+  ESP_LOGD(TAG, "Reset DS2408, id: %s.", node.idStr);
   
   if (existTestMode(ds, node)) {
-    // Configure RSTZ as STRB output.
-    //ds.select(node.id); // reselect last selected device.
-    ds.write(SKIP_ROM); // HACK, this select all devices on the bus, but we should select only this single device. Though I get CRC-errors using above line.
-    ds.write(0xCC);  // Issue Write Conditional Search Register command
-    ds.write(0x8D);  // TA1, target address = 8Dh
-    ds.write(0x00);  // TA2, target address = 008Dh
-    ds.write(0x04);  // Write byte to Control/Status Register, RSTZ as STRB output
-
-    // Verify configuration setting
-    if (!ds.reset()) {
-      ESP_LOGW(TAG, "Reset DS2408 failed after non-success configure RSTZ as STRB.");
-      node.errors++;
+    // Configure RSTZ as STRB output, and the conditional search on the activity latches.
+    if (!configureActivitySearch(ds, node)) {
       return;
     }
 
-    ds.write(RESUME); // reselect last selected device.
-    ds.write(0xF0);  // Issue Read PIO Registers command
-    ds.write(0x8D);  // TA1, target address = 8Dh
-    ds.write(0x00);  // TA2, target address = 008Dh
-    auto status = ds.read(); // Read Control/Status Register and verify
-    ESP_LOGD(TAG, "DS2408 verify configuration setting: %s.", String(status, HEX));
+    // Verify configuration setting
+    DS2408Registers registers;
+    if (readRegisters(ds, node, registers)) {
+      ESP_LOGD(TAG, "DS2408 verify configuration setting: %02X.", registers.control);
+    }
 
     // Set all relays off.
     setState(ds, node, B11111111);
   } else {
-    ESP_LOGW(TAG, "Reset DS2408 failed for id: %s.", node.idStr.c_str());
+    ESP_LOGW(TAG, "Reset DS2408 failed for id: %s.", node.idStr);
   }
 }
 #endif
\ No newline at end of file
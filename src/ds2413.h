@@ -0,0 +1,116 @@
+//https://datasheets.maximintegrated.com/en/ds/DS2413.pdf
+#ifndef DS2413_h
+#define DS2413_h
+
+#include <OneWireMaster.h>
+#include "onewire.h"
+#include "tinyowc.h"
+
+#define DS2413_PIO_ACCESS_READ 0xF5
+#define DS2413_PIO_ACCESS_WRITE 0x5A
+#define DS2413_CONFIRMATION 0xAA
+
+// The PIO output data byte, bits 2-7 have to be 1s.
+#define DS2413_DATA_MASK 0xFC
+
+/**
+ * Check the status byte of a PIO access, the upper nibble is the complement of the lower one.
+ */
+bool ds2413ValidStatus(uint8_t status) {
+  return (status >> 4) == (~status & 0x0F);
+}
+
+/**
+ * The output latches of PIOA (bit 0) and PIOB (bit 1) in a status byte, 0 = output transistor on.
+ */
+uint8_t ds2413Latch(uint8_t status) {
+  return ((status >> 1) & 0x01) | ((status >> 2) & 0x02);
+}
+
+/**
+ * The pin levels of PIOA (bit 0) and PIOB (bit 1) in a status byte.
+ */
+uint8_t ds2413Pins(uint8_t status) {
+  return (status & 0x01) | ((status >> 1) & 0x02);
+}
+
+/**
+ * Set the output latches of PIOA (bit 0) and PIOB (bit 1), a 0 bit turns the output transistor on.
+ * The PIO access write sends the data and its inverse, the DS2413 confirms with AAh and then sends
+ * the new status. The write is verified, the latches have to match and every pin with the output on has to read low.
+ * @return the status byte, -1 if the write failed.
+ */
+int16_t setDS2413State(OneWireMaster &ds, onewireNode &node, uint8_t latch) {
+  if (node.id[0] != DS2413) {
+    ESP_LOGW(TAG, "Device is not a DS2413!");
+    return -1;
+  }
+
+  if (!ds.reset()) {
+    ESP_LOGW(TAG, "Reset DS2413 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return -1;
+  }
+
+  selectNode(ds, node);
+  uint8_t data = DS2413_DATA_MASK | (latch & 0x03);
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+
+  do {
+    uint8_t buf[5] = {DS2413_PIO_ACCESS_WRITE, data, (uint8_t)~data, 0xFF, 0xFF};  // command, data, inverted data, confirmation, status
+
+    if (!ds.block(buf, sizeof(buf))) {
+      ESP_LOGW(TAG, "DS2413 write transfer failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    } else if (buf[3] != DS2413_CONFIRMATION) {
+      ESP_LOGW(TAG, "DS2413 write not confirmed (%02X), trying again...", buf[3]);
+    } else if (!ds2413ValidStatus(buf[4]) || ds2413Latch(buf[4]) != (latch & 0x03)) {
+      ESP_LOGW(TAG, "DS2413 status %02X doesn't match the written latches %02X, trying again...", buf[4], latch);
+    } else if (ds2413Pins(buf[4]) & ~latch & 0x03) {
+      ESP_LOGW(TAG, "DS2413 pins %02X don't follow the written latches %02X, trying again...", buf[4], latch);
+    } else {
+      node.success++;
+      return buf[4];
+    }
+
+    node.errors++;
+    if (!resumeNode(ds, node, "setDS2413State")) {
+      return -1;
+    }
+  } while (--retries);
+
+  return -1;
+}
+
+/**
+ * Read the status byte of the DS2413, checked by its complemented upper nibble.
+ * @return the status byte, -1 if it couldn't be read.
+ */
+int16_t readDS2413(OneWireMaster &ds, onewireNode &node) {
+  if (!ds.reset()) {
+    ESP_LOGW(TAG, "Reset DS2413 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return -1;
+  }
+
+  selectNode(ds, node);
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+
+  do {
+    uint8_t buf[2] = {DS2413_PIO_ACCESS_READ, 0xFF};
+
+    if (ds.block(buf, sizeof(buf)) && ds2413ValidStatus(buf[1])) {
+      node.success++;
+      return buf[1];
+    }
+
+    ESP_LOGW(TAG, "Reading DS2413 %s failed, trying again...", node.idStr);
+    node.errors++;
+    if (!resumeNode(ds, node, "readDS2413")) {
+      return -1;
+    }
+  } while (--retries);
+
+  return -1;
+}
+
+#endif
@@ -1,7 +1,8 @@
 #ifndef DS2423_h
 #define DS2423_h
 
-#include <DS2480B.h>
+#include <OneWireMaster.h>
+#include <esp_timer.h>
 #include "onewire.h"
 #include "tinyowc.h"
 
@@ -9,67 +10,137 @@
 #define DS2423_PAGE_TWO 0xE0  // counter B
 #define DS2423_READ_MEMORY_PLUS_COUNTERS_COMMAND 0xA5
 
+// Bytes read per page by Read Memory + Counter: 32 data bytes, the counter, 4 zeros and the inverted CRC16.
+#define DS2423_PAGE_READ_LENGTH 42
+#define DS2423_COUNTER_OFFSET 32
+
+/**
+ * Read Memory + Counter from the start of page (DS2423_PAGE_ONE or DS2423_PAGE_TWO) and on, pages pages in one
+ * transfer. The device is selected first if select is set, otherwise it has to be selected already (e.g. by RESUME).
+ * The CRC16 of each page is checked as it's received, the first one also covers the command and address.
+ * @return number of pages read with a valid CRC16, their counters are stored in counts.
+ */
+uint8_t readCounterPages(OneWireMaster &ds, const onewireNode *select, uint8_t page, uint8_t pages, uint32_t *counts) {
+  // MATCH ROM, the command and the pages read back are sent as one block transfer.
+  uint8_t request[9 + 3 + 2 * DS2423_PAGE_READ_LENGTH];
+  uint8_t *buf = request + 9;
+  uint16_t length = 3 + pages * DS2423_PAGE_READ_LENGTH;
+  uint8_t skip = 0;
+
+  buf[0] = DS2423_READ_MEMORY_PLUS_COUNTERS_COMMAND;
+  buf[1] = page;
+  buf[2] = 0x01;
+  memset(buf + 3, 0xFF, length - 3);
+
+  if (select != nullptr && select->overdrive) {
+    ds.selectOverdrive(select->id);  // overdrive speed needs the speed switch between MATCH ROM and the command.
+  } else if (select != nullptr) {
+    request[0] = MATCH_ROM;  // issues onewire "MATCH ROM" address which selects a SPECIFIC (only one) 1-Wire device
+    memcpy(request + 1, select->id, 8);
+    skip = 9;
+  }
+
+  // command, address, page, counter and zeros are covered by the first CRC16, the following ones cover their page only.
+  CRC16Verifier crc(skip, 3 + DS2423_PAGE_READ_LENGTH - 2, DS2423_PAGE_READ_LENGTH - 2);
+  uint8_t valid = ds.block(buf - skip, skip + length, &crc) ? pages : crc.getVerified();
+
+  for (uint8_t i = 0; i < valid; i++) {
+    uint8_t *counter = buf + 3 + i * DS2423_PAGE_READ_LENGTH + DS2423_COUNTER_OFFSET;
+    counts[i] = (uint32_t)counter[0] | (uint32_t)counter[1] << 8 | (uint32_t)counter[2] << 16 | (uint32_t)counter[3] << 24;
+  }
+  return valid;
+}
+
 /**
- * Return counter value from DS2423-device.
- * @returns lower 32-bit is counter value. -1 if reading failed
+ * Read counter A and B of a DS2423 in one transfer, a page that fails its CRC16 is read again after a RESUME.
+ * counts is only set when both counters have been read, so they always belong together. Only the error
+ * and success counts of the node are changed, this can run on the 1-Wire task.
+ * @return false if reading failed.
  */
-int64_t getCounter(DS2480B &ds, onewireNode &node, uint8_t counterNr) {
+bool readCounters(OneWireMaster &ds, onewireNode &node, uint32_t counts[2]) {
   if (node.id[0] != DS2423) {
     ESP_LOGW(TAG, "Device in not a DS2423!");
-    return -1;
+    return false;
   }
 
-  if (counterNr > 1) {
-    ESP_LOGW(TAG, "Only counters 0(A) and 1(B) is supported!");
-    return -1;
+  if (!ds.reset()) {      // onewire initialization sequence, to be followed by other commands
+    ESP_LOGW(TAG, "Reset DS2423 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return false;
   }
 
-  if (ds.reset()) {      // onewire initialization sequence, to be followed by other commands
-    ds.select(node.id);  // issues onewire "MATCH ROM" address which selects a SPECIFIC (only one) 1-Wire device
-
-    uint8_t buf[45];
+  uint32_t pageCounts[2];
+  uint8_t read = 0;
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+  const onewireNode *select = &node;
 
-    buf[0] = DS2423_READ_MEMORY_PLUS_COUNTERS_COMMAND;
-    buf[1] = counterNr == 0 ? DS2423_PAGE_ONE : DS2423_PAGE_TWO;
-    buf[2] = 0x01;
-    ds.write_bytes(buf, 3);
+  do {
+    // counter B follows counter A, a retry continues with the page that failed.
+    read += readCounterPages(ds, select, read == 0 ? DS2423_PAGE_ONE : DS2423_PAGE_TWO, 2 - read, pageCounts + read);
 
-    for (int j = 3; j < 45; j++) {
-      buf[j] = ds.read();
+    if (read == 2) {
+      counts[0] = pageCounts[0];
+      counts[1] = pageCounts[1];
+      node.success++;
+      return true;
     }
 
-    uint32_t count = (uint32_t)buf[38];
-    for (int j = 37; j >= 35; j--) {
-      count = (count << 8) + (uint32_t)buf[j];
-    }
-    uint16_t crc = ds.crc16(buf, 43);
-    uint8_t *crcBytes = (uint8_t *)&crc;
-    uint8_t crcLo = ~buf[43];
-    uint8_t crcHi = ~buf[44];
-    boolean error = (crcLo != crcBytes[0]) || (crcHi != crcBytes[1]);
-///----- TODO: REMOVE
-/*    for (int j = 0; j < 44; j++) {
-      Serial.print(buf[j]);
-      Serial.print(" ");
-    }
-    Serial.println();
-    Serial.println();
-    ESP_LOGI(TAG, "count: %d", count);*/
-///----- TODO: REMOVE ^^^
-    if (error) {
-      ESP_LOGW(TAG, "CRC(%s) failure in getCounter() for DS2423.", String(buf[11], HEX));
-      //TODO: add error handling and retry logic, see ds2408.h-code!
-      node.errors++;
-      return -1;
+    node.errors++;
+    if (ds.getStatus() == ONEWIRE_CRC_ERROR) {
+      ESP_LOGW(TAG, "CRC failure reading counter %c of DS2423, trying again...", 'A' + read);
     } else {
-      node.success++;
-      return count;
+      ESP_LOGW(TAG, "Reading DS2423 failed: %s, trying again...", OneWireMaster::statusToString(ds.getStatus()));
     }
-  } else {
-    ESP_LOGW(TAG, "Reset DS2423 failed.");
-    node.errors++;
-    return -1;
+
+    if (!resumeNode(ds, node, "getCounters")) {
+      return false;
+    }
+    select = nullptr;
+  } while (--retries);
+
+  return false;
+}
+
+/**
+ * Read counter A and B of a DS2423 into node.counters, see readCounters().
+ * @return false if reading failed.
+ */
+bool getCounters(OneWireMaster &ds, onewireNode &node) {
+  uint32_t counts[2];
+
+  if (!readCounters(ds, node, counts)) {
+    return false;
   }
+  node.counters[0] = counts[0];
+  node.counters[1] = counts[1];
+  return true;
+}
+
+/**
+ * Add the counts read at time (esp_timer_get_time()) to the counters, totals and rates of the node.
+ * In the sampling cycle this runs on loop(), where the totals are published, the read on the 1-Wire task.
+ */
+void updateCounters(onewireNode &node, const uint32_t counts[2], int64_t time) {
+  auto &state = counterState(node);
+  for (uint8_t i = 0; i < 2; i++) {
+    node.counters[i] = counts[i];
+    state.pulses[i].update(counts[i], time);
+  }
+}
+
+/**
+ * Read both counters and add them to the totals and rates of the node, timestamped right after the read.
+ * @return false if reading failed.
+ */
+bool sampleCounters(OneWireMaster &ds, onewireNode &node) {
+  uint32_t counts[2];
+
+  if (!readCounters(ds, node, counts)) {
+    return false;
+  }
+
+  updateCounters(node, counts, esp_timer_get_time());
+  return true;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,248 @@
+//https://datasheets.maximintegrated.com/en/ds/DS2450.pdf
+#ifndef DS2450_h
+#define DS2450_h
+
+#include <OneWireMaster.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "onewire.h"
+#include "tinyowc.h"
+
+#define DS2450_READ_MEMORY 0xAA
+#define DS2450_WRITE_MEMORY 0x55
+#define DS2450_CONVERT 0x3C
+
+// Memory map, each page has two bytes per channel A to D.
+#define DS2450_CONVERSION_PAGE 0x00  // conversion results, left aligned
+#define DS2450_CONTROL_PAGE 0x08     // control/status
+#define DS2450_VCC_CONTROL 0x1C      // in the calibration page
+#define DS2450_PAGE_LENGTH 8
+#define DS2450_CHANNELS 4
+
+// Control/status bits, the first byte of a channel holds the resolution (RC3-RC0, 0 = 16 bits).
+#define DS2450_RESOLUTION_MASK 0x0F
+#define DS2450_IR 0x01   // second byte, input range 5.12 V instead of 2.56 V
+#define DS2450_POR 0x80  // second byte, set on power-on until written to 0
+#define DS2450_VCC_POWERED 0x40
+
+#define DS2450_ALL_CHANNELS 0x0F
+#define DS2450_POLL_INTERVAL_MS 1
+
+/**
+ * Conversion time in microseconds of all four channels at the resolution of the node.
+ */
+int64_t ds2450ConversionTime(const onewireNode &node) {
+  return 160 + DS2450_CHANNELS * 80 * node.resolution;
+}
+
+/**
+ * The control/status page for the resolution and input ranges of the node, alarms off and the power-on flag cleared.
+ */
+void ds2450ControlPage(const onewireNode &node, uint8_t page[DS2450_PAGE_LENGTH]) {
+  for (uint8_t channel = 0; channel < DS2450_CHANNELS; channel++) {
+    page[channel * 2] = node.resolution & DS2450_RESOLUTION_MASK;
+    page[channel * 2 + 1] = bitRead(node.inputRanges, channel) ? DS2450_IR : 0x00;
+  }
+}
+
+/**
+ * Write length bytes to the DS2450 memory from address on, in one transfer. After each byte the DS2450
+ * sends the inverted CRC16 of the command, address and byte (for the following bytes of the
+ * incremented address and byte), then reads the byte back. Both are checked.
+ * @return false if the bytes couldn't be written.
+ */
+bool writeDS2450Memory(OneWireMaster &ds, onewireNode &node, uint8_t address, const uint8_t *data, uint8_t length) {
+  if (!ds.reset()) {
+    ESP_LOGW(TAG, "Reset DS2450 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return false;
+  }
+
+  selectNode(ds, node);
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+
+  do {
+    uint8_t buf[3 + 4 * DS2450_PAGE_LENGTH];
+    buf[0] = DS2450_WRITE_MEMORY;
+    buf[1] = address;
+    buf[2] = 0x00;
+    for (uint8_t i = 0; i < length; i++) {
+      buf[3 + i * 4] = data[i];
+      memset(buf + 4 + i * 4, 0xFF, 3);  // CRC16 and the byte read back
+    }
+
+    bool written = ds.block(buf, 3 + length * 4);
+    for (uint8_t i = 0; written && i < length; i++) {
+      uint8_t *segment = buf + 3 + i * 4;
+      uint16_t crc;
+      if (i == 0) {
+        crc = OneWireMaster::crc16(buf, 4);
+      } else {
+        uint8_t target[2] = {(uint8_t)(address + i), 0x00};
+        crc = OneWireMaster::crc16(segment, 1, OneWireMaster::crc16(target, 2));
+      }
+      written = OneWireMaster::check_crc16(segment, 0, segment + 1, crc) && segment[3] == data[i];
+    }
+
+    if (written) {
+      node.success++;
+      return true;
+    }
+
+    ESP_LOGW(TAG, "Writing DS2450 %s memory at %02Xh failed, trying again...", node.idStr, address);
+    node.errors++;
+    if (!resumeNode(ds, node, "writeDS2450Memory")) {
+      return false;
+    }
+  } while (--retries);
+
+  return false;
+}
+
+/**
+ * Set the resolution and input ranges of the four channels, from node.resolution and node.inputRanges.
+ * The DS2450 is assumed to be VCC powered, so the end of a conversion can be polled.
+ * @return false if the configuration couldn't be written.
+ */
+bool configureDS2450(OneWireMaster &ds, onewireNode &node) {
+  if (node.id[0] != DS2450) {
+    ESP_LOGW(TAG, "Device is not a DS2450!");
+    return false;
+  }
+
+  uint8_t page[DS2450_PAGE_LENGTH];
+  ds2450ControlPage(node, page);
+  uint8_t vcc = DS2450_VCC_POWERED;
+
+  return writeDS2450Memory(ds, node, DS2450_VCC_CONTROL, &vcc, 1) &&
+         writeDS2450Memory(ds, node, DS2450_CONTROL_PAGE, page, sizeof(page));
+}
+
+/**
+ * Convert all four channels with one Convert command, the command is checked with the CRC16 the
+ * DS2450 sends back. Returns when the read time slots show the conversion is done.
+ * @return false if the conversion couldn't be started.
+ */
+bool convertDS2450(OneWireMaster &ds, onewireNode &node) {
+  if (!ds.reset()) {
+    ESP_LOGW(TAG, "Reset DS2450 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return false;
+  }
+
+  selectNode(ds, node);
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+
+  do {
+    uint8_t buf[5] = {DS2450_CONVERT, DS2450_ALL_CHANNELS, 0x00, 0xFF, 0xFF};  // command, input select, no preset of the results, CRC16
+    CRC16Verifier crc(0, 3);
+
+    if (ds.block(buf, sizeof(buf), &crc)) {
+      // the read time slots are 0 until the conversion is done, give up after twice the worst case time.
+      auto time = ds2450ConversionTime(node);
+      auto deadline = esp_timer_get_time() + time * 2;
+      while (!ds.read_bit()) {
+        if (esp_timer_get_time() >= deadline) {
+          ESP_LOGW(TAG, "DS2450 %s conversion not done after %lld us.", node.idStr, (long long)(time * 2));
+          break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(DS2450_POLL_INTERVAL_MS));
+      }
+      return true;
+    }
+
+    ESP_LOGW(TAG, "Starting DS2450 conversion failed: %s, trying again...", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    if (!resumeNode(ds, node, "convertDS2450")) {
+      return false;
+    }
+  } while (--retries);
+
+  return false;
+}
+
+/**
+ * Read the conversion results and the control/status page of all four channels in one memory read,
+ * the CRC16 of each page is checked as it's received. The voltages are scaled by the input range the
+ * DS2450 actually used, the control page also tells if it has lost its configuration.
+ * @return false if reading failed, true and *configured false if the DS2450 has to be configured again.
+ */
+bool readDS2450(OneWireMaster &ds, onewireNode &node, bool *configured = nullptr) {
+  if (!ds.reset()) {
+    ESP_LOGW(TAG, "Reset DS2450 failed: %s.", OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return false;
+  }
+
+  selectNode(ds, node);
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+
+  do {
+    uint8_t buf[3 + 2 * (DS2450_PAGE_LENGTH + 2)];
+    buf[0] = DS2450_READ_MEMORY;
+    buf[1] = DS2450_CONVERSION_PAGE;
+    buf[2] = 0x00;
+    memset(buf + 3, 0xFF, sizeof(buf) - 3);
+    // command, address and results are covered by the first CRC16, the control page by the second.
+    CRC16Verifier crc(0, 3 + DS2450_PAGE_LENGTH, DS2450_PAGE_LENGTH);
+
+    if (ds.block(buf, sizeof(buf), &crc)) {
+      uint8_t *results = buf + 3;
+      uint8_t *control = buf + 3 + DS2450_PAGE_LENGTH + 2;
+      auto &voltages = analogState(node).voltages;
+
+      for (uint8_t channel = 0; channel < DS2450_CHANNELS; channel++) {
+        uint16_t raw = results[channel * 2] | results[channel * 2 + 1] << 8;
+        float range = (control[channel * 2 + 1] & DS2450_IR) ? 5.12 : 2.56;
+        voltages[channel] = raw * range / 65536;
+      }
+
+      if (configured != nullptr) {
+        uint8_t page[DS2450_PAGE_LENGTH];
+        ds2450ControlPage(node, page);
+        *configured = true;
+        for (uint8_t i = 0; i < DS2450_PAGE_LENGTH; i++) {
+          // the alarm flags aren't part of the configuration.
+          if ((control[i] & (i % 2 == 0 ? 0xCF : 0x8D)) != page[i]) *configured = false;
+        }
+      }
+
+      node.success++;
+      return true;
+    }
+
+    node.errors++;
+    if (ds.getStatus() == ONEWIRE_CRC_ERROR) {
+      ESP_LOGW(TAG, "CRC failure reading DS2450 %s, trying again...", node.idStr);
+    } else {
+      ESP_LOGW(TAG, "Reading DS2450 failed: %s, trying again...", OneWireMaster::statusToString(ds.getStatus()));
+    }
+    if (!resumeNode(ds, node, "readDS2450")) {
+      return false;
+    }
+  } while (--retries);
+
+  return false;
+}
+
+/**
+ * Convert and read all four channels of a DS2450. A DS2450 that has lost its configuration, e.g.
+ * after a power loss, is configured again and converted once more.
+ * @return false if converting or reading failed.
+ */
+bool sampleDS2450(OneWireMaster &ds, onewireNode &node) {
+  bool configured = true;
+
+  if (!convertDS2450(ds, node) || !readDS2450(ds, node, &configured)) {
+    return false;
+  }
+
+  if (!configured) {
+    ESP_LOGI(TAG, "DS2450 %s isn't configured, configuring it again.", node.idStr);
+    return configureDS2450(ds, node) && convertDS2450(ds, node) && readDS2450(ds, node);
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef HeapStats_h
+#define HeapStats_h
+
+#include <atomic>
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Heap allocations are only counted when "-DTINYOWC_HEAP_STATS" is added to build_flags in platformio.ini.
+// On the controller malloc(), calloc() and realloc() are wrapped, which also needs
+// "-Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc" in build_flags. new and Arduino Strings
+// allocate through them. On the host operator new is counted instead, see test/test_heap.
+
+std::atomic<uint32_t> heapAllocations{0};  // since boot, on all tasks.
+
+#ifdef TINYOWC_HEAP_STATS
+#ifdef ARDUINO_ARCH_ESP32
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  heapAllocations++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  heapAllocations++;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  heapAllocations++;
+  return __real_realloc(ptr, size);
+}
+}
+#else
+void *operator new(size_t size) {
+  heapAllocations++;
+  if (void *ptr = malloc(size)) return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+#endif
+#endif
+
+/**
+ * Heap allocations made between begin() and allocations(), e.g. by one sampling cycle. On the controller
+ * the other tasks (WiFi, AsyncTCP, MQTT) are counted as well. Always 0 without TINYOWC_HEAP_STATS.
+ */
+struct HeapProbe {
+  uint32_t start = 0;
+
+  void begin() { start = heapAllocations; }
+  uint32_t allocations() const { return heapAllocations - start; }
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include <InfluxDbClient.h>
+#include "lineprotocol.h"
 #include "onewire.h"
 #include "tinyowc.h"
 
@@ -7,6 +8,9 @@
 InfluxDBClient influxDb;
 bool isInfluxDbEnabled = false;
 
+// Points are formatted here and handed to the client as line protocol, only used from loop().
+InfluxLine influxLine;
+
 /**
  * Creates InfluxDB instance
  */
@@ -28,81 +32,22 @@ void initInfluxDB(const char *serverUrl, const char *dbname, const char *user, c
   }
 }
 
-void writeInfluxPoint(onewireNode& node) {
-  if (isInfluxDbEnabled) {
-    ESP_LOGD(TAG, "Writing node %s to InfluxDB queue.", node.idStr.c_str());
-
-    if (isTemperatureSensor(node.familyId)) {
-      Point sensor("temperature");
-      sensor.addTag("device_id", node.idStr);
-
-      if (node.name != NULL && node.name.length() > 0)
-        sensor.addTag("device_name", node.name);
-
-      sensor.addField("value", node.temperature);
-      influxDb.writePoint(sensor);
-
-    } else if (node.familyId == DS2408) {
-      Point actuator("actuator");
-      actuator.addTag("device_id", node.idStr);
-
-      if (node.name != NULL && node.name.length() > 0)
-        actuator.addTag("device_name", node.name);
-
-      actuator.addField("pin0", node.actuatorPinState[0]);
-      actuator.addField("pin1", node.actuatorPinState[1]);
-      actuator.addField("pin2", node.actuatorPinState[2]);
-      actuator.addField("pin3", node.actuatorPinState[3]);
-      actuator.addField("pin4", node.actuatorPinState[4]);
-      actuator.addField("pin5", node.actuatorPinState[5]);
-      actuator.addField("pin6", node.actuatorPinState[6]);
-      actuator.addField("pin7", node.actuatorPinState[7]);
-
-      influxDb.writePoint(actuator);
-
-    } else if (node.familyId == DS2406 || node.familyId == DS2413) {
-      Point actuator("actuator");
-      actuator.addTag("device_id", node.idStr);
-
-      if (node.name != NULL && node.name.length() > 0)
-        actuator.addTag("device_name", node.name);
-
-      actuator.addField("pin0", node.actuatorPinState[0]);
-      actuator.addField("pin1", node.actuatorPinState[1]);
-
-      influxDb.writePoint(actuator);
-
-    } else if (node.familyId == DS2405) {
-      Point actuator("actuator");
-      actuator.addTag("device_id", node.idStr);
-
-      if (node.name != NULL && node.name.length() > 0)
-        actuator.addTag("device_name", node.name);
-
-      actuator.addField("pin0", node.actuatorPinState[0]);
-      influxDb.writePoint(actuator);
-
-    } else if (node.familyId == DS2423) {
-      Point counter("counters");
-      counter.addTag("device_id", node.idStr);
-
-      if (node.name != NULL && node.name.length() > 0)
-        counter.addTag("device_name", node.name);
-
-      counter.addField("counter0", node.counters[0]);
-      counter.addField("counter1", node.counters[1]);
-
-      influxDb.writePoint(counter);
-    }
+/**
+ * Queue a point of the node, tagged with its id and name, with the fields addFields adds. See formatInfluxLine().
+ */
+void writeInfluxPoint(const onewireNode &node, const char *measurement, void (*addFields)(const onewireNode &, InfluxLine &)) {
+  if (isInfluxDbEnabled && formatInfluxLine(influxLine, node, measurement, addFields)) {
+    ESP_LOGD(TAG, "Writing node %s to InfluxDB queue.", node.idStr);
+    influxDb.writeRecord(influxLine.c_str());
   }
 }
 
-void writeWiFiSignalStrength(String appName) {
+void writeWiFiSignalStrength(const char *appName) {
   if (isInfluxDbEnabled) {
-    Point wifiPoint("wifi");
-    wifiPoint.addTag("tinyowc", appName);
-    wifiPoint.addField("rssi", WiFi.RSSI());
-    influxDb.writePoint(wifiPoint);
+    influxLine.begin("wifi");
+    influxLine.addTag("tinyowc", appName);
+    influxLine.addInteger("rssi", WiFi.RSSI());
+    influxDb.writeRecord(influxLine.c_str());
   }
 }
 
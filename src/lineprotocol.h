@@ -0,0 +1,161 @@
+#ifndef LineProtocol_h
+#define LineProtocol_h
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "onewire.h"
+
+// Longest point of a node, a DS2423 with units per pulse set is about 250 characters.
+#define INFLUX_LINE_SIZE 384
+
+/**
+ * One point in the InfluxDB line protocol, e.g. "temperature,device_id=28.EEA89B19160262 value=21.50",
+ * written into a fixed buffer instead of the Strings of a Point. The same formats as Point: floats with
+ * 2 decimals unless given, integers with an "i" suffix, NaN fields left out. Tags go before the fields.
+ */
+class InfluxLine {
+ private:
+  char line[INFLUX_LINE_SIZE];
+  size_t length = 0;
+  uint8_t fields = 0;
+  bool truncated = false;
+
+  void append(const char *format, ...) {
+    if (truncated) return;
+
+    va_list args;
+    va_start(args, format);
+    auto written = vsnprintf(line + length, sizeof(line) - length, format, args);
+    va_end(args);
+
+    if (written < 0 || (size_t)written >= sizeof(line) - length) {
+      truncated = true;
+      return;
+    }
+    length += written;
+  }
+
+  // a backslash before each of the special characters, e.g. spaces in a name.
+  void appendEscaped(const char *text, const char *special) {
+    for (; *text != '\0'; text++) {
+      if (strchr(special, *text) != nullptr) put('\\');
+      put(*text);
+    }
+  }
+
+  void put(char c) {
+    if (truncated || length + 1 >= sizeof(line)) {
+      truncated = true;
+      return;
+    }
+    line[length++] = c;
+    line[length] = '\0';
+  }
+
+  void appendFieldKey(const char *key) {
+    put(fields++ == 0 ? ' ' : ',');
+    appendEscaped(key, ", =");
+    put('=');
+  }
+
+ public:
+  // Start a new point, anything added before is dropped.
+  void begin(const char *measurement) {
+    length = 0;
+    fields = 0;
+    truncated = false;
+    line[0] = '\0';
+    appendEscaped(measurement, ", ");
+  }
+
+  void addTag(const char *key, const char *value) {
+    put(',');
+    appendEscaped(key, ", =");
+    put('=');
+    appendEscaped(value, ", =");
+  }
+
+  void addFloat(const char *key, double value, uint8_t decimals = 2) {
+    if (isnan(value)) return;
+    appendFieldKey(key);
+    append("%.*f", decimals, value);
+  }
+
+  void addInteger(const char *key, long long value) {
+    appendFieldKey(key);
+    append("%lldi", value);
+  }
+
+  void addBool(const char *key, bool value) {
+    appendFieldKey(key);
+    append("%s", value ? "true" : "false");
+  }
+
+  // A point needs at least one field, and a cut one would be rejected by the server.
+  bool valid() const { return fields > 0 && !truncated; }
+
+  const char *c_str() const { return line; }
+};
+
+// Fields of the families, see FamilyHooks::addFields in main.cpp.
+
+void addTemperatureFields(const onewireNode &node, InfluxLine &line) {
+  line.addFloat("value", node.temperature);
+}
+
+void addSwitchFields(const onewireNode &node, InfluxLine &line) {
+  static const char *pins[] = {"pin0", "pin1", "pin2", "pin3", "pin4", "pin5", "pin6", "pin7"};
+
+  for (uint8_t i = 0; i < deviceFamily(node.familyId).channels; i++) {
+    line.addBool(pins[i], bitRead(node.pinStates, i));
+  }
+}
+
+void addCounterFields(const onewireNode &node, InfluxLine &line) {
+  static const char *amounts[] = {"amount0", "amount1"};
+  static const char *amountRates[] = {"amountRate0", "amountRate1"};
+
+  line.addInteger("counter0", node.counters[0]);
+  line.addInteger("counter1", node.counters[1]);
+  // pulses/second over the moving window, and with units per pulse set the totals and rates in units (e.g. kWh and kW).
+  auto &state = counterState(node);
+  line.addFloat("rate0", state.pulses[0].averageRate);
+  line.addFloat("rate1", state.pulses[1].averageRate);
+  for (uint8_t i = 0; i < 2; i++) {
+    if (state.unitsPerPulse[i] > 0) {
+      line.addFloat(amounts[i], state.pulses[i].total * state.unitsPerPulse[i]);
+      line.addFloat(amountRates[i], state.pulses[i].averageRate * state.unitsPerPulse[i] * 3600);
+    }
+  }
+}
+
+void addVoltageFields(const onewireNode &node, InfluxLine &line) {
+  auto &voltages = analogState(node).voltages;
+  line.addFloat("voltage0", voltages[0], 3);
+  line.addFloat("voltage1", voltages[1], 3);
+  line.addFloat("voltage2", voltages[2], 3);
+  line.addFloat("voltage3", voltages[3], 3);
+}
+
+/**
+ * The point of the node, tagged with its id and name, with the fields addFields adds.
+ * @return false if there's no point, e.g. the family has no fields.
+ */
+bool formatInfluxLine(InfluxLine &line, const onewireNode &node, const char *measurement, void (*addFields)(const onewireNode &, InfluxLine &)) {
+  if (measurement == nullptr || addFields == nullptr) {
+    return false;
+  }
+
+  line.begin(measurement);
+  line.addTag("device_id", node.idStr);
+  if (node.name[0] != '\0') {
+    line.addTag("device_name", node.name);
+  }
+  addFields(node, line);
+  return line.valid();
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include <Arduino.h>
+#include <memory>
 #include <vector>
 #define ARDUINOJSON_USE_LONG_LONG 1 // https://arduinojson.org/v6/api/config/use_long_long/, to use 64-bit long in getEpocTime().
 #include <ArduinoJson.h>
@@ -22,13 +23,23 @@ extern "C" {
 #include "tinyowc.h"
 #include "Button2.h"
 #include "HardwareSerial.h"
+#include "Wire.h"
+#include <DS2480B.h>
+#include <DS2484.h>
 #include "SPI.h"
 #include "TFT_eSPI.h"
 #include "onewire.h"
 #include "ds18x20.h"
 #include "ds2408.h"
 #include "ds2423.h"
+#include "ds2450.h"
+#include "switches.h"
+#include "onewireengine.h"
+#include "actuators.h"
+#include "sampling.h"
 #include "influxdb.h"
+#include "benchmark.h"
+#include "heapstats.h"
 
 #ifndef TFT_DISPOFF
 #define TFT_DISPOFF 0x28
@@ -47,6 +58,13 @@ extern "C" {
 
 #define RXD2 33
 #define TXD2 32
+#define I2C_SDA 33  // DS2484 on the same pins as the DS2480B, see TINYOWC_DS2484
+#define I2C_SCL 32
+#define I2C_FREQUENCY 400000
+#define RXD1 25     // DS2480B on Serial1, see TINYOWC_SERIAL1_BUS
+#define TXD1 26
+#define I2C1_SDA 21 // DS2484 on Wire1, see TINYOWC_WIRE1_BUS
+#define I2C1_SCL 22
 #define FIRST_BUTTON 0
 #define SECOND_BUTTON 35
 
@@ -61,9 +79,10 @@ extern "C" {
 #define INFLUX_PARAMS_FILE "/influx_params.json"
 
 #define SAMPLE_DELAY 15000          // milliseconds between reading sensors.
-#define FORCE_MQTT_PUSH 60000       // if still nothing has changed after this many milliseconds, we force a push to show that we are alive.
-#define TEMPERATURE_HYSTERESIS 0.5  // degrees celsius.
 #define WDT_TIMEOUT_SEC 60          // main loop watchdog, if stalled longer than XX seconds we will reboot.
+#define COUNTER_SAVE_INTERVAL 600000 // milliseconds between saving the DS2423 counter totals, pulses meanwhile are counted by the device anyway.
+#define MQTT_STATE_SIZE 600         // serialized state of a node, see pushStateToMQTT().
+#define MQTT_TOPIC_SIZE 128
 
 const char* NTP_SERVER = "pool.ntp.org";
 
@@ -115,16 +134,17 @@ const char Base_Html[] PROGMEM = R"rawliteral(
   </html>
 )rawliteral";
 
-const String PROGRESS_INDICATOR[] = { "|", "/", "-", "\\" };
+const char *PROGRESS_INDICATOR[] = { "|", "/", "-", "\\" };
 uint8_t progressIndicator = 0;
 
 STATES state = NO_DEVICES;
 Preferences preferences;
 
 char buff[1024];
-int64_t conversionStarted = 0;
-
-unsigned long epochTime;
+bool conversionDone = false;            // the temperature sensors on all buses have converted, time to read them.
+bool isSampling = false;                // a sample cycle is queued or running on the 1-Wire task.
+uint8_t samplingBuses = 0;              // buses that haven't finished the current step of the sample cycle.
+HeapProbe cycleHeap;                    // heap allocations of the current sample cycle, see TINYOWC_HEAP_STATS.
 
 Button2 firstButton = Button2(FIRST_BUTTON);
 Button2 secondButton = Button2(SECOND_BUTTON);
@@ -132,9 +152,34 @@ bool isScanning = false;
 long lastReadingTime = 0;
 long wifiReadingTime = 0;
 long lastPushedGeneralMQTT = 0;
-long numberOfSamplesSinceReboot = 0;
+long lastCounterSaveTime = 0;
 
+// 1-Wire bus masters, the first is a DS2480B on Serial2 unless "-DTINYOWC_DS2484" is added to build_flags for a DS2484 on I2C.
+// "-DTINYOWC_SERIAL1_BUS" adds a DS2480B on Serial1 and "-DTINYOWC_WIRE1_BUS" a DS2484 on the second I2C port.
+#ifdef TINYOWC_DS2484
+DS2484 ds(Wire);
+#else
 DS2480B ds(Serial2);
+#endif
+#ifdef TINYOWC_SERIAL1_BUS
+DS2480B serial1Ds(Serial1);
+#endif
+#ifdef TINYOWC_WIRE1_BUS
+DS2484 wire1Ds(Wire1);
+#endif
+
+// One 1-Wire task per bus, so the buses are sampled in parallel. Indexed by onewireNode::bus.
+OneWireEngine oneWireEngines[] = {
+  {ds},
+#ifdef TINYOWC_SERIAL1_BUS
+  {serial1Ds},
+#endif
+#ifdef TINYOWC_WIRE1_BUS
+  {wire1Ds},
+#endif
+};
+#define ONEWIRE_BUS_COUNT (sizeof(oneWireEngines) / sizeof(oneWireEngines[0]))
+ActuatorManager actuatorManagers[ONEWIRE_BUS_COUNT];
 
 WebServer webserver;
 AsyncMqttClient mqttClient;
@@ -167,6 +212,22 @@ extern void pushStateToMQTT(onewireNode& node);
 extern void pushAllStateToMQTT();
 extern bool isMqttEnabled();
 
+/**
+ * What the controller does with the nodes of a device family, any hook can be nullptr. The static traits
+ * of the family (name, channels, capabilities) are in deviceFamilies, see onewire.h.
+ */
+struct FamilyHooks {
+  uint8_t familyId;
+  void (*sample)(onewireNode &node, unsigned long currentMillis);      // queue the reading of the node for this sampling cycle.
+  void (*publish)(const onewireNode &node, JsonDocument &json);        // family fields of the MQTT state.
+  void (*render)(const onewireNode &node);                             // family line on the display, and the node in the log.
+  void (*describe)(const onewireNode &node, char *html, size_t size);  // family rows of the node on the status page.
+  const char *measurement;                                             // InfluxDB measurement of the node,
+  void (*addFields)(const onewireNode &node, InfluxLine &line);        // and its fields.
+};
+
+extern const FamilyHooks &familyHooks(uint8_t familyId);
+
 // ----------------------------------------------------------------------------
 
 // Function that gets current epoch time
@@ -186,7 +247,7 @@ void clearScreen() {
 }
 
 void printState() {
-    String text;
+    const char *text;
     switch (state) {
       case NO_DEVICES:
         text = "No devices, please scan";
@@ -199,7 +260,7 @@ void printState() {
         break;
       case OPERATIONAL:
         snprintf(buff, sizeof(buff), "Operational, WiFi:%s, MQTT:%s", WiFi.isConnected() ? "OK" : "-", mqttClient.connected() ? "OK" : "-");
-        text = String(buff);
+        text = buff;
         break;
       default:
         text = "unknown";
@@ -208,7 +269,7 @@ void printState() {
 
     tft.setTextSize(1);
     tft.setCursor(0, tft.height() - tft.fontHeight());
-    tft.printf("State: %s\n", text.c_str());
+    tft.printf("State: %s\n", text);
 }
 
 /**
@@ -244,10 +305,56 @@ bool loadAux(const String auxName) {
   return rc;
 }
 
+// Search one bus for supported devices, runs on the 1-Wire task of the bus.
+void scanBus(OneWireMaster &ds, uint8_t bus, std::vector<onewireNode> &found) {
+  byte addr[8];
+
+#ifdef TINYOWC_BENCHMARK
+  benchmarkSearch(ds);
+#endif
+
+  while (ds.search(addr)) {
+    Serial.printf("Found device on bus %u with ROM =", bus);
+    for (uint8_t i = 0; i < 8; i++) {
+      Serial.write(' ');
+      Serial.print(addr[i], HEX);
+    }
+    Serial.println();
+
+    if (OneWireMaster::crc8(addr, 7) != addr[7]) {
+      ESP_LOGW(TAG, "CRC is not valid on detected 1-Wire device, ignoring.");
+    } else {
+      onewireNode node;
+      populateNode(node, addr);
+
+      if (deviceFamily(node.familyId).supported()) {
+        node.bus = bus;
+        if (isTemperatureSensor(node.familyId)) {
+          probeSensor(ds, node);
+#ifdef TINYOWC_ALARM_SAMPLING
+          setAlarmLimits(ds, node);
+#endif
+        } else if (node.familyId == DS2450) {
+          configureDS2450(ds, node);
+        }
+        found.push_back(node);
+      } else {
+        ESP_LOGI(TAG, "Unsupported 1-Wire device(family=%x) found, ignoring.", node.familyId);
+      }
+    }
+  }
+
+#ifdef TINYOWC_BENCHMARK
+  benchmarkBus(ds, found);
+#endif
+
+  ds.reset_search();
+  ds.reset();
+}
+
 void scanOneWireNetwork() {
   if (!isScanning) {
     isScanning = true;
-    byte addr[8];
 
     ESP_LOGI(TAG, "Start scanning 1-Wire network...");
 
@@ -256,59 +363,130 @@ void scanOneWireNetwork() {
     tft.drawString("Scanning 1-Wire...", tft.width() / 2, tft.height() / 2);
     tft.setCursor(0, 0);
 
-    while (ds.search(addr)) {
-      Serial.print("Found device with ROM =");
-      for (uint8_t i = 0; i < 8; i++) {
-        Serial.write(' ');
-        Serial.print(addr[i], HEX);
-      }
-      Serial.println();
-      tft.print(".");
+    // the buses are searched in parallel on their 1-Wire tasks, found nodes are handed over to loop() when all are done.
+    auto found = std::make_shared<std::vector<std::vector<onewireNode>>>(ONEWIRE_BUS_COUNT);
+    auto remaining = std::make_shared<uint8_t>(ONEWIRE_BUS_COUNT);
+
+    for (uint8_t bus = 0; bus < ONEWIRE_BUS_COUNT; bus++) {
+      oneWireEngines[bus].submit(nullptr, [found, bus](OneWireMaster &ds, onewireNode *, OneWireTransaction &) {
+        scanBus(ds, bus, (*found)[bus]);
+        return true;
+      }, [found, remaining](OneWireTransaction &) {
+        if (--*remaining > 0) {
+          return;
+        }
+        ESP_LOGI(TAG, "Scanning done.");
 
-      if (DS2480B::crc8(addr, 7) != addr[7]) {
-        ESP_LOGW(TAG, "CRC is not valid on detected 1-Wire device, ignoring.");
-      } else {
-        onewireNode node;
-        populateNode(node, addr);
+        // in bus order, so the list doesn't depend on which bus finished first.
+        scannedOneWireNodes.clear();
+        for (auto &busNodes : *found) {
+          scannedOneWireNodes.insert(scannedOneWireNodes.end(), busNodes.begin(), busNodes.end());
+        }
+
+        clearScreen();
+        tft.setCursor(0, 0);
 
-        if (familyIdToNameTranslation(node.familyId).length() > 0) {
-          scannedOneWireNodes.push_back(node);
+        if (scannedOneWireNodes.size() > 0) {
+          for (auto &i : scannedOneWireNodes) {
+            snprintf(buff, sizeof(buff), "Found %s (%s) on bus %u", i.idStr, deviceFamily(i.familyId).name, i.bus);
+            tft.println(buff);
+          }
         } else {
-          ESP_LOGI(TAG, "Unsupported 1-Wire device(family=%x) found, ignoring.", node.familyId);
+          tft.println("No devices found. :-(");
         }
-      }
 
-      esp_task_wdt_reset();
-      delay(5);
+        delay(3000);
+
+        state = SCANNING_DONE;
+        isScanning = false;
+      });
     }
-  
-    ds.reset_search();
-    ds.reset();
+  }
+}
 
-    ESP_LOGI(TAG, "Scanning done.");
+// Find out the power mode and resolution of all temperature sensors, these decide how each bus is converted.
+// Sensors that don't have the resolution from the settings are changed, and the alarm limits are programmed.
+// The DS2450s get the resolution and input ranges from the settings.
+void probeSensors() {
+  for (auto &node : oneWireNodes) {
+    if (node.familyId == DS2450) {
+      oneWireEngines[node.bus].submit(node.id, [](OneWireMaster &ds, onewireNode *node, OneWireTransaction &) {
+        if (node == nullptr) return false;
+        return configureDS2450(ds, *node);
+      });
+    } else if (isTemperatureSensor(node.familyId)) {
+      auto resolution = node.resolution;
+
+      oneWireEngines[node.bus].submit(node.id, [resolution](OneWireMaster &ds, onewireNode *node, OneWireTransaction &) {
+        if (node == nullptr || !probeSensor(ds, *node)) return false;
+        bool success = true;
+
+        if (node->familyId != DS18S20 && node->resolution != resolution) {
+          ESP_LOGI(TAG, "Changing resolution of %s from %u to %u bits.", node->idStr, node->resolution, resolution);
+          success = setResolution(ds, *node, resolution);
+        }
+#ifdef TINYOWC_ALARM_SAMPLING
+        success = setAlarmLimits(ds, *node) && success;
+#endif
+        return success;
+      });
+    }
+  }
+}
 
-    clearScreen();
-    tft.setCursor(0, 0);
+// Block until all 1-Wire tasks are idle, e.g. before replacing oneWireNodes.
+void waitUntilOneWireIdle() {
+  for (auto &engine : oneWireEngines) {
+    engine.waitUntilIdle();
+  }
+}
 
-    if (scannedOneWireNodes.size() > 0) {
-      for (auto i : scannedOneWireNodes) {
-        snprintf(buff, sizeof(buff), "Found %s (%s)", i.idStr.c_str(), familyIdToNameTranslation(i.familyId).c_str());
-        tft.println(buff);
-      }
-    } else {
-      tft.println("No devices found. :-(");
-    }
+/**
+ * Set the switches to a known state, all outputs off. A DS2408 also gets testmode off and strobe out.
+ */
+void resetActuators() {
+  for (auto &manager : actuatorManagers) {
+    manager.resetBoards();
+  }
+}
 
-    delay(3000);
+/**
+ * Rebuild the index from each switch to the sensors bound to it, after the node list or a binding changed.
+ * The spare transactions of each bus are topped up to what a sampling cycle queues, see OneWireEngine::reserve().
+ */
+void indexActuators() {
+  for (auto &manager : actuatorManagers) {
+    manager.indexBindings(oneWireNodes);
+  }
 
-    state = SCANNING_DONE;
-    isScanning = false;
+  // a reading per node, a write per switch, and the conversion, the conditional search and the end of the cycle.
+  uint16_t transactions[ONEWIRE_BUS_COUNT] = {};
+  for (auto &node : oneWireNodes) {
+    transactions[node.bus] += switchChannels(node.familyId) > 0 ? 2 : 1;
+  }
+  for (uint8_t bus = 0; bus < ONEWIRE_BUS_COUNT; bus++) {
+    oneWireEngines[bus].reserve(transactions[bus] + 3);
   }
 }
 
+/**
+ * Capacity of the settings document for nodeCount nodes: per node an object with its members, the id and
+ * actuatorId arrays, unitsPerPulse and the copied name. The member names are stored once when loading.
+ */
+size_t settingsCapacity(size_t nodeCount) {
+  return JSON_ARRAY_SIZE(nodeCount) +
+         nodeCount * (JSON_OBJECT_SIZE(12) + 2 * JSON_ARRAY_SIZE(8) + JSON_ARRAY_SIZE(2) + NODE_NAME_LENGTH) +
+         256;
+}
+
 void loadSettings() {
   auto serializedNodes = preferences.getString("nodes", "[]");
-  DynamicJsonDocument doc(4096);
+  // every node is one object.
+  size_t nodeCount = 0;
+  for (auto c : serializedNodes) {
+    if (c == '{') nodeCount++;
+  }
+  DynamicJsonDocument doc(settingsCapacity(nodeCount));
 
   auto error = deserializeJson(doc, serializedNodes);
 
@@ -331,22 +509,36 @@ void loadSettings() {
       node.actuatorId[i] = actuatorIdArray[i];
     }
     
-    node.name = jsonNode["name"].as<String>();
+    setNodeName(node, jsonNode["name"] | "");
     node.actuatorPin = jsonNode["actuatorPin"] | -1;
     node.stateOverride = jsonNode["stateOverride"].as<const char>() | 'A';
     node.lowLimit = jsonNode["lowLimit"] | UNSET_TEMPERATURE;
     node.highLimit = jsonNode["highLimit"] | UNSET_TEMPERATURE;
+    node.bus = jsonNode["bus"] | 0;
+    node.resolution = jsonNode["resolution"] | 12;
+    node.inputRanges = jsonNode["inputRanges"] | 0x0F;
 
     populateNode(node, node.id);
+    if (node.familyId == DS2423) {
+      auto &state = counterState(node);
+      state.unitsPerPulse[0] = jsonNode["unitsPerPulse"][0] | 0.0;
+      state.unitsPerPulse[1] = jsonNode["unitsPerPulse"][1] | 0.0;
+    }
+
+    if (node.bus >= ONEWIRE_BUS_COUNT) {
+      ESP_LOGW(TAG, "Node %s is on bus %u, which isn't configured, ignoring.", node.idStr, node.bus);
+      continue;
+    }
     oneWireNodes.push_back(node);
   }
+  indexNodes();
 }
 
 void saveSettings(std::vector<onewireNode> &nodes) {
-  DynamicJsonDocument doc(4096);
+  DynamicJsonDocument doc(settingsCapacity(nodes.size()));
   JsonArray nodesArray = doc.to<JsonArray>();
   
-  for (auto n : nodes) {
+  for (auto &n : nodes) {
     auto jsonNode = nodesArray.createNestedObject();
 
     auto idArray = jsonNode.createNestedArray("id");
@@ -358,15 +550,28 @@ void saveSettings(std::vector<onewireNode> &nodes) {
     for (auto i : n.actuatorId) {
       actuatorIdArray.add(i);
     }
-    if (n.name != NULL && n.name.length() > 0) {
-      jsonNode["name"] = n.name;
-    } else {
-      jsonNode["name"] = "";
-    }
+    jsonNode["name"] = n.name;
     jsonNode["actuatorPin"] = n.actuatorPin;
     jsonNode["stateOverride"] = byte(n.stateOverride);
     jsonNode["lowLimit"] = n.lowLimit;
     jsonNode["highLimit"] = n.highLimit;
+    jsonNode["bus"] = n.bus;
+    jsonNode["resolution"] = n.resolution;
+
+    if (n.familyId == DS2423) {
+      auto unitsArray = jsonNode.createNestedArray("unitsPerPulse");
+      auto &state = counterState(n);
+      unitsArray.add(state.unitsPerPulse[0]);
+      unitsArray.add(state.unitsPerPulse[1]);
+    } else if (n.familyId == DS2450) {
+      jsonNode["inputRanges"] = n.inputRanges;
+    }
+  }
+
+  // a truncated node list would lose the settings of the other nodes on the next boot, keep the saved one.
+  if (doc.overflowed()) {
+    ESP_LOGE(TAG, "Settings of %u nodes don't fit in %u bytes, not saved.", nodes.size(), doc.capacity());
+    return;
   }
 
   String jsonString;
@@ -374,7 +579,55 @@ void saveSettings(std::vector<onewireNode> &nodes) {
 
   if (jsonString.length() > 0) {
     ESP_LOGI(TAG, "Saving node list: %s", jsonString.c_str());  // please note that IDs are saved in their decimal value (NOT hexadecimal), and thus looks a bit strange. 
-    preferences.putString("nodes", jsonString);
+    if (preferences.putString("nodes", jsonString) == 0) {
+      ESP_LOGE(TAG, "Saving the settings of %u nodes failed, %u bytes.", nodes.size(), jsonString.length());
+    }
+  }
+}
+
+// Save the counter totals of the DS2423 nodes, only the last counter values are needed to count on after a reboot.
+void saveCounters(std::vector<onewireNode> &nodes) {
+  static std::vector<CounterRecord> records;  // kept, so a save only allocates when counters were added.
+  records.clear();
+
+  for (auto &node : nodes) {
+    if (node.familyId != DS2423) continue;
+
+    auto &pulses = counterState(node).pulses;
+    if (pulses[0].valid && pulses[1].valid) {
+      CounterRecord record;
+      memcpy(record.rom, node.id, 8);
+      for (uint8_t i = 0; i < 2; i++) {
+        record.last[i] = pulses[i].last;
+        record.total[i] = pulses[i].total;
+      }
+      records.push_back(record);
+    }
+  }
+
+  if (records.size() > 0) {
+    preferences.putBytes("counters", records.data(), records.size() * sizeof(CounterRecord));
+  }
+}
+
+// Continue the counter totals of the DS2423 nodes from the last saveCounters().
+void restoreCounters(std::vector<onewireNode> &nodes) {
+  auto length = preferences.getBytesLength("counters");
+  std::vector<CounterRecord> records(length / sizeof(CounterRecord));
+
+  if (records.empty() || preferences.getBytes("counters", records.data(), records.size() * sizeof(CounterRecord)) == 0) {
+    return;
+  }
+
+  for (auto &node : nodes) {
+    for (auto &record : records) {
+      if (node.familyId == DS2423 && memcmp(node.id, record.rom, 8) == 0) {
+        auto &pulses = counterState(node).pulses;
+        pulses[0].restore(record.total[0], record.last[0]);
+        pulses[1].restore(record.total[1], record.last[1]);
+        ESP_LOGI(TAG, "Counters of %s continue from %llu and %llu.", node.idStr, record.total[0], record.total[1]);
+      }
+    }
   }
 }
 
@@ -394,17 +647,18 @@ void secondButtonClick(Button2& btn) {
 
   if (state == SCANNING_DONE) {
     saveSettings(scannedOneWireNodes);
+    // no transaction may use the nodes while they are replaced.
+    waitUntilOneWireIdle();
+    saveCounters(oneWireNodes);
     oneWireNodes = scannedOneWireNodes;
     scannedOneWireNodes.clear();
+    indexNodes();
+    restoreCounters(oneWireNodes);
     shownNodePage = 1;
     clearScreen();
 
-    // Set DS2408 to a known state (testmode=off,strobe out,all relayes off).
-    for (auto &node : oneWireNodes) {
-      if (node.familyId == DS2408) {
-        ds2408_reset(ds, node);
-      }
-    }
+    indexActuators();
+    resetActuators();
   } else if (state == NO_DEVICES || state == OPERATIONAL) {
     state = START_SCANNING;
   }
@@ -413,12 +667,92 @@ void secondButtonClick(Button2& btn) {
 void secondButtonTrippleClick(Button2& btn) {
   ESP_LOGD(TAG, "secondButtonTrippleClick(), erasing all known nodes!");
 
+  waitUntilOneWireIdle();
   oneWireNodes.clear();
+  indexNodes();
   scannedOneWireNodes.clear();
   preferences.putString("nodes", "[]");
+  preferences.remove("counters");
   ESP.restart();
 }
 
+// Display lines of the families, see FamilyHooks::render. The name of the node is printed below it.
+
+void renderTemperature(const onewireNode &i) {
+  auto name = deviceFamily(i.familyId).name;
+
+  if (i.failedReadingsInRow >= 5) {
+    snprintf(buff, sizeof(buff), "%s: not avail", name);
+    tft.println(buff);
+    ESP_LOGI(TAG, "%s (%s): not available", i.idStr, name);
+  } else if (i.lowLimit > UNSET_TEMPERATURE && i.highLimit > UNSET_TEMPERATURE && i.actuatorPin > -1) {
+    snprintf(buff, sizeof(buff), "%s: ", name);
+    tft.print(buff);
+    if (i.temperature < i.lowLimit) {
+      tft.setTextColor(TFT_BLUE);
+    } else if (i.temperature > i.highLimit) {
+      tft.setTextColor(TFT_RED);
+    } else {
+      tft.setTextColor(TFT_GREEN);
+    }
+    snprintf(buff, sizeof(buff), "%.1f", i.temperature);
+    tft.println(buff);
+
+    ESP_LOGI(TAG, "%s (%s): %.1f, limits: %.1f - %.1f, status: %s", i.idStr, name, i.temperature, i.lowLimit, i.highLimit, shouldActuatorBeActive(i) ? "open" : "closed");
+  } else {
+    snprintf(buff, sizeof(buff), "%s: %.1f", name, i.temperature);
+    tft.println(buff);
+    ESP_LOGI(TAG, "%s (%s): %.1f", i.idStr, name, i.temperature);
+  }
+}
+
+void renderSwitch(const onewireNode &i) {
+  auto &family = deviceFamily(i.familyId);
+  char pins[8 + 1] = {};     // e.g. "01000001" on the display,
+  char spaced[2 * 8] = {};  // "0 1 0 0 0 0 0 1" in the log.
+
+  for (uint8_t pin = 0; pin < family.channels; pin++) {
+    pins[pin] = spaced[pin * 2] = bitRead(i.pinStates, pin) ? '1' : '0';
+    spaced[pin * 2 + 1] = pin + 1 < family.channels ? ' ' : '\0';
+  }
+
+  snprintf(buff, sizeof(buff), "%s: %s", family.name, pins);
+  tft.println(buff);
+  ESP_LOGI(TAG, "%s (%s), out: %s", i.idStr, family.name, spaced);
+}
+
+void renderCounter(const onewireNode &i) {
+  auto name = deviceFamily(i.familyId).name;
+
+  snprintf(buff, sizeof(buff), "%s: %d %d", name, i.counters[0], i.counters[1]);
+  tft.println(buff);
+
+  auto &pulses = counterState(i).pulses;
+  ESP_LOGI(TAG, "%s (%s), counters: %d %d, rates: %.3f %.3f pulses/s",
+    i.idStr,
+    name,
+    i.counters[0],
+    i.counters[1],
+    pulses[0].averageRate,
+    pulses[1].averageRate);
+}
+
+void renderVoltages(const onewireNode &i) {
+  auto name = deviceFamily(i.familyId).name;
+  auto &voltages = analogState(i).voltages;
+
+  snprintf(buff, sizeof(buff), "%s: %.2f %.2f %.2f %.2f", name, voltages[0], voltages[1], voltages[2], voltages[3]);
+  tft.println(buff);
+
+  ESP_LOGI(TAG, "%s (%s), voltages: %.3f %.3f %.3f %.3f",
+    i.idStr,
+    name,
+    voltages[0],
+    voltages[1],
+    voltages[2],
+    voltages[3]);
+}
+
 void printOneWireNodes() {
   clearScreen();
   tft.setCursor(0, 0);
@@ -440,133 +774,21 @@ void printOneWireNodes() {
 
   while (index < NODES_PER_PAGE && offset + index < oneWireNodes.size()) {
 
-    auto i = oneWireNodes[offset + index];
+    auto &i = oneWireNodes[offset + index];
 
     tft.setTextColor(TFT_WHITE);
     tft.setTextSize(2);
 
-    auto identifierString = (i.name != NULL && i.name.length() > 0) ? i.name.c_str() : i.idStr.c_str();
-
-    if (isTemperatureSensor(i.familyId)) {
-      if (i.failedReadingsInRow < 5) {
-        if (i.lowLimit > UNSET_TEMPERATURE && i.highLimit > UNSET_TEMPERATURE && i.actuatorPin > -1) {
-          snprintf(buff, sizeof(buff), "%s: ", familyIdToNameTranslation(i.familyId).c_str());
-          tft.print(buff);
-          if (i.temperature < i.lowLimit) {
-            tft.setTextColor(TFT_BLUE);
-          } else if (i.temperature > i.highLimit) {
-            tft.setTextColor(TFT_RED);
-          } else {
-            tft.setTextColor(TFT_GREEN);
-          }
-          snprintf(buff, sizeof(buff), "%.1f", i.temperature);
-          tft.println(buff);
-          tft.setTextColor(TFT_WHITE);
-          snprintf(buff, sizeof(buff), "%s", identifierString);
-          tft.println(buff);
-
-          ESP_LOGI(TAG, "%s (%s): %.1f, limits: %.1f - %.1f, status: %s", i.idStr.c_str(), familyIdToNameTranslation(i.familyId).c_str(), i.temperature, i.lowLimit, i.highLimit, shouldActuatorBeActive(i) ? "open" : "closed");
-
-        } else {
-          snprintf(buff, sizeof(buff), "%s: %.1f",familyIdToNameTranslation(i.familyId).c_str(), i.temperature);
-          tft.println(buff);
-          snprintf(buff, sizeof(buff), "%s", identifierString);
-          tft.println(buff);
-
-          ESP_LOGI(TAG, "%s (%s): %.1f", i.idStr.c_str(), familyIdToNameTranslation(i.familyId).c_str(), i.temperature);
-
-        }
-      } else {
-        snprintf(buff, sizeof(buff), "%s: not avail", familyIdToNameTranslation(i.familyId).c_str());
-        tft.println(buff);
-        snprintf(buff, sizeof(buff), "%s", identifierString);
-        tft.println(buff);
-
-        ESP_LOGI(TAG, "%s (%s): not available", i.idStr.c_str(), familyIdToNameTranslation(i.familyId).c_str());
-
-      }
-    } else if (i.familyId == DS2408) {
-      snprintf(buff, sizeof(buff), "%s: %d%d%d%d%d%d%d%d",
-        familyIdToNameTranslation(i.familyId).c_str(),
-        i.actuatorPinState[0],
-        i.actuatorPinState[1],
-        i.actuatorPinState[2],
-        i.actuatorPinState[3],
-        i.actuatorPinState[4],
-        i.actuatorPinState[5],
-        i.actuatorPinState[6],
-        i.actuatorPinState[7]);
-      tft.println(buff);
-      snprintf(buff, sizeof(buff), "%s", identifierString);
-      tft.println(buff);
-
-      ESP_LOGI(TAG, "%s (%s), out: %d %d %d %d %d %d %d %d",
-        i.idStr.c_str(),
-        familyIdToNameTranslation(i.familyId).c_str(),
-        i.actuatorPinState[0],
-        i.actuatorPinState[1],
-        i.actuatorPinState[2],
-        i.actuatorPinState[3],
-        i.actuatorPinState[4],
-        i.actuatorPinState[5],
-        i.actuatorPinState[6],
-        i.actuatorPinState[7]);
-
-    } else if (i.familyId == DS2406 || i.familyId == DS2413) {
-      snprintf(buff, sizeof(buff), "%s: %d %d",
-        familyIdToNameTranslation(i.familyId).c_str(),
-        i.actuatorPinState[0],
-        i.actuatorPinState[1]);
-      tft.println(buff);
-      snprintf(buff, sizeof(buff), "%s", identifierString);
-      tft.println(buff);
-
-      ESP_LOGI(TAG, "%s (%s), out: %d %d",
-        i.idStr.c_str(),
-        familyIdToNameTranslation(i.familyId).c_str(),
-        i.actuatorPinState[0],
-        i.actuatorPinState[1]);
-
-    } else if (i.familyId == DS2405) {
-      snprintf(buff, sizeof(buff), "%s: %d",
-        familyIdToNameTranslation(i.familyId).c_str(),
-        i.actuatorPinState[0]);
-      tft.println(buff);
-      snprintf(buff, sizeof(buff), "%s", identifierString);
-
-      ESP_LOGI(TAG, "%s (%s), out: %d",
-        i.idStr.c_str(),
-        familyIdToNameTranslation(i.familyId).c_str(),
-        i.actuatorPinState[0]);
-
-    } else if (i.familyId == DS2423) {
-      snprintf(buff, sizeof(buff), "%s: %d %d",
-        familyIdToNameTranslation(i.familyId).c_str(),
-        i.counters[0],
-        i.counters[1]);
-      tft.println(buff);
-      snprintf(buff, sizeof(buff), "%s", identifierString);
-      tft.println(buff);
-
-      ESP_LOGI(TAG, "%s (%s), counters: %d %d",
-        i.idStr.c_str(),
-        familyIdToNameTranslation(i.familyId).c_str(),
-        i.counters[0],
-        i.counters[1]);
+    auto &hooks = familyHooks(i.familyId);
+    if (hooks.render != nullptr) {
+      hooks.render(i);
     } else {
-      Serial.println(familyIdToNameTranslation(i.familyId).c_str());
-
-      snprintf(buff, sizeof(buff), "%s",
-        familyIdToNameTranslation(i.familyId).c_str());
-      tft.println(buff);
-      snprintf(buff, sizeof(buff), "%s", identifierString);
-      tft.println(buff);
-
-      ESP_LOGI(TAG, "%s (%s)",
-        i.idStr.c_str(),
-        familyIdToNameTranslation(i.familyId).c_str());
+      tft.println(deviceFamily(i.familyId).name);
+      ESP_LOGI(TAG, "%s (%s)", i.idStr, deviceFamily(i.familyId).name);
     }
-    
+
+    tft.setTextColor(TFT_WHITE);
+    tft.println(i.name[0] != '\0' ? i.name : i.idStr);
     tft.println();
     index++;
   }
@@ -575,9 +797,10 @@ void printOneWireNodes() {
   tft.setTextSize(1);
 
   tft.setCursor(0, tft.height() - tft.fontHeight() * 3);
-  snprintf(buff, sizeof(buff), "Device: %s, samples: %d", uniqueId, numberOfSamplesSinceReboot);
+  snprintf(buff, sizeof(buff), "Device: %s, samples: %ld", uniqueId.c_str(), numberOfSamplesSinceReboot);
   tft.println(buff);
-  snprintf(buff, sizeof(buff), "IP-address: %s", WiFi.localIP().toString());
+  auto ip = WiFi.localIP();
+  snprintf(buff, sizeof(buff), "IP-address: %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
   tft.println(buff);
 
   shownNodePage++;
@@ -712,6 +935,32 @@ void watchdogSetup() {
 
 // ----------------------------------------------------------------------------
 
+/**
+ * A setSensor command, parsed on the MQTT task by onMqttMessage() and applied on the loop() task by
+ * applySensorSettings(), which is the only place that changes the nodes and the actuator index.
+ */
+struct SensorSettings {
+  uint8_t id[8];
+  char name[NODE_NAME_LENGTH];
+  bool hasActuatorId;          // actuatorId is valid, otherwise the binding is left as it is.
+  uint8_t actuatorId[8];
+  int8_t actuatorPin;
+  char stateOverride;
+  float lowLimit;
+  float highLimit;
+  uint8_t resolution;          // 0 if not given.
+  bool hasUnitsPerPulse;
+  float unitsPerPulse[2];
+  bool hasInputRanges;
+  uint8_t inputRanges;         // a bit per channel in inputRangesMask, 1 -> 5.12 V range.
+  uint8_t inputRangesMask;
+};
+
+#define SENSOR_SETTINGS_QUEUE_LENGTH 8
+
+QueueHandle_t sensorSettingsQueue = nullptr;
+std::atomic<bool> mqttStatePending{false};  // the MQTT connection is (re)established, push the state of every node.
+
 void connectToMqtt() {
   if (isMqttEnabled()) {
     ESP_LOGI(TAG, "Connecting to MQTT...");
@@ -723,14 +972,14 @@ void connectToMqtt() {
 }
 
 void onMqttConnect(bool sessionPresent) {
-  ESP_LOGI(TAG, "Connected to MQTT. Session present: %s", String(sessionPresent));
+  ESP_LOGI(TAG, "Connected to MQTT. Session present: %s", sessionPresent ? "true" : "false");
   if (mqtt_cmdtopic.length() > 0) {
     // TODO: should we subscribe if session is already pressent? Maybe not...
     mqttClient.subscribe(mqtt_cmdtopic.c_str(), 1);
   }
 
-  // make sure broker has our current state.
-  pushAllStateToMQTT();
+  // make sure broker has our current state, pushed from loop() since the nodes are only read there.
+  mqttStatePending = true;
 }
 
 void onMqttDisconnect(AsyncMqttClientDisconnectReason reason) {
@@ -750,11 +999,12 @@ void onMqttUnsubscribe(uint16_t packetId) {
 }
 
 void onMqttMessage(char* topic, char* payload, AsyncMqttClientMessageProperties properties, size_t len, size_t index, size_t total) {
-  ESP_LOGI(TAG, "MQTT message received, payload: %s", payload);
+  ESP_LOGI(TAG, "MQTT message received, payload: %.*s", (int)len, payload);  // payload isn't null-terminated.
 
-  StaticJsonDocument<250> doc;
+  // every setSensor member and the unitsPerPulse and inputRanges arrays, the margin holds the strings if they're copied.
+  StaticJsonDocument<JSON_OBJECT_SIZE(11) + JSON_ARRAY_SIZE(2) + JSON_ARRAY_SIZE(DS2450_CHANNELS) + 128> doc;
 
-  auto error = deserializeJson(doc, payload);
+  auto error = deserializeJson(doc, payload, len);
 
   if (error) {
     ESP_LOGW(TAG, "deserializeJson() failed with code: %s.", error.c_str());
@@ -774,52 +1024,212 @@ void onMqttMessage(char* topic, char* payload, AsyncMqttClientMessageProperties
       "actuatorPin": 0,
       "stateOverride": "1",
       "lowLimit": 22,
-      "highLimit": 24
+      "highLimit": 24,
+      "resolution": 10,
+      "unitsPerPulse": [0.001, 0],
+      "inputRanges": [5.12, 5.12, 2.56, 2.56]
     }
     */
-    auto id = doc["id"].as<String>();
+    // this runs on the MQTT task, the nodes are only changed on the loop() task, see applySensorSettings().
+    SensorSettings settings = {};
+    const char *id = doc["id"] | "";
+    if (!parseId(id, settings.id)) {
+      ESP_LOGW(TAG, "setSensor with invalid id '%s' ignored.", id);
+      return;
+    }
+
     auto name = doc["name"].as<String>();
-    auto actuatorId = doc["actuatorId"];
-    auto actuatorPin = doc["actuatorPin"] | -1;
-    char stateOverride = doc["stateOverride"].as<const char>() | 'A';
-    auto lowLimit = doc["lowLimit"] | UNSET_TEMPERATURE;
-    auto highLimit = doc["highLimit"] | UNSET_TEMPERATURE;
-
-    auto it = std::find_if (oneWireNodes.begin(), oneWireNodes.end(), [&id](const onewireNode& n) {
-      return n.idStr == id;
-    });
-    if (it != oneWireNodes.end()) {
-      auto node = it.base();
-      stringToId(actuatorId, node->actuatorId);
-      node->actuatorPin = actuatorPin;
-      node->stateOverride = stateOverride;
-      node->lowLimit = lowLimit;
-      node->highLimit = highLimit;
-
-      if (name != NULL && name.length() > 0) {
-        name.trim();
-        node->name = name.substring(0, 20);
-      } else {
-        node->name = "";
-      }
+    name.trim();
+    strlcpy(settings.name, name.c_str(), sizeof(settings.name));
+    const char *actuatorId = doc["actuatorId"];
+    settings.hasActuatorId = parseId(actuatorId, settings.actuatorId);
+    settings.actuatorPin = doc["actuatorPin"] | -1;
+    settings.stateOverride = doc["stateOverride"].as<const char>() | 'A';
+    settings.lowLimit = doc["lowLimit"] | UNSET_TEMPERATURE;
+    settings.highLimit = doc["highLimit"] | UNSET_TEMPERATURE;
+    settings.resolution = doc["resolution"] | 0;
+    // a DS2450 converts with 1 to 16 bits, the temperature sensors with 9 to 12 bits.
+    uint8_t minResolution = settings.id[0] == DS2450 ? 1 : 9;
+    uint8_t maxResolution = settings.id[0] == DS2450 ? 16 : 12;
+    if (settings.resolution != 0 && (settings.resolution < minResolution || settings.resolution > maxResolution)) {
+      ESP_LOGW(TAG, "setSensor with invalid resolution %u for '%s', not changed.", settings.resolution, id);
+      settings.resolution = 0;
+    }
 
-      saveSettings(oneWireNodes);
-      ESP_LOGI(TAG, "Settings for sensor '%s' updated.", id.c_str());
-      pushStateToMQTT(*node);
-    }    
+    JsonArray unitsPerPulse = doc["unitsPerPulse"];
+    settings.hasUnitsPerPulse = !unitsPerPulse.isNull();
+    settings.unitsPerPulse[0] = unitsPerPulse[0] | 0.0;
+    settings.unitsPerPulse[1] = unitsPerPulse[1] | 0.0;
+
+    JsonArray inputRanges = doc["inputRanges"];
+    settings.hasInputRanges = !inputRanges.isNull();
+    for (uint8_t i = 0; i < inputRanges.size() && i < DS2450_CHANNELS; i++) {
+      bitSet(settings.inputRangesMask, i);
+      bitWrite(settings.inputRanges, i, inputRanges[i].as<float>() > 2.56);
+    }
+
+    if (sensorSettingsQueue == nullptr || xQueueSend(sensorSettingsQueue, &settings, 0) != pdTRUE) {
+      ESP_LOGW(TAG, "Too many setSensor commands, '%s' dropped.", id);
+    }
   } else {
-    ESP_LOGI(TAG, "Unsupported MQTT command received: '%s'.", command);
+    ESP_LOGI(TAG, "Unsupported MQTT command received: '%s'.", command.as<const char *>());
+  }
+}
+
+/**
+ * Apply the setSensor commands received since the last call, on the loop() task. The changes to the
+ * devices themselves (alarm limits, resolution, DS2450 configuration) are queued on the 1-Wire tasks.
+ */
+void applySensorSettings() {
+  SensorSettings settings;
+
+  while (sensorSettingsQueue != nullptr && xQueueReceive(sensorSettingsQueue, &settings, 0) == pdTRUE) {
+    auto node = getOneWireNode(settings.id);
+    if (node == nullptr) {
+      char id[NODE_ID_LENGTH];
+      formatId(settings.id, id);
+      ESP_LOGW(TAG, "setSensor for unknown sensor '%s' ignored.", id);
+      continue;
+    }
+
+#ifdef TINYOWC_ALARM_SAMPLING
+    auto oldLowLimit = node->lowLimit;
+    auto oldHighLimit = node->highLimit;
+#endif
+
+    if (settings.hasActuatorId) {
+      memcpy(node->actuatorId, settings.actuatorId, sizeof(node->actuatorId));
+    }
+    node->actuatorPin = settings.actuatorPin;
+    node->stateOverride = settings.stateOverride;
+    node->lowLimit = settings.lowLimit;
+    node->highLimit = settings.highLimit;
+    if (settings.hasUnitsPerPulse && node->familyId == DS2423) {
+      auto &state = counterState(*node);
+      state.unitsPerPulse[0] = settings.unitsPerPulse[0];
+      state.unitsPerPulse[1] = settings.unitsPerPulse[1];
+    }
+    setNodeName(*node, settings.name);
+
+    saveSettings(oneWireNodes);
+    indexActuators();
+    ESP_LOGI(TAG, "Settings for sensor '%s' updated.", node->idStr);
+    pushStateToMQTT(*node);
+
+#ifdef TINYOWC_ALARM_SAMPLING
+    // read the sensor every cycle until it alarms on the new limits.
+    if (node->lowLimit != oldLowLimit || node->highLimit != oldHighLimit) {
+      node->alarmLimits = false;
+      oneWireEngines[node->bus].submit(node->id, [](OneWireMaster &ds, onewireNode *node, OneWireTransaction &) {
+        if (node == nullptr) return false;
+        return setAlarmLimits(ds, *node);
+      });
+    }
+#endif
+
+    uint8_t resolution = settings.resolution;
+
+    // a DS2450 is configured with the new resolution and input ranges right away, they're saved when it has them.
+    if (node->familyId == DS2450 && ((resolution > 0 && resolution != node->resolution) || settings.hasInputRanges)) {
+      uint8_t ranges = (node->inputRanges & ~settings.inputRangesMask) | (settings.inputRanges & settings.inputRangesMask);
+      if (resolution == 0) resolution = node->resolution;
+
+      oneWireEngines[node->bus].submit(node->id, [resolution, ranges](OneWireMaster &ds, onewireNode *node, OneWireTransaction &) {
+        if (node == nullptr) return false;
+        node->resolution = resolution;
+        node->inputRanges = ranges;
+        return configureDS2450(ds, *node);
+      }, [](OneWireTransaction &txn) {
+        auto node = getOneWireNode(txn.rom);
+
+        if (!txn.success || node == nullptr) {
+          char id[NODE_ID_LENGTH];
+          formatId(txn.rom, id);
+          ESP_LOGW(TAG, "Failed configuring DS2450 '%s'.", id);
+          return;
+        }
+        saveSettings(oneWireNodes);
+        pushStateToMQTT(*node);
+      });
+    // the resolution is written to the sensor first, and saved when the sensor has it.
+    } else if (isTemperatureSensor(node->familyId) && resolution > 0 && resolution != node->resolution) {
+      oneWireEngines[node->bus].submit(node->id, [resolution](OneWireMaster &ds, onewireNode *node, OneWireTransaction &) {
+        if (node == nullptr) return false;
+        return setResolution(ds, *node, resolution);
+      }, [resolution](OneWireTransaction &txn) {
+        auto node = getOneWireNode(txn.rom);
+
+        if (!txn.success || node == nullptr) {
+          char id[NODE_ID_LENGTH];
+          formatId(txn.rom, id);
+          ESP_LOGW(TAG, "Failed setting resolution %u bits on sensor '%s'.", resolution, id);
+          return;
+        }
+        saveSettings(oneWireNodes);
+        pushStateToMQTT(*node);
+      });
+    }
+  }
+}
+
+// Family fields of the MQTT state, see FamilyHooks::publish.
+
+void publishTemperature(const onewireNode &node, JsonDocument &json) {
+  json["temp"] = ((int)(node.temperature * 100)) / 100.0; // round to two decimals
+  json["lowLimit"] = node.lowLimit;
+  json["highLimit"] = node.highLimit;
+  json["status"] = shouldActuatorBeActive(node);
+  // char arrays are copied into the document, unlike string literals.
+  char actuatorId[NODE_ID_LENGTH];
+  char stateOverride[] = {node.stateOverride, '\0'};
+  formatId(node.actuatorId, actuatorId);
+  json["actuatorId"] = actuatorId;
+  json["actuatorPin"] = node.actuatorPin;
+  json["stateOverride"] = stateOverride;
+  json["resolution"] = node.resolution;
+}
+
+void publishSwitch(const onewireNode &node, JsonDocument &json) {
+  auto pinStateArray = json.createNestedArray("pinState");
+  for (uint8_t i = 0; i < deviceFamily(node.familyId).channels; i++) {
+    pinStateArray.add((bool)bitRead(node.pinStates, i));
   }
 }
 
+void publishCounter(const onewireNode &node, JsonDocument &json) {
+  auto countersArray = json.createNestedArray("counters");
+  auto totalsArray = json.createNestedArray("totals");
+  auto ratesArray = json.createNestedArray("rates");  // pulses/second over the moving window
+  auto amountsArray = json.createNestedArray("amounts");  // totals in units, e.g. kWh
+  auto amountRatesArray = json.createNestedArray("amountRates");  // units/hour over the moving window, e.g. kW
+  auto &state = counterState(node);
+  for (uint8_t i = 0; i < 2; i++) {
+    countersArray.add(node.counters[i]);
+    totalsArray.add(state.pulses[i].total);
+    ratesArray.add(state.pulses[i].averageRate);
+    amountsArray.add(state.pulses[i].total * state.unitsPerPulse[i]);
+    amountRatesArray.add(state.pulses[i].averageRate * state.unitsPerPulse[i] * 3600);
+  }
+}
+
+void publishVoltages(const onewireNode &node, JsonDocument &json) {
+  auto voltagesArray = json.createNestedArray("voltages");
+  auto rangesArray = json.createNestedArray("inputRanges");
+  auto &voltages = analogState(node).voltages;
+  for (uint8_t i = 0; i < DS2450_CHANNELS; i++) {
+    voltagesArray.add(((int)(voltages[i] * 1000)) / 1000.0); // round to three decimals
+    rangesArray.add(bitRead(node.inputRanges, i) ? 5.12 : 2.56);
+  }
+  json["resolution"] = node.resolution;
+}
 
 void pushStateToMQTT(onewireNode& node) {
   if (isMqttEnabled()) {
     // USE this if modifying JSON-message, https://arduinojson.org/v6/assistant/
-    StaticJsonDocument<400> jsonNode; // currently we are at 384 bytes.
+    StaticJsonDocument<560> jsonNode; // currently we are at 540 bytes, with a DS2423 node.
     auto time = getEpocTime();
 
-    ESP_LOGD(TAG, "Pushing state to MQTT broker, node: %s.", node.idStr.c_str());
+    ESP_LOGD(TAG, "Pushing state to MQTT broker, node: %s.", node.idStr);
 
     jsonNode["id"] = node.idStr;
     jsonNode["name"] = node.name;
@@ -829,38 +1239,23 @@ void pushStateToMQTT(onewireNode& node) {
     jsonNode["success"] = node.success;
     jsonNode["lastOperation"] = node.lastOperation;
 
-    if (isTemperatureSensor(node.familyId)) {
-      jsonNode["temp"] = ((int)(node.temperature * 100)) / 100.0; // round to two decimals
-      jsonNode["lowLimit"] = node.lowLimit;
-      jsonNode["highLimit"] = node.highLimit;
-      jsonNode["status"] = shouldActuatorBeActive(node);
-      jsonNode["actuatorId"] = idToString(node.actuatorId);
-      jsonNode["actuatorPin"] = node.actuatorPin;
-      jsonNode["stateOverride"] = String(node.stateOverride);
-    } else if (node.familyId == DS2408) {
-      auto pinStateArray = jsonNode.createNestedArray("pinState");
-      for (auto i : node.actuatorPinState) {
-        pinStateArray.add(i);
-      }
-    } else if (node.familyId == DS2406 || node.familyId == DS2413) {
-      auto pinStateArray = jsonNode.createNestedArray("pinState");
-      pinStateArray.add(pinStateArray[0]);
-      pinStateArray.add(pinStateArray[1]);
-    } else if (node.familyId == DS2405) {
-      auto pinStateArray = jsonNode.createNestedArray("pinState");
-      pinStateArray.add(pinStateArray[0]);
-    } else if (node.familyId == DS2423) {
-      auto countersArray = jsonNode.createNestedArray("counters");
-      for (auto i : node.counters) {
-        countersArray.add(i);
-      }
+    auto &hooks = familyHooks(node.familyId);
+    if (hooks.publish != nullptr) {
+      hooks.publish(node, jsonNode);
+    }
+
+    // on the stack, only while publishing.
+    char payload[MQTT_STATE_SIZE];
+    char nodeTopic[MQTT_TOPIC_SIZE];
+    if (measureJson(jsonNode) >= sizeof(payload) ||
+        snprintf(nodeTopic, sizeof(nodeTopic), "%s/%s", mqtt_topic.c_str(), node.idStr) >= (int)sizeof(nodeTopic)) {
+      ESP_LOGW(TAG, "State of node %s doesn't fit, not published.", node.idStr);
+      return;
     }
 
-    String jsonString;
-    serializeJson(jsonNode, jsonString);
-    auto nodeTopic = mqtt_topic + "/" + node.idStr;
-    if (mqttClient.publish(nodeTopic.c_str(), 1, true, jsonString.c_str()) == 0) {
-      ESP_LOGI(TAG, "Failed to publish state to MQTT broker, node: %s.", node.idStr.c_str());
+    serializeJson(jsonNode, payload, sizeof(payload));
+    if (mqttClient.publish(nodeTopic, 1, true, payload) == 0) {
+      ESP_LOGI(TAG, "Failed to publish state to MQTT broker, node: %s.", node.idStr);
     }
   }
 }
@@ -869,19 +1264,22 @@ void pushStateToMQTT(onewireNode& node) {
 void pushGeneralInfoToMQTT() {
   if (WiFi.isConnected() && isMqttEnabled()) {
     StaticJsonDocument<100> jsonNode;
+    char ip[16];
+    auto localIP = WiFi.localIP();
+    snprintf(ip, sizeof(ip), "%u.%u.%u.%u", localIP[0], localIP[1], localIP[2], localIP[3]);
 
     jsonNode["state"] = "connected";
     jsonNode["rssi"] = WiFi.RSSI();
-    jsonNode["ip"] = WiFi.localIP().toString();
+    jsonNode["ip"] = ip;
     jsonNode["tinyOwcGroup"] = tinyowc_group;
     jsonNode["heatRequirement"] = heat_requirement_product;
     jsonNode["distributeHeat"] = tinyowc_distribute_heat;
     snprintf(buff, sizeof(buff), "%s %s", __DATE__, __TIME__);
-    jsonNode["buildTime"] = String(buff);
+    jsonNode["buildTime"] = buff;
 
-    String jsonString;
-    serializeJson(jsonNode, jsonString);
-    if (mqttClient.publish(mqtt_topic.c_str(), 2, true, jsonString.c_str()) == 0) {
+    char payload[MQTT_STATE_SIZE];
+    serializeJson(jsonNode, payload, sizeof(payload));
+    if (mqttClient.publish(mqtt_topic.c_str(), 2, true, payload) == 0) {
       ESP_LOGI(TAG, "Failed to publish general state to MQTT broker.");
     }
   }
@@ -902,7 +1300,7 @@ void pushAllStateToMQTT() {
 void WiFiEvent(WiFiEvent_t event) {
     switch(event) {
       case SYSTEM_EVENT_STA_GOT_IP:
-        ESP_LOGI(TAG, "WiFi connected and got IP: %s.", WiFi.localIP().toString());
+        ESP_LOGI(TAG, "WiFi connected and got IP: %s.", WiFi.localIP().toString().c_str());
         
         configTime(0, 0, NTP_SERVER);
         connectToMqtt();
@@ -920,18 +1318,80 @@ void WiFiEvent(WiFiEvent_t event) {
     }
 }
 
-String formatLimitValue(float value) {
+// "-" when the limit isn't set, the status page is rendered into buffers on the stack.
+void formatLimitValue(float value, char *str, size_t size) {
   if (value == UNSET_TEMPERATURE) {
-    return "-";
+    snprintf(str, size, "-");
+    return;
   }
-  return String(roundf(value * 10) / 10);
+  snprintf(str, size, "%.2f", roundf(value * 10) / 10);
 }
 
-String formatActuatorPinValue(int8_t value) {
+void formatActuatorPinValue(int8_t value, char *str, size_t size) {
   if (value < 0) {
-    return "-";
+    snprintf(str, size, "-");
+    return;
   }
-  return String(value);
+  snprintf(str, size, "%d", value);
+}
+
+// Family rows of a node on the status page, see FamilyHooks::describe.
+
+void describeTemperature(const onewireNode &i, char *html, size_t size) {
+  if (i.failedReadingsInRow >= 5) {
+    snprintf(html, size, "<tr><td>Status</td><td>Not connected.</td></tr>");
+    return;
+  }
+
+  char lowLimit[16], highLimit[16], actuatorId[NODE_ID_LENGTH], actuatorPin[8];
+  formatLimitValue(i.lowLimit, lowLimit, sizeof(lowLimit));
+  formatLimitValue(i.highLimit, highLimit, sizeof(highLimit));
+  formatId(i.actuatorId, actuatorId);
+  formatActuatorPinValue(i.actuatorPin, actuatorPin, sizeof(actuatorPin));
+
+  snprintf(html, size, "<tr><td>Temp</td><td>%.1f</td></tr>"
+                       "<tr><td>Low-limit</td><td>%s</td></tr>"
+                       "<tr><td>High-limit</td><td>%s</td></tr>"
+                       "<tr><td>Actuator-id</td><td>%s</td></tr>"
+                       "<tr><td>Actuator-pin</td><td>%s</td></tr>"
+                       "<tr><td>State override</td><td>%c</td></tr>"
+                       "<tr><td>Status</td><td>%s</td></tr>",
+    i.temperature,
+    lowLimit,
+    highLimit,
+    actuatorId,
+    actuatorPin,
+    i.stateOverride,
+    shouldActuatorBeActive(i) ? "open" : "closed");
+}
+
+void describeSwitch(const onewireNode &i, char *html, size_t size) {
+  auto written = snprintf(html, size, "<tr><td>Pins</td><td>");
+  for (uint8_t pin = 0; pin < deviceFamily(i.familyId).channels; pin++) {
+    written += snprintf(html + written, size - written, pin > 0 ? " %d" : "%d", bitRead(i.pinStates, pin));
+  }
+  snprintf(html + written, size - written, "</td></tr>");
+}
+
+void describeCounter(const onewireNode &i, char *html, size_t size) {
+  auto &pulses = counterState(i).pulses;
+  snprintf(html, size, "<tr><td>Counters</td><td>%d %d</td></tr>"
+                       "<tr><td>Rates</td><td>%.3f %.3f pulses/s</td></tr>",
+    i.counters[0],
+    i.counters[1],
+    pulses[0].averageRate,
+    pulses[1].averageRate);
+}
+
+void describeVoltages(const onewireNode &i, char *html, size_t size) {
+  auto &voltages = analogState(i).voltages;
+  snprintf(html, size, "<tr><td>Voltages</td><td>%.3f %.3f %.3f %.3f</td></tr>"
+                       "<tr><td>Resolution</td><td>%d bits</td></tr>",
+    voltages[0],
+    voltages[1],
+    voltages[2],
+    voltages[3],
+    i.resolution);
 }
 
 void handle_indexHtml() {
@@ -978,140 +1438,37 @@ void handle_indexHtml() {
     html.replace("%ONE_WIRE_DEVICES%" , "No devices found! Scan 1-Wire network to add new devices.");
   } else {
     String oneWireList = "<ol>";
-    for (auto i : oneWireNodes) {
+    for (auto &i : oneWireNodes) {
 
       time_t epoch_ts = i.lastOperation;
       struct tm ts; 
       localtime_r(&epoch_ts, &ts);
-      strftime(buff, sizeof(buff), "%Y-%m-%d %H:%M:%SZ", &ts);
-      auto lastOperation = String(buff);
-
-      if (isTemperatureSensor(i.familyId)) {
-
-
-          if (i.failedReadingsInRow < 5) {
-            snprintf(buff, sizeof(buff), "<li><table><tbody>"
-                                        "<tr><td>Id</td><td>%s</td></tr>"
-                                        "<tr><td>Type</td><td>%s</td></tr>"
-                                        "<tr><td>Name</td><td>\"%s\"</td></tr>"
-                                        "<tr><td>Temp</td><td>%.1f</td></tr>"
-                                        "<tr><td>Low-limit</td><td>%s</td></tr>"
-                                        "<tr><td>High-limit</td><td>%s</td></tr>"
-                                        "<tr><td>Actuator-id</td><td>%s</td></tr>"
-                                        "<tr><td>Actuator-pin</td><td>%s</td></tr>"
-                                        "<tr><td>State override</td><td>%s</td></tr>"
-                                        "<tr><td>Status</td><td>%s</td></tr>"
-                                        "<tr><td>Errors</td><td>%d</td></tr>"
-                                        "<tr><td>Success</td><td>%d</td></tr>"
-                                        "<tr><td>Last reading</td><td>%s</td></tr>"
-                                        "</tbody></table></li>", 
-            i.idStr.c_str(),
-            familyIdToNameTranslation(i.familyId).c_str(),
-            i.name.c_str(),
-            i.temperature,
-            formatLimitValue(i.lowLimit).c_str(),
-            formatLimitValue(i.highLimit).c_str(),
-            idToString(i.actuatorId).c_str(),
-            i.actuatorPin > -1 ? String(i.actuatorPin).c_str() : String('-').c_str(),
-            String(i.stateOverride).c_str(),
-            shouldActuatorBeActive(i) ? "open" : "closed",
-            i.errors,
-            i.success,
-            lastOperation.c_str());
-          } else {
-            snprintf(buff, sizeof(buff), "<li><table><tbody>"
-                                        "<tr><td>Id</td><td>%s</td></tr>"
-                                        "<tr><td>Type</td><td>%s</td></tr>"
-                                        "<tr><td>Name</td><td>\"%s\"</td></tr>"
-                                        "<tr><td>Status</td><td>Not connected.</td></tr>"
-                                        "<tr><td>Last reading</td><td>%s</td></tr>"
-                                        "</tbody></table></li>",
-                                        i.idStr.c_str(), familyIdToNameTranslation(i.familyId).c_str(), i.name.c_str(), i.lastOperation);
-          }
-      } else if (i.familyId == DS2408) {
-        snprintf(buff, sizeof(buff), "<li><table><tbody>"
-                                      "<tr><td>Id</td><td>%s</td></tr>"
-                                      "<tr><td>Type</td><td>%s</td></tr>"
-                                      "<tr><td>Name</td><td>\"%s\"</td></tr>"
-                                      "<tr><td>Pins</td><td>%d %d %d %d %d %d %d %d</td></tr>"
-                                      "<tr><td>Errors</td><td>%d</td></tr>"
-                                      "<tr><td>Success</td><td>%d</td></tr>"
-                                      "<tr><td>Last operation</td><td>%s</td></tr>"
-                                      "</tbody></table></li>",
-          i.idStr.c_str(),
-          familyIdToNameTranslation(i.familyId).c_str(),
-          i.name.c_str(),
-          i.actuatorPinState[0],
-          i.actuatorPinState[1],
-          i.actuatorPinState[2],
-          i.actuatorPinState[3],
-          i.actuatorPinState[4],
-          i.actuatorPinState[5],
-          i.actuatorPinState[6],
-          i.actuatorPinState[7],
-          i.errors,
-          i.success,
-          lastOperation.c_str());
-      } else if (i.familyId == DS2406 || i.familyId == DS2413) {
-        snprintf(buff, sizeof(buff), "<li><table><tbody>"
-                                      "<tr><td>Id</td><td>%s</td></tr>"
-                                      "<tr><td>Type</td><td>%s</td></tr>"
-                                      "<tr><td>Name</td><td>\"%s\"</td></tr>"
-                                      "<tr><td>Pins</td><td>%d %d</td></tr>"
-                                      "<tr><td>Errors</td><td>%d</td></tr>"
-                                      "<tr><td>Success</td><td>%d</td></tr>"
-                                      "<tr><td>Last operation</td><td>%s</td></tr>"
-                                      "</tbody></table></li>",
-          i.idStr.c_str(),
-          familyIdToNameTranslation(i.familyId).c_str(),
-          i.name.c_str(),
-          i.actuatorPinState[0],
-          i.actuatorPinState[1],
-          i.errors,
-          i.success,
-          lastOperation.c_str());
-      } else if (i.familyId == DS2405) {
-        snprintf(buff, sizeof(buff), "<li><table><tbody>"
-                                      "<tr><td>Id</td><td>%s</td></tr>"
-                                      "<tr><td>Type</td><td>%s</td></tr>"
-                                      "<tr><td>Name</td><td>\"%s\"</td></tr>"
-                                      "<tr><td>Pins</td><td>%d</td></tr>"
-                                      "<tr><td>Errors</td><td>%d</td></tr>"
-                                      "<tr><td>Success</td><td>%d</td></tr>"
-                                      "<tr><td>Last operation</td><td>%s</td></tr>"
-                                      "</tbody></table></li>",
-          i.idStr.c_str(),
-          familyIdToNameTranslation(i.familyId).c_str(),
-          i.name.c_str(),
-          i.actuatorPinState[0],
-          i.errors,
-          i.success,
-          lastOperation.c_str());
-      } else if (i.familyId == DS2423) {
-        snprintf(buff, sizeof(buff), "<li><table><tbody>"
-                                      "<tr><td>Id</td><td>%s</td></tr>"
-                                      "<tr><td>Type</td><td>%s</td></tr>"
-                                      "<tr><td>Name</td><td>\"%s\"</td></tr>"
-                                      "<tr><td>Counters</td><td>%d %d</td></tr>"
-                                      "<tr><td>Errors</td><td>%d</td></tr>"
-                                      "<tr><td>Success</td><td>%d</td></tr>"
-                                      "<tr><td>Last operation</td><td>%s</td></tr>"
-                                      "</tbody></table></li>",
-          i.idStr.c_str(),
-          familyIdToNameTranslation(i.familyId).c_str(),
-          i.name.c_str(),
-          i.counters[0],
-          i.counters[1],
-          i.errors,
-          i.success,
-          lastOperation.c_str());
-      } else {
-        snprintf(buff, sizeof(buff), "<li><table><tbody>"
-                                      "<tr><td>Id</td><td>%s</td></tr>"
-                                      "<tr><td>Type</td><td>%s</td></tr>"                                    
-                                      "</tbody></table></li>", i.idStr.c_str(), familyIdToNameTranslation(i.familyId).c_str());
+      char lastOperation[24];
+      strftime(lastOperation, sizeof(lastOperation), "%Y-%m-%d %H:%M:%SZ", &ts);
+
+      snprintf(buff, sizeof(buff), "<li><table><tbody>"
+                                    "<tr><td>Id</td><td>%s</td></tr>"
+                                    "<tr><td>Type</td><td>%s</td></tr>"
+                                    "<tr><td>Name</td><td>\"%s\"</td></tr>",
+        i.idStr,
+        deviceFamily(i.familyId).name,
+        i.name);
+      oneWireList += buff;
+
+      auto &hooks = familyHooks(i.familyId);
+      if (hooks.describe != nullptr) {
+        hooks.describe(i, buff, sizeof(buff));
+        oneWireList += buff;
       }
 
+      snprintf(buff, sizeof(buff), "<tr><td>Errors</td><td>%d</td></tr>"
+                                    "<tr><td>Success</td><td>%d</td></tr>"
+                                    "<tr><td>Last operation</td><td>%s</td></tr>"
+                                    "</tbody></table></li>",
+        i.errors,
+        i.success,
+        lastOperation);
+
       oneWireList += String(buff);
       oneWireList += "<hr>";
     }
@@ -1151,7 +1508,7 @@ void loadMqttSetting() {
   }
   if (mqttserver_portElm.value.length()) {
     mqttserver_port = mqttserver_portElm.value;
-    ESP_LOGI(TAG, "mqttserver_port set to '%d'", mqttserver_port.toInt());
+    ESP_LOGI(TAG, "mqttserver_port set to '%s'", mqttserver_port.c_str());
   }
   if (mqtt_topicElm.value.length()) {
     mqtt_base_topic = mqtt_topicElm.value;
@@ -1168,7 +1525,7 @@ void loadMqttSetting() {
     ESP_LOGI(TAG, "tinyowc_group set to '%s'", tinyowc_group.c_str());
   }
   tinyowc_distribute_heat = tinyowc_distribute_heatElm.value == "checked";
-  ESP_LOGI(TAG, "tinyowc_distribute_heat set to '%s'", String(tinyowc_distribute_heat));
+  ESP_LOGI(TAG, "tinyowc_distribute_heat set to '%s'", tinyowc_distribute_heat ? "true" : "false");
 
   portal.on(AUX_MQTTSETTING, loadMqttParams);
   portal.on(AUX_MQTTSAVE, saveMqttParams);
@@ -1178,6 +1535,9 @@ void loadMqttSetting() {
     mqttClient.onDisconnect(onMqttDisconnect);
     mqttClient.onSubscribe(onMqttSubscribe);
     mqttClient.onUnsubscribe(onMqttUnsubscribe);
+    if (sensorSettingsQueue == nullptr) {
+      sensorSettingsQueue = xQueueCreate(SENSOR_SETTINGS_QUEUE_LENGTH, sizeof(SensorSettings));
+    }
     mqttClient.onMessage(onMqttMessage);
     mqttClient.setClientId(appName.c_str());
     mqttClient.setMaxTopicLength(256);
@@ -1219,9 +1579,48 @@ void loadInfluxDbSetting() {
   portal.on(AUX_INFLUXSAVE, saveInfluxParams);
 }
 
+// Initialize a DS2480B bus master and negotiate the fastest host link baud rate.
+void beginBusMaster(DS2480B &master, uint8_t bus) {
+  snprintf(buff, sizeof(buff), "DS2480B on bus %u initializing...", bus);
+  tft.println(buff);
+  Serial.println(buff);
+
+  master.begin();
+  auto baudRate = master.negotiateBaudRate();
+
+  snprintf(buff, sizeof(buff), "DS2480B initialized, %u baud.", baudRate);
+  tft.println(buff);
+  Serial.println(buff);
+}
+
+// Initialize a DS2484 bus master, the I2C port should be started already.
+void beginBusMaster(DS2484 &master, uint8_t bus) {
+  snprintf(buff, sizeof(buff), "DS2484 on bus %u initializing...", bus);
+  tft.println(buff);
+  Serial.println(buff);
+
+  if (master.begin()) {
+    snprintf(buff, sizeof(buff), "DS2484 initialized, %u Hz I2C.", master.getLinkSpeed());
+  } else {
+    snprintf(buff, sizeof(buff), "DS2484 not found!");
+  }
+  tft.println(buff);
+  Serial.println(buff);
+}
+
 void setup() {
   Serial.begin(115200);
-  Serial2.begin(9600, SERIAL_8N1, RXD2, TXD2, false, 800);  // 800ms timeout to DS2480
+#ifdef TINYOWC_DS2484
+  Wire.begin(I2C_SDA, I2C_SCL, I2C_FREQUENCY);
+#else
+  Serial2.begin(9600, SERIAL_8N1, RXD2, TXD2, false, 800);  // 800ms timeout to DS2480, speed is negotiated in ds.negotiateBaudRate()
+#endif
+#ifdef TINYOWC_SERIAL1_BUS
+  Serial1.begin(9600, SERIAL_8N1, RXD1, TXD1, false, 800);
+#endif
+#ifdef TINYOWC_WIRE1_BUS
+  Wire1.begin(I2C1_SDA, I2C1_SCL, I2C_FREQUENCY);
+#endif
   Serial.println("Setup serial ports done.");
 
   tft.init();
@@ -1250,17 +1649,18 @@ void setup() {
 
   preferences.begin("tiny-owc", false);
   loadSettings();
+  restoreCounters(oneWireNodes);
   tft.println("Settings loaded.");
   Serial.println("Settings loaded.");
 
-  tft.println("DS2480B initializing...");
-  Serial.println("DS2480B initializing...");
-
-  ds.begin();
+  beginBusMaster(ds, 0);
+#ifdef TINYOWC_SERIAL1_BUS
+  beginBusMaster(serial1Ds, 1);
+#endif
+#ifdef TINYOWC_WIRE1_BUS
+  beginBusMaster(wire1Ds, ONEWIRE_BUS_COUNT - 1);
+#endif
 
-  tft.println("DS2480B initialized.");
-  Serial.println("DS2480B initialized.");
-  
   if (!SPIFFS.begin(true)) {
     tft.println("An Error has occurred while mounting SPIFFS.");
     Serial.println("An Error has occurred while mounting SPIFFS.");
@@ -1343,178 +1743,176 @@ void setup() {
 
   printOneWireNodes();
 
-  // Set DS2408 to a known state (testmode=off,strobe out,all relayes off).
-  for (auto &node : oneWireNodes) {
-    if (node.familyId == DS2408) {
-      ds2408_reset(ds, node);
-    }
+  // from now on all 1-Wire I/O is done by the 1-Wire tasks.
+  for (uint8_t bus = 0; bus < ONEWIRE_BUS_COUNT; bus++) {
+    oneWireEngines[bus].begin();
+    actuatorManagers[bus].begin(oneWireEngines[bus], bus);
   }
+  beginSampling(oneWireEngines, actuatorManagers, ONEWIRE_BUS_COUNT);
+  indexActuators();
+  probeSensors();
+  resetActuators();
 
   Serial.println("Setup() done.");
 }
 
 void pushChanges(onewireNode& node) {
   if (WiFi.isConnected()) {
-    writeInfluxPoint(node);
+    auto &hooks = familyHooks(node.familyId);
+    writeInfluxPoint(node, hooks.measurement, hooks.addFields);
     pushStateToMQTT(node);
     node.millisWhenLastPush = millis();
   }
 }
 
-/**
- * @brief Set a actuator pin
- * 
- * @param actuatorId 
- * @param actuatorPin 
- * @param pinState 
- * @return true pin was successfully set
- * @return false pin was not set, operation failed or actuator was not found, or no actuatorPin was specified.
- */
-bool setActuator(uint8_t actuatorId[8], int8_t actuatorPin, bool pinState) {
-  if (actuatorPin < 0) {
-    return false;
-  }
-
-  auto actuatorNode = getOneWireNode(actuatorId);
-
-  if (actuatorNode == nullptr) {
-    return false;
-  }
-
-  // populate actuatorState with current state
-  uint8_t actuatorState = 0;
-  for (auto i = 0; i < 8; i++) {
-    bitWrite(actuatorState, i, !actuatorNode->actuatorPinState[i]);  // invert, low means On (reversed logic)
-  }
-  auto oldActuatorState = actuatorState;
+// A new family gets its entry here, and its traits in deviceFamilies (onewire.h).
+const FamilyHooks familyHookTable[] = {
+  // family   sample             publish             render             describe             measurement    addFields
+  {DS18S20,   sampleTemperature, publishTemperature, renderTemperature, describeTemperature, "temperature", addTemperatureFields},
+  {DS1822,    sampleTemperature, publishTemperature, renderTemperature, describeTemperature, "temperature", addTemperatureFields},
+  {DS18B20,   sampleTemperature, publishTemperature, renderTemperature, describeTemperature, "temperature", addTemperatureFields},
+  {DS2405,    sampleSwitch,      publishSwitch,      renderSwitch,      describeSwitch,      "actuator",    addSwitchFields},
+  {DS2406,    sampleSwitch,      publishSwitch,      renderSwitch,      describeSwitch,      "actuator",    addSwitchFields},
+  {DS2413,    sampleSwitch,      publishSwitch,      renderSwitch,      describeSwitch,      "actuator",    addSwitchFields},
+  {DS2408,    sampleSwitch,      publishSwitch,      renderSwitch,      describeSwitch,      "actuator",    addSwitchFields},
+  {DS2423,    sampleCounter,     publishCounter,     renderCounter,     describeCounter,     "counters",    addCounterFields},
+  {DS2450,    sampleVoltages,    publishVoltages,    renderVoltages,    describeVoltages,    "voltages",    addVoltageFields},
+};
 
-  bitWrite(actuatorState, actuatorPin, !pinState);  // invert bit since 1 means relay off.
-  auto response = setState(ds, *actuatorNode, actuatorState);
-  // if we managed to set state.
-  if (response > -1) {
-    actuatorNode->lastOperation = epochTime;
-    actuatorNode->actuatorPinState[actuatorPin] = pinState;
+const FamilyHooks noHooks = {0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
 
-    ESP_LOGI(TAG, "Adjusted actuator state, old value: %s, new value: %s.", String(~oldActuatorState, BIN).c_str(), String(~actuatorState, BIN).c_str());
-    pushChanges(*actuatorNode);
-    return true;
+const FamilyHooks &familyHooks(uint8_t familyId) {
+  for (auto &hooks : familyHookTable) {
+    if (hooks.familyId == familyId) return hooks;
   }
-  return false;
+  return noHooks;
 }
 
 // Main work of Tiny-OWC done here.
+// All bus I/O is queued on the 1-Wire task, results are handled by the completions in sampling.h.
 void actOnSensors() {
   auto currentMillis = millis();
 
-  if (oneWireNodes.size() > 0 && lastReadingTime + SAMPLE_DELAY < currentMillis) {
+  if (oneWireNodes.size() > 0 && !isSampling && lastReadingTime + SAMPLE_DELAY < currentMillis) {
+    uint16_t conversionTimes[ONEWIRE_BUS_COUNT] = {};
+    bool parasite[ONEWIRE_BUS_COUNT] = {};
 
-    if (!conversionStarted) {
-      startSimultaneousConversion(ds);
-      conversionStarted = esp_timer_get_time();
-    } else {
-      // check if 1 second has elapsed since conversion started, if true then we can read temperature from all temperature sensors.
-      if (conversionStarted + 1000000 < esp_timer_get_time()) {
-        conversionStarted = 0;
-        uint16_t calculatedHeatRequirement = 0;
+    // the slowest sensor sets the conversion time of its bus, one parasite powered sensor and the whole bus is converted on the strong pullup.
+    for (auto &node : oneWireNodes) {
+      if (isTemperatureSensor(node.familyId)) {
+        if (conversionTime(node) > conversionTimes[node.bus]) {
+          conversionTimes[node.bus] = conversionTime(node);
+        }
+        parasite[node.bus] |= node.parasite;
+      }
+    }
 
-        for (auto &node : oneWireNodes) {
-          if (isTemperatureSensor(node.familyId)) {
-
-            if (node.stateOverride == '1') {
-              setActuator(node.actuatorId, node.actuatorPin, true);
-            } else if (node.stateOverride == '0') {
-              setActuator(node.actuatorId, node.actuatorPin, false);
-            }
-
-            auto reading = readConversion(ds, node);
-
-            if (reading != UNSET_TEMPERATURE) {
-              node.failedReadingsInRow = 0;
-              node.lastOperation = epochTime;
-              auto temperature = rawToCelsius(reading);
-
-              // Add this sensors need of more warm water to total sum of requirement for this device.
-              if (node.lowLimit > UNSET_TEMPERATURE && temperature < node.lowLimit) {
-                calculatedHeatRequirement += abs(temperature - node.lowLimit);
-              }
-
-              // filter some noise by only including changes larger than 0.5 degrees.
-              ESP_LOGD(TAG, "Temp reading: raw %d, temp %.2f, last %.2f", reading, temperature, node.lastTemperature);
-
-              // Only record changes if temperature are greater or equal to hysteresis, we don't want too frequent changes.
-              // 85 we don't need to measure this high temperatures, 85 is also the power-on temperature of the sensor.
-              if (abs(temperature - node.temperature) >= TEMPERATURE_HYSTERESIS && temperature < 85.0) {
-                node.lastTemperature = node.temperature == UNSET_TEMPERATURE ? temperature : node.temperature;
-                node.temperature = temperature;
-                // If sensor is set to automatic control and has lowlimit and highlimit values, then set control pin output according to temperature.
-                if (node.stateOverride == 'A' && node.lowLimit > UNSET_TEMPERATURE && node.highLimit > UNSET_TEMPERATURE) {
-                  // temperature is outside boundary, compensate by signaling control pin of shunt.
-                  if (node.temperature < node.lowLimit || node.temperature > node.highLimit) {
-                    setActuator(node.actuatorId, node.actuatorPin, shouldActuatorBeActive(node));
-                  }
-                }
-                
-                pushChanges(node);
-              }
-            } else {
-              node.failedReadingsInRow++;
-            }
-            // make a force push even if nothing has changed, if changes are too infrequent.
-            if (reading != UNSET_TEMPERATURE && node.millisWhenLastPush + FORCE_MQTT_PUSH < currentMillis) {
-              pushChanges(node);
-            }
-          } else if (node.familyId == DS2408) {
-            // TODO: in the future when we have managed to read the DS2408 pin states then can use this code, for now we just hope the values we push out is the ones that are aqually set. :-/
-            /*uint8_t currentState = getState(ds, node);
-            
-            if (currentState > -1) {
-              uint8_t newState = currentState;
-
-              for (auto i = 0; i < 8; i++) {
-                if (bitRead(currentState, i) != node.actuatorPinState[i]) {
-                  bitWrite(newState, i, node.actuatorPinState[i]);
-                }
-              }
-              // make sure the DS2408 actually reflects the state of actuatorPinState.
-              if (newState != currentState) {
-                setState(ds, node, newState);
-              }
-            }*/
-
-            pushChanges(node);
-
-          } else if (node.familyId == DS2406 || node.familyId == DS2413) {
-            // TODO
-          } else if (node.familyId == DS2405) {
-            // TODO
-          } else if (node.familyId == DS2423) {
-            auto a = getCounter(ds, node, 0);
-            auto b = getCounter(ds, node, 1);
-            node.lastOperation = epochTime;
-
-            if (a >= 0) {
-              node.counters[0] = a;
-            }
-
-            if (b >= 0) {
-              node.counters[1] = b;
-            }
-            
-            if (a >= 0 && b >= 0) {
-              pushChanges(node);
-            }
+    isSampling = true;
+    samplingBuses = 0;
+    cycleHeap.begin();
+#ifdef TINYOWC_ALARM_SAMPLING
+    for (auto &node : oneWireNodes) {
+      node.alarming = false;
+    }
+#endif
+
+    // all buses convert at the same time, the readings start when the last one is done.
+    for (uint8_t bus = 0; bus < ONEWIRE_BUS_COUNT; bus++) {
+      if (conversionTimes[bus] == 0) {
+        continue;  // no temperature sensors on the bus
+      }
+
+      auto time = conversionTimes[bus];
+      auto parasitePowered = parasite[bus];
+      auto queued = oneWireEngines[bus].submit(nullptr, [time, parasitePowered, bus](OneWireMaster &ds, onewireNode *, OneWireTransaction &) {
+        auto converted = convertTemperatures(ds, time, parasitePowered);
+#ifdef TINYOWC_ALARM_SAMPLING
+        // only the sensors outside their limits have to be read now, all of them if that isn't known.
+        if (!converted || !findAlarmingSensors(ds)) {
+          for (auto &node : oneWireNodes) {
+            if (node.bus == bus) node.alarming = true;
           }
         }
+#endif
+        return converted;
+      }, [](OneWireTransaction &) {
+        if (--samplingBuses == 0) {
+          conversionDone = true;
+        }
+      });
+
+      if (queued) samplingBuses++;
+    }
+    // nothing to convert, read the other devices right away.
+    conversionDone = samplingBuses == 0;
+  } else if (conversionDone) {
+    conversionDone = false;
+    cycleHeatRequirement = 0;
+
+    // one conditional search per bus finds the DS2408s with changed pins, before they are read.
+    bool boards[ONEWIRE_BUS_COUNT] = {};
+    for (auto &node : oneWireNodes) {
+      if (node.familyId == DS2408) {
+        node.alarming = false;
+        boards[node.bus] = true;
+      }
+    }
+    for (uint8_t bus = 0; bus < ONEWIRE_BUS_COUNT; bus++) {
+      if (!boards[bus]) {
+        continue;
+      }
+
+      oneWireEngines[bus].submit(nullptr, [bus](OneWireMaster &ds, onewireNode *, OneWireTransaction &) {
+        if (findActiveBoards(ds)) return true;
+
+        // read all boards back if the search failed.
+        for (auto &node : oneWireNodes) {
+          if (node.familyId == DS2408 && node.bus == bus) node.alarming = true;
+        }
+        return false;
+      });
+    }
 
-        heat_requirement_product = calculatedHeatRequirement;
+    for (auto &node : oneWireNodes) {
+      auto &hooks = familyHooks(node.familyId);
+      if (hooks.sample != nullptr) {
+        hooks.sample(node, currentMillis);
+      }
+    }
+
+    // queued after all readings on each bus, so the cycle is done when the last bus completes it.
+    samplingBuses = 0;
+    for (auto &engine : oneWireEngines) {
+      auto queued = engine.submit(nullptr, [](OneWireMaster &, onewireNode *, OneWireTransaction &) {
+        return true;
+      }, [currentMillis](OneWireTransaction &) {
+        if (--samplingBuses > 0) {
+          return;
+        }
+        heat_requirement_product = cycleHeatRequirement;
         numberOfSamplesSinceReboot++;
+        flushActuators();
+
+        if (lastCounterSaveTime + COUNTER_SAVE_INTERVAL < currentMillis) {
+          saveCounters(oneWireNodes);
+          lastCounterSaveTime = currentMillis;
+        }
 
         flushInflux();
         printOneWireNodes();
-        
+#ifdef TINYOWC_HEAP_STATS
+        // the allocations of the network tasks meanwhile are included, a steady cycle of its own makes none.
+        ESP_LOGI(TAG, "Sample cycle %ld: %u heap allocations, free heap %u bytes, largest block %u bytes.",
+          numberOfSamplesSinceReboot, cycleHeap.allocations(), ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+#endif
+
         lastReadingTime = currentMillis;
-      }
+        isSampling = false;
+      });
+
+      if (queued) samplingBuses++;
     }
+    isSampling = samplingBuses > 0;
   }
 }
 
@@ -1545,6 +1943,14 @@ void loop() {
     portal.handleClient();
   }
 
+  for (auto &engine : oneWireEngines) {
+    engine.dispatchCompletions();
+  }
+  applySensorSettings();
+  if (mqttStatePending.exchange(false)) {
+    pushAllStateToMQTT();
+  }
+
   if (state == START_SCANNING) {
     scanOneWireNetwork();
   } else if (scannedOneWireNodes.size() > 0) {
@@ -1558,7 +1964,7 @@ void loop() {
   }
 
   if (WiFi.isConnected() && wifiReadingTime + SAMPLE_DELAY < now) {
-    writeWiFiSignalStrength(appName);
+    writeWiFiSignalStrength(appName.c_str());
     wifiReadingTime = now;
   }
 
@@ -2,8 +2,10 @@
 #define Onewire_h
 
 #include <Arduino.h>
-#include <DS2480B.h>
+#include <OneWireMaster.h>
 #include <vector>
+#include "counters.h"
+#include "tinyowc.h"
 
 // just a value indicating the variable has no value.
 #define UNSET_TEMPERATURE -1024
@@ -11,116 +13,365 @@
 // number of read tries before giving up
 #define MAX_CONSECUTIVE_RETRIES 3
 
+#define NODE_ID_LENGTH 18    // "28.EEA89B19160262" and the terminating null.
+#define NODE_NAME_LENGTH 21  // names are cut to 20 characters.
+#define NO_FAMILY_STATE 0xFF
+
+/**
+ * A 1-Wire device known to the controller. The state read and written every sampling cycle comes first,
+ * the configuration from the settings after it. The strings are kept inline, so a node is copied without
+ * any heap allocation. The larger state of a few families is kept apart, see CounterState.
+ */
 struct onewireNode {
-  uint8_t id[8];     // e.g. 28,EE,A8,9B,19,16,2,62
+  union {
+    uint8_t id[8];   // e.g. 28,EE,A8,9B,19,16,2,62
+    uint64_t rom;    // the same 8 bytes as one key, see romKey().
+  };
   uint8_t familyId;  // e.g. 28
-  String idStr;      // e.g. "28.EEA89B19160262"
-  String name;       // optional description, e.g. "bedroom", length is limited.
-  float lowLimit = UNSET_TEMPERATURE;        // only applicable on temperature sensors.
-  float highLimit = UNSET_TEMPERATURE;       // only applicable on temperature sensors.
+  uint8_t bus = 0;          // index of the bus master the device is connected to, see oneWireEngines in main.cpp.
+  uint8_t resolution = 12;  // only applicable on temperature sensors and DS2450 nodes, in bits, read from the sensor. Sets the conversion time.
+  uint8_t pinStates = 0;    // only applicable on DS2405, DS2406, DS2413 and DS2408 nodes, bit n is pin n, 1 -> on.
+  bool overdrive = false;   // device supports 1-Wire overdrive speed, e.g. DS2408 and DS2423. DS18x20 sensors are always accessed at standard speed.
+  bool parasite = false;    // only applicable on temperature sensors, powered from the 1-Wire bus.
+  bool alarming = false;    // only applicable on temperature sensors, found by the alarm search after the last conversion.
+  bool alarmLimits = false; // only applicable on temperature sensors, TH/TL are programmed from lowLimit/highLimit, see TINYOWC_ALARM_SAMPLING.
+  uint16_t failedReadingsInRow = 0; // only applicable on temperature sensors.
   float temperature = UNSET_TEMPERATURE;     // only applicable on temperature sensors.
   float lastTemperature = UNSET_TEMPERATURE; // only applicable on temperature sensors.
-  unsigned long lastOperation = 0;  // last time a operation (read/write) was made on the device (e.g. temperature was updated or pin was set)
-  uint16_t failedReadingsInRow = 0; // only applicable on temperature sensors.
   uint32_t errors = 0;  // read/write errors for device (if many then check device and cables)
   uint32_t success = 0; // read/write success operations for device
+  unsigned long lastOperation = 0;  // last time a operation (read/write) was made on the device (e.g. temperature was updated or pin was set)
   unsigned long millisWhenLastPush = 0; // keep track of how long since we reported status to MQTT-broker or InfluxDB
-  uint8_t actuatorId[8] = {}; // e.g. 29,29,E1,3,0,0,0,9C, only applicable on temperature sensors.
-  int8_t actuatorPin = -1;    // only applicable on temperature sensors.
-  bool actuatorPinState[8] = {false, false, false, false, false, false, false, false}; // only applicable on DS2405, DS2406, DS2413 and DS2408 nodes.
-  uint32_t counters[2] = {0, 0};  // only applicable on DS2423 nodes. Only external counters (A & B) exposed.
+  uint32_t counters[2] = {0, 0};    // only applicable on DS2423 nodes. Only external counters (A & B) exposed.
+
+  char idStr[NODE_ID_LENGTH] = "";      // e.g. "28.EEA89B19160262"
+  char name[NODE_NAME_LENGTH] = "";     // optional description, e.g. "bedroom", see setNodeName().
   char stateOverride = 'A'; // only applicable on temperature sensors with a actuatorPin set. '1' -> actuatorPin is always set to 1, '0' -> actuatorPin is always set to 0, 'A' (as in automatic) -> actuatorPin is set to 1 when temperature is below "lowLimit" and 0 then temperature is higher than highLimit.
+  int8_t actuatorPin = -1;    // only applicable on temperature sensors.
+  uint8_t inputRanges = 0x0F; // only applicable on DS2450 nodes, a bit per channel, 1 -> 5.12 V range, 0 -> 2.56 V.
+  uint8_t familyState = NO_FAMILY_STATE;  // only applicable on DS2423 and DS2450 nodes, see counterState() and analogState().
+  float lowLimit = UNSET_TEMPERATURE;   // only applicable on temperature sensors.
+  float highLimit = UNSET_TEMPERATURE;  // only applicable on temperature sensors.
+  union {
+    uint8_t actuatorId[8] = {}; // e.g. 29,29,E1,3,0,0,0,9C, only applicable on temperature sensors.
+    uint64_t actuatorRom;       // the same as a key.
+  };
 };
 
 std::vector<onewireNode> oneWireNodes;
 std::vector<onewireNode> scannedOneWireNodes;
 
-String familyIdToNameTranslation(uint8_t familyId) {
-      switch (familyId) {
-        case DS2405:
-          return "DS2405";
-        case DS2406:
-          return "DS2406";
-        case DS2413:
-          return "DS2413";
-        case DS2408:
-          return "DS2408";
-        case DS18S20:
-          return "DS18S20";
-        case DS18B20:
-          return "DS18B20";
-        case DS1822:
-          return "DS1822";
-        case DS2423:
-          return "DS2423";
-        case DS2450:
-          return "DS2450";
-        default:
-          return "";
-      }
+/**
+ * State of a DS2423 node, kept in counterStates so the nodes of the other families don't carry it.
+ */
+struct CounterState {
+  uint64_t rom = 0;                // the node it belongs to.
+  float unitsPerPulse[2] = {0, 0}; // e.g. 0.001 for a 1000 pulses/kWh meter. 0 if not set.
+  PulseCounter pulses[2];          // totals and rates of counters A & B.
+};
+
+/**
+ * State of a DS2450 node, kept in analogStates.
+ */
+struct AnalogState {
+  uint64_t rom = 0;
+  float voltages[4] = {0, 0, 0, 0};  // channel A to D.
+};
+
+// An entry per device, shared by the copies of its node (e.g. in scannedOneWireNodes) and found
+// through onewireNode::familyState. Entries are only added on loop(), see indexNodes().
+std::vector<CounterState> counterStates;
+std::vector<AnalogState> analogStates;
+
+template <typename T>
+T &familyState(std::vector<T> &states, onewireNode &node) {
+  if (node.familyState < states.size() && states[node.familyState].rom == node.rom) {
+    return states[node.familyState];
+  }
+
+  for (uint8_t i = 0; i < states.size(); i++) {
+    if (states[i].rom == node.rom) {
+      node.familyState = i;
+      return states[i];
+    }
+  }
+
+  if (states.size() >= NO_FAMILY_STATE) {
+    static T overflow;  // more devices than entries, shared and not kept.
+    overflow = T();
+    return overflow;
+  }
+  states.emplace_back();
+  states.back().rom = node.rom;
+  node.familyState = states.size() - 1;
+  return states.back();
+}
+
+// The entry of a node without one yet is all zero.
+template <typename T>
+const T &familyState(const std::vector<T> &states, const onewireNode &node) {
+  if (node.familyState < states.size() && states[node.familyState].rom == node.rom) {
+    return states[node.familyState];
+  }
+
+  for (auto &state : states) {
+    if (state.rom == node.rom) return state;
+  }
+
+  static const T none{};
+  return none;
+}
+
+// The counter state of a DS2423 node, added if it has none.
+CounterState &counterState(onewireNode &node) { return familyState(counterStates, node); }
+const CounterState &counterState(const onewireNode &node) { return familyState(counterStates, node); }
+
+// The voltages of a DS2450 node, added if it has none.
+AnalogState &analogState(onewireNode &node) { return familyState(analogStates, node); }
+const AnalogState &analogState(const onewireNode &node) { return familyState(analogStates, node); }
+
+// Capabilities of a device family, see DeviceFamily.
+#define FAMILY_TEMPERATURE 0x01  // temperature sensor, sampled by the simultaneous conversion of its bus
+#define FAMILY_SWITCH 0x02       // addressable switch, can be bound to a temperature sensor as its actuator
+#define FAMILY_COUNTER 0x04      // pulse counters
+#define FAMILY_ANALOG 0x08       // A/D converter
+#define FAMILY_OVERDRIVE 0x10    // can be accessed at 1-Wire overdrive speed
+
+/**
+ * What the firmware knows about a 1-Wire device family, looked up by the family code (the first ROM byte).
+ * The behaviour of the controller for each family, what is read, published and shown, is in familyHooks in main.cpp.
+ */
+struct DeviceFamily {
+  uint8_t id;            // family code, e.g. 28
+  const char *name;      // e.g. "DS18B20", empty for an unsupported family.
+  uint8_t channels;      // switch outputs, counters or A/D inputs of the device.
+  uint8_t capabilities;  // FAMILY_* bits
+
+  constexpr bool has(uint8_t capability) const { return (capabilities & capability) != 0; }
+  constexpr bool supported() const { return id != 0; }
+};
+
+// The supported families, a new one is added here and, for its behaviour, to familyHooks in main.cpp.
+constexpr DeviceFamily deviceFamilies[] = {
+  {DS18S20, "DS18S20", 1, FAMILY_TEMPERATURE},
+  {DS1822,  "DS1822",  1, FAMILY_TEMPERATURE},
+  {DS18B20, "DS18B20", 1, FAMILY_TEMPERATURE},
+  {DS2405,  "DS2405",  1, FAMILY_SWITCH},
+  {DS2406,  "DS2406",  2, FAMILY_SWITCH | FAMILY_OVERDRIVE},
+  {DS2413,  "DS2413",  2, FAMILY_SWITCH | FAMILY_OVERDRIVE},
+  {DS2408,  "DS2408",  8, FAMILY_SWITCH | FAMILY_OVERDRIVE},
+  {DS2423,  "DS2423",  2, FAMILY_COUNTER | FAMILY_OVERDRIVE},
+  {DS2450,  "DS2450",  4, FAMILY_ANALOG | FAMILY_OVERDRIVE},
+};
+
+constexpr DeviceFamily unsupportedFamily = {0, "", 0, 0};
+
+/**
+ * The traits of a family, unsupportedFamily if it isn't in deviceFamilies. Can be evaluated at compile time.
+ */
+constexpr const DeviceFamily &deviceFamily(uint8_t familyId, size_t index = 0) {
+  return index == sizeof(deviceFamilies) / sizeof(deviceFamilies[0]) ? unsupportedFamily
+       : deviceFamilies[index].id == familyId ? deviceFamilies[index]
+       : deviceFamily(familyId, index + 1);
+}
+
+static_assert(deviceFamily(DS2408).channels == 8 && !deviceFamily(0x01).supported(), "deviceFamilies lookup");
+
+/*
+* Issue "MATCH ROM" for the node, using overdrive speed for the rest of the transaction if the node supports it.
+* You do the reset first.
+*/
+void selectNode(OneWireMaster &ds, const onewireNode &node) {
+  if (node.overdrive) {
+    ds.selectOverdrive(node.id);
+  } else {
+    ds.select(node.id);
+  }
+}
+
+/*
+* Reselect the last selected device after a failed transfer, at standard speed since the reset ends overdrive.
+*/
+bool resumeNode(OneWireMaster &ds, onewireNode &node, const char *operation) {
+  if (!ds.reset()) {
+    ESP_LOGW(TAG, "Reset %s failed after non-success %s: %s.", node.idStr, operation, OneWireMaster::statusToString(ds.getStatus()));
+    node.errors++;
+    return false;
+  }
+
+  ds.write(RESUME); // reselect last selected device.
+  return true;
 }
 
 /*
 * Convert 1-wire address to string
 * 28,EE,A8,9B,19,16,2,62 -> "28.EEA89B19160262"
 */
+void formatId(const uint8_t addr[8], char str[NODE_ID_LENGTH]) {
+  snprintf(str, NODE_ID_LENGTH, "%02X.%02X%02X%02X%02X%02X%02X%02X", addr[0], addr[1], addr[2], addr[3], addr[4], addr[5], addr[6], addr[7]);
+}
+
+/**
+ * The pin states as binary digits, most significant first, e.g. "101" for 0x05. Without allocating, unlike String(state, BIN).
+ */
+void formatPinStates(uint8_t state, char str[8 + 1]) {
+  uint8_t length = 0;
+  for (int8_t pin = 7; pin >= 0; pin--) {
+    if (length > 0 || bitRead(state, pin) || pin == 0) str[length++] = bitRead(state, pin) ? '1' : '0';
+  }
+  str[length] = '\0';
+}
+
 String idToString(const uint8_t addr[8]) {
-  char dataString[50] = {0};
-  snprintf(dataString, sizeof(dataString), "%02X.%02X%02X%02X%02X%02X%02X%02X",addr[0], addr[1], addr[2], addr[3], addr[4], addr[5], addr[6], addr[7]);
+  char dataString[NODE_ID_LENGTH];
+  formatId(addr, dataString);
 
   return String(dataString);
 }
 
 /*
-* Convert string to 1-wire byte array address
+* The 8 ROM bytes as one key, the same as onewireNode::rom.
+*/
+uint64_t romKey(const uint8_t addr[8]) {
+  uint64_t key;
+  memcpy(&key, addr, sizeof(key));
+  return key;
+}
+
+/*
+* Set the name of the node, longer names are cut.
+*/
+void setNodeName(onewireNode &node, const char *name) {
+  snprintf(node.name, sizeof(node.name), "%s", name != nullptr ? name : "");
+}
+
+// value of a hex digit, -1 if c isn't one.
+int8_t hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+/*
+* Parse a 1-wire address string into the byte array, without any allocation.
 * "29.29E1030000009C" -> 29,29,E1,3,0,0,0,9C
+* @return false, with addr untouched, if str isn't an address.
 */
-byte *stringToId(String str, byte *addr) {
-  // safetycheck, 1-Wire addresses are always 17 chars long.
-  if (str.length() == 17) {
-    addr[0] = strtoul(str.substring(0, 2).c_str(), NULL, 16);
-    addr[1] = strtoul(str.substring(3, 5).c_str(), NULL, 16);
-    addr[2] = strtoul(str.substring(5, 7).c_str(), NULL, 16);
-    addr[3] = strtoul(str.substring(7, 9).c_str(), NULL, 16);
-    addr[4] = strtoul(str.substring(9, 11).c_str(), NULL, 16);
-    addr[5] = strtoul(str.substring(11, 13).c_str(), NULL, 16);
-    addr[6] = strtoul(str.substring(13, 15).c_str(), NULL, 16);
-    addr[7] = strtoul(str.substring(15, 17).c_str(), NULL, 16);
+bool parseId(const char *str, uint8_t addr[8]) {
+  uint8_t parsed[8];
+
+  if (str == nullptr) {
+    return false;
+  }
+  // 1-Wire addresses are always 17 chars long, the family code and a dot first.
+  for (uint8_t i = 0, pos = 0; i < 8; i++, pos += 2) {
+    if (i == 1) {
+      if (str[pos++] != '.') return false;
+    }
+    auto high = hexDigit(str[pos]);
+    auto low = high < 0 ? -1 : hexDigit(str[pos + 1]);
+    if (low < 0) return false;
+    parsed[i] = high << 4 | low;
+  }
+  if (str[NODE_ID_LENGTH - 1] != '\0') {
+    return false;
   }
 
+  memcpy(addr, parsed, sizeof(parsed));
+  return true;
+}
+
+/*
+* Convert string to 1-wire byte array address
+* "29.29E1030000009C" -> 29,29,E1,3,0,0,0,9C
+*/
+byte *stringToId(const String &str, byte *addr) {
+  parseId(str.c_str(), addr);
   return addr;
 }
 
+/**
+ * Hash index from the ROM key to the position of the node in a node list, open addressing with
+ * linear probing in a table of at least twice the number of nodes. It has to be rebuilt whenever the list
+ * changes, see indexNodes(). Changing the settings of a node doesn't move it.
+ */
+class NodeIndex {
+ private:
+  enum : uint16_t { EMPTY = 0xFFFF };
+
+  std::vector<uint16_t> slots;
+  uint8_t bits = 0;
+
+  size_t slot(uint64_t key) const {
+    return (key * 0x9E3779B97F4A7C15ULL) >> (64 - bits);  // Fibonacci hashing, the ROM serial bits are spread over the table.
+  }
+
+ public:
+  void rebuild(const std::vector<onewireNode> &nodes) {
+    bits = 3;
+    while ((1U << bits) < nodes.size() * 2) bits++;
+    slots.assign(1U << bits, EMPTY);
+
+    for (uint16_t i = 0; i < nodes.size(); i++) {
+      auto s = slot(nodes[i].rom);
+      while (slots[s] != EMPTY) s = (s + 1) & (slots.size() - 1);
+      slots[s] = i;
+    }
+  }
+
+  /**
+   * @return the node with the ROM key, nullptr if there's none. The index is authoritative, a node added
+   * since the last rebuild isn't found.
+   */
+  onewireNode *find(std::vector<onewireNode> &nodes, uint64_t key) const {
+    if (!bits) {
+      return nullptr;
+    }
+    for (auto s = slot(key); slots[s] != EMPTY; s = (s + 1) & (slots.size() - 1)) {
+      if (slots[s] < nodes.size() && nodes[slots[s]].rom == key) return &nodes[slots[s]];
+    }
+    return nullptr;
+  }
+};
+
+NodeIndex oneWireIndex;
+
+/*
+* Rebuild the index of oneWireNodes, after every change of the list, getOneWireNode() only searches the index.
+* Not while a 1-Wire task may look up a node, see waitUntilOneWireIdle() in main.cpp.
+*/
+void indexNodes() {
+  oneWireIndex.rebuild(oneWireNodes);
+
+  // the 1-Wire tasks only use the family states, they're added here.
+  for (auto &node : oneWireNodes) {
+    if (node.familyId == DS2423) counterState(node);
+    if (node.familyId == DS2450) analogState(node);
+  }
+}
+
 /*
 * Populate the node-struct with information from the byte array (8 bytes long)
 */
 void populateNode(onewireNode& node, const uint8_t addr[8]) {
   // the first ROM byte indicates which chip-family
   node.familyId = addr[0];
-  node.idStr = idToString(addr);
-  for (uint8_t i = 0; i < 8; i++) {
-    node.id[i] = addr[i];
-  }
+  formatId(addr, node.idStr);
+  node.overdrive = deviceFamily(node.familyId).has(FAMILY_OVERDRIVE);
+  memmove(node.id, addr, sizeof(node.id));  // addr may be node.id
 }
 
 onewireNode* getOneWireNode(const uint8_t addr[8]) {
-    auto it = std::find_if (oneWireNodes.begin(), oneWireNodes.end(), [&addr](const onewireNode& n) {
-      return 
-        n.id[0] == addr[0] &&
-        n.id[1] == addr[1] &&
-        n.id[2] == addr[2] &&
-        n.id[3] == addr[3] &&
-        n.id[4] == addr[4] &&
-        n.id[5] == addr[5] &&
-        n.id[6] == addr[6] &&
-        n.id[7] == addr[7];
-    });
-
-    if (it != oneWireNodes.end()) {
-      return it.base();
-    } else {
-      return nullptr;
-    }
+  return oneWireIndex.find(oneWireNodes, romKey(addr));
+}
+
+/*
+* Find a node by its id string, e.g. "28.EEA89B19160262".
+*/
+onewireNode* getOneWireNode(const char *idStr) {
+  uint8_t addr[8];
+  return parseId(idStr, addr) ? getOneWireNode(addr) : nullptr;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,259 @@
+#ifndef OneWireEngine_h
+#define OneWireEngine_h
+
+#include <Arduino.h>
+#include <OneWireMaster.h>
+#include <atomic>
+#include <functional>
+extern "C" {
+	#include "freertos/FreeRTOS.h"
+	#include "freertos/queue.h"
+	#include "freertos/task.h"
+}
+#include "onewire.h"
+#include "tinyowc.h"
+
+#define ONEWIRE_TASK_CORE 0         // run 1-Wire I/O on the other core than loop()
+#define ONEWIRE_TASK_PRIORITY 2     // above loop() (1), the task sleeps while waiting for the bus master
+#define ONEWIRE_TASK_STACK_SIZE 8192
+#define ONEWIRE_QUEUE_LENGTH 256    // enough for one transaction per node and cycle on a large bus
+
+// Largest number of bytes written and read by one transaction, the command and scratchpad of a temperature sensor.
+#define ONEWIRE_TXN_DATA_SIZE 16
+
+// Steps done by a transaction, unless it has a custom operation.
+#define TXN_RESET 0x01   // 1-Wire reset first
+#define TXN_SELECT 0x02  // MATCH ROM on rom, at overdrive speed if the node supports it
+#define TXN_SKIP 0x04    // SKIP ROM
+#define TXN_CRC8 0x08    // last byte read is a CRC8 of the bytes read before it
+#define TXN_CRC16 0x10   // last two bytes read are the inverted CRC16 of all bytes written and read before them
+
+struct OneWireTransaction;
+
+// Custom bus operation, node is nullptr if rom isn't a known node. Return true on success.
+typedef std::function<bool(OneWireMaster &ds, onewireNode *node, OneWireTransaction &txn)> OneWireOperation;
+typedef std::function<void(OneWireTransaction &txn)> OneWireCompletion;
+
+/**
+ * Transaction descriptor, either a reset/select/write/read/CRC sequence or a custom operation.
+ */
+struct OneWireTransaction {
+  uint8_t steps = TXN_RESET | TXN_SELECT;
+  uint8_t rom[8] = {};              // node to select, also used to find the node for the operation and completion.
+  uint8_t data[ONEWIRE_TXN_DATA_SIZE] = {};  // writeLength bytes to write, followed by readLength bytes read.
+  uint8_t writeLength = 0;
+  uint8_t readLength = 0;
+  uint8_t retries = MAX_CONSECUTIVE_RETRIES;
+  OneWireOperation operation;       // replaces the steps above if set, runs on the 1-Wire task.
+  OneWireCompletion onComplete;     // runs on the loop() task from dispatchCompletions().
+
+  // result
+  bool success = false;
+  int64_t result = -1;              // value produced by a custom operation, e.g. a raw temperature.
+  OneWireStatus status = ONEWIRE_OK;
+};
+
+/**
+ * Runs 1-Wire transactions on a dedicated FreeRTOS task, so bus I/O never waits for network
+ * and display work in loop() and the other way around. Completions are delivered back to loop().
+ */
+class OneWireEngine {
+ private:
+  OneWireMaster &ds;
+  QueueHandle_t requests = nullptr;
+  QueueHandle_t completions = nullptr;
+  QueueHandle_t spares = nullptr;  // transactions done with, reused by submit() instead of allocating new ones.
+  TaskHandle_t task = nullptr;
+  std::atomic<uint16_t> pending{0};
+
+  static void taskMain(void *param) {
+    auto engine = static_cast<OneWireEngine *>(param);
+    OneWireTransaction *txn;
+
+    for (;;) {
+      if (xQueueReceive(engine->requests, &txn, portMAX_DELAY) == pdTRUE) {
+        // nodes are only replaced while the engine is idle, see waitUntilIdle(). Bus-wide transactions have no ROM.
+        auto node = romKey(txn->rom) == 0 ? nullptr : getOneWireNode(txn->rom);
+        txn->success = engine->execute(*txn, node);
+        txn->status = engine->ds.getStatus();
+
+        xQueueSend(engine->completions, &txn, portMAX_DELAY);
+        engine->pending--;
+      }
+    }
+  }
+
+  bool execute(OneWireTransaction &txn, onewireNode *node) {
+    if (txn.operation) {
+      return txn.operation(ds, node, txn);
+    }
+
+    uint8_t length = txn.writeLength + txn.readLength;
+    if (length > ONEWIRE_TXN_DATA_SIZE) {
+      ESP_LOGW(TAG, "1-Wire transaction too long: %d bytes.", length);
+      return false;
+    }
+
+    for (uint8_t attempt = 0; attempt <= txn.retries; attempt++) {
+      if ((txn.steps & TXN_RESET) && !ds.reset()) {
+        // retrying won't help if nothing answers or the bus is shorted.
+        if (ds.getStatus() == ONEWIRE_NO_PRESENCE || ds.getStatus() == ONEWIRE_SHORTED) break;
+        continue;
+      }
+
+      if (txn.steps & TXN_SELECT) {
+        if (node != nullptr) {
+          selectNode(ds, *node);
+        } else {
+          ds.select(txn.rom);
+        }
+      } else if (txn.steps & TXN_SKIP) {
+        ds.skip();
+      }
+
+      uint8_t buf[ONEWIRE_TXN_DATA_SIZE];
+      memcpy(buf, txn.data, txn.writeLength);
+      memset(buf + txn.writeLength, 0xFF, txn.readLength);
+
+      if (ds.block(buf, length) && verify(txn, buf, length)) {
+        memcpy(txn.data + txn.writeLength, buf + txn.writeLength, txn.readLength);
+        if (node != nullptr) node->success++;
+        return true;
+      }
+
+      if (node != nullptr) node->errors++;
+    }
+
+    return false;
+  }
+
+  // A cleared transaction from the spares, a new one only if there's none left.
+  OneWireTransaction *acquire() {
+    OneWireTransaction *txn;
+
+    if (spares != nullptr && xQueueReceive(spares, &txn, 0) == pdTRUE) {
+      return txn;
+    }
+    return new OneWireTransaction();
+  }
+
+  // Give a transaction back to the spares, cleared for the next submit().
+  void release(OneWireTransaction *txn) {
+    *txn = OneWireTransaction();
+
+    if (spares == nullptr || xQueueSend(spares, &txn, 0) != pdTRUE) {
+      delete txn;
+    }
+  }
+
+  static bool verify(const OneWireTransaction &txn, const uint8_t *buf, uint8_t length) {
+    if ((txn.steps & TXN_CRC8) && txn.readLength > 0) {
+      return OneWireMaster::crc8(buf + txn.writeLength, txn.readLength - 1) == buf[length - 1];
+    }
+    if ((txn.steps & TXN_CRC16) && length > 2) {
+      return OneWireMaster::check_crc16(buf, length - 2, buf + length - 2);
+    }
+    return true;
+  }
+
+ public:
+  OneWireEngine(OneWireMaster &ds) : ds(ds) {}
+
+  // Start the 1-Wire task, no bus I/O should be done outside the engine after this.
+  void begin() {
+    requests = xQueueCreate(ONEWIRE_QUEUE_LENGTH, sizeof(OneWireTransaction *));
+    completions = xQueueCreate(ONEWIRE_QUEUE_LENGTH, sizeof(OneWireTransaction *));
+    spares = xQueueCreate(ONEWIRE_QUEUE_LENGTH, sizeof(OneWireTransaction *));
+    xTaskCreatePinnedToCore(taskMain, "onewire", ONEWIRE_TASK_STACK_SIZE, this, ONEWIRE_TASK_PRIORITY, &task, ONEWIRE_TASK_CORE);
+  }
+
+  /**
+   * Allocate spare transactions up to count, the most a sampling cycle queues on the bus. Call this
+   * when the nodes are known, after that a cycle reuses them and doesn't allocate.
+   */
+  void reserve(uint16_t count) {
+    if (spares == nullptr) {
+      return;
+    }
+
+    for (auto spare = uxQueueMessagesWaiting(spares); spare < count && spare < ONEWIRE_QUEUE_LENGTH; spare++) {
+      auto txn = new OneWireTransaction();
+      xQueueSend(spares, &txn, 0);
+    }
+  }
+
+  /**
+   * Queue a transaction, the engine takes ownership of txn.
+   * @param urgent put the transaction first in the queue, e.g. actuator writes.
+   * @return false if the queue is full, txn is then given back to the spares.
+   */
+  bool submit(OneWireTransaction *txn, bool urgent = false) {
+    pending++;
+    auto queued = urgent ? xQueueSendToFront(requests, &txn, 0) : xQueueSend(requests, &txn, 0);
+
+    if (queued != pdTRUE) {
+      pending--;
+      ESP_LOGW(TAG, "1-Wire queue is full, transaction dropped.");
+      release(txn);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Queue a reset/select/write/read sequence for the node with the given rom, see TXN_RESET and on. The bytes read
+   * follow the writeLength bytes of data in txn.data when onComplete runs.
+   * @return false if the queue is full or the transaction doesn't fit in ONEWIRE_TXN_DATA_SIZE.
+   */
+  bool submit(const uint8_t rom[8], uint8_t steps, const uint8_t *data, uint8_t writeLength, uint8_t readLength,
+              OneWireCompletion onComplete = nullptr, bool urgent = false) {
+    if (writeLength + readLength > ONEWIRE_TXN_DATA_SIZE) {
+      ESP_LOGW(TAG, "1-Wire transaction too long: %d bytes.", writeLength + readLength);
+      return false;
+    }
+
+    auto txn = acquire();
+    memcpy(txn->rom, rom, 8);
+    txn->steps = steps;
+    memcpy(txn->data, data, writeLength);
+    txn->writeLength = writeLength;
+    txn->readLength = readLength;
+    txn->onComplete = onComplete;
+    return submit(txn, urgent);
+  }
+
+  // Queue a custom operation for the node with the given rom (may be nullptr).
+  bool submit(const uint8_t *rom, OneWireOperation operation, OneWireCompletion onComplete = nullptr, bool urgent = false) {
+    auto txn = acquire();
+    if (rom != nullptr) memcpy(txn->rom, rom, 8);
+    txn->operation = operation;
+    txn->onComplete = onComplete;
+    return submit(txn, urgent);
+  }
+
+  // Deliver completed transactions to their onComplete callback, call this from loop().
+  void dispatchCompletions() {
+    OneWireTransaction *txn;
+
+    while (completions != nullptr && xQueueReceive(completions, &txn, 0) == pdTRUE) {
+      if (txn->onComplete) {
+        txn->onComplete(*txn);
+      }
+      release(txn);
+    }
+  }
+
+  // No transaction queued or running.
+  bool isIdle() const { return pending == 0; }
+
+  // Block until all queued transactions has been executed, e.g. before replacing oneWireNodes. The completions are
+  // delivered meanwhile, the task waits for room in their queue before it's idle.
+  void waitUntilIdle() {
+    while (!isIdle()) {
+      dispatchCompletions();
+      vTaskDelay(1);
+    }
+  }
+};
+
+#endif
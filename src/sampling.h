@@ -0,0 +1,209 @@
+#ifndef Sampling_h
+#define Sampling_h
+
+#include <Arduino.h>
+#include "actuators.h"
+#include "ds18x20.h"
+#include "ds2423.h"
+#include "ds2450.h"
+#include "onewire.h"
+#include "onewireengine.h"
+#include "switches.h"
+#include "tinyowc.h"
+
+#define FORCE_MQTT_PUSH 60000       // if still nothing has changed after this many milliseconds, we force a push to show that we are alive.
+#define TEMPERATURE_HYSTERESIS 0.5  // degrees celsius.
+#define TELEMETRY_CYCLES 4          // with "-DTINYOWC_ALARM_SAMPLING", sensors within their limits are only read every 4th sample cycle.
+
+// Push the state of a node to MQTT and InfluxDB, defined by main.cpp. Sets onewireNode::millisWhenLastPush.
+extern void pushChanges(onewireNode &node);
+
+unsigned long epochTime;                // time of the current loop(), see getTime().
+uint16_t cycleHeatRequirement = 0;      // heat requirement summed up during the current sample cycle.
+long numberOfSamplesSinceReboot = 0;
+
+// The engine and the actuator manager of each bus, indexed by onewireNode::bus, see beginSampling().
+OneWireEngine *sampleEngines = nullptr;
+ActuatorManager *sampleActuators = nullptr;
+uint8_t sampleBusCount = 0;
+
+// Sample the nodes on the buses of engines, with their actuators. Both arrays have busCount entries.
+void beginSampling(OneWireEngine *engines, ActuatorManager *actuators, uint8_t busCount) {
+  sampleEngines = engines;
+  sampleActuators = actuators;
+  sampleBusCount = busCount;
+}
+
+/**
+ * @brief Plan the state of a actuator pin, the boards are written once at the end of the sampling cycle.
+ *
+ * @param actuatorId
+ * @param actuatorPin
+ * @param pinState
+ * @return true pin state was planned
+ * @return false actuator was not found, or no actuatorPin was specified.
+ */
+bool planActuator(uint8_t actuatorId[8], int8_t actuatorPin, bool pinState) {
+  if (actuatorPin < 0) {
+    return false;
+  }
+
+  auto actuator = getOneWireNode(actuatorId);
+  if (actuator == nullptr) {
+    return false;
+  }
+
+  return sampleActuators[actuator->bus].planPin(actuator->id, actuatorPin, pinState);
+}
+
+// Handle a actuator write or read-back done by the 1-Wire task, the state is pushed if the board was changed.
+void onActuatorWritten(OneWireTransaction &txn) {
+  auto actuatorNode = getOneWireNode(txn.rom);
+
+  if (txn.success && txn.result > 0 && actuatorNode != nullptr) {
+    actuatorNode->lastOperation = epochTime;
+    pushChanges(*actuatorNode);
+  }
+}
+
+// Write the actuator pin states planned during the cycle, at most one write per switch.
+void flushActuators() {
+  for (uint8_t bus = 0; bus < sampleBusCount; bus++) {
+    sampleActuators[bus].flush(oneWireNodes, onActuatorWritten);
+  }
+}
+
+// Handle a scratchpad read by the 1-Wire task, the command byte is followed by the scratchpad.
+void onTemperatureRead(OneWireTransaction &txn) {
+  auto currentMillis = millis();
+  auto node = getOneWireNode(txn.rom);
+
+  if (node == nullptr) {
+    return;
+  }
+  int16_t reading = txn.success ? scratchpadToRaw(node->familyId, txn.data + 1, &node->resolution) : UNSET_TEMPERATURE;
+
+  if (reading != UNSET_TEMPERATURE) {
+    node->failedReadingsInRow = 0;
+    node->lastOperation = epochTime;
+    auto temperature = rawToCelsius(reading);
+
+    // Add this sensors need of more warm water to total sum of requirement for this device.
+    if (node->lowLimit > UNSET_TEMPERATURE && temperature < node->lowLimit) {
+      cycleHeatRequirement += abs(temperature - node->lowLimit);
+    }
+
+    // filter some noise by only including changes larger than 0.5 degrees.
+    ESP_LOGD(TAG, "Temp reading: raw %d, temp %.2f, last %.2f", reading, temperature, node->lastTemperature);
+
+    // Only record changes if temperature are greater or equal to hysteresis, we don't want too frequent changes.
+    // 85 we don't need to measure this high temperatures, 85 is also the power-on temperature of the sensor.
+    if (abs(temperature - node->temperature) >= TEMPERATURE_HYSTERESIS && temperature < 85.0) {
+      node->lastTemperature = node->temperature == UNSET_TEMPERATURE ? temperature : node->temperature;
+      node->temperature = temperature;
+      // If sensor is set to automatic control and has lowlimit and highlimit values, then set control pin output according to temperature.
+      if (node->stateOverride == 'A' && node->lowLimit > UNSET_TEMPERATURE && node->highLimit > UNSET_TEMPERATURE) {
+        // temperature is outside boundary, compensate by signaling control pin of shunt.
+        if (node->temperature < node->lowLimit || node->temperature > node->highLimit) {
+          planActuator(node->actuatorId, node->actuatorPin, shouldActuatorBeActive(*node));
+        }
+      }
+
+      pushChanges(*node);
+    }
+  } else {
+    node->failedReadingsInRow++;
+  }
+  // make a force push even if nothing has changed, if changes are too infrequent.
+  if (reading != UNSET_TEMPERATURE && node->millisWhenLastPush + FORCE_MQTT_PUSH < currentMillis) {
+    pushChanges(*node);
+  }
+}
+
+// Handle counters read by the 1-Wire task, the counts are in txn.data and the time of the read in txn.result.
+void onCountersRead(OneWireTransaction &txn) {
+  auto node = getOneWireNode(txn.rom);
+
+  if (node == nullptr) {
+    return;
+  }
+
+  node->lastOperation = epochTime;
+
+  if (txn.success) {
+    uint32_t counts[2];
+    memcpy(counts, txn.data, sizeof(counts));
+    updateCounters(*node, counts, txn.result);
+    pushChanges(*node);
+  }
+}
+
+// Handle a DS2450 converted and read by the 1-Wire task.
+void onVoltagesRead(OneWireTransaction &txn) {
+  auto node = getOneWireNode(txn.rom);
+
+  if (node == nullptr) {
+    return;
+  }
+
+  node->lastOperation = epochTime;
+
+  if (txn.success) {
+    pushChanges(*node);
+  }
+}
+
+// Reading of the families in a sampling cycle, see FamilyHooks::sample in main.cpp. The temperature
+// sensors have been converted by then.
+
+void sampleTemperature(onewireNode &node, unsigned long currentMillis) {
+  // a forced ('1'/'0') actuator pin is set by flushActuators() at the end of the cycle.
+
+#ifdef TINYOWC_ALARM_SAMPLING
+  // within its limits the sensor is only read for telemetry.
+  if (node.alarmLimits && !node.alarming && numberOfSamplesSinceReboot % TELEMETRY_CYCLES != 0) {
+    return;
+  }
+#endif
+
+  // READ SCRATCHPAD, the CRC is checked and a failed read is retried by the engine.
+  static const uint8_t readCommand[] = {READ_SCRATCHPAD};
+  sampleEngines[node.bus].submit(node.id, TXN_RESET | TXN_SELECT | TXN_CRC8, readCommand, sizeof(readCommand), 9, onTemperatureRead);
+}
+
+void sampleSwitch(onewireNode &node, unsigned long currentMillis) {
+  // the outputs are read back and corrected, a DS2408 only when it answered the conditional
+  // search (see findActiveBoards()) and a DS2405 never, see reconcileActuator().
+  if (node.familyId != DS2405) {
+    sampleEngines[node.bus].submit(node.id, [](OneWireMaster &ds, onewireNode *node, OneWireTransaction &txn) {
+      if (node == nullptr) return false;
+      txn.result = reconcileActuator(ds, *node);
+      return txn.result >= 0;
+    }, onActuatorWritten);
+  }
+
+  // a changed pin state is pushed when it's written or corrected, see onActuatorWritten().
+  if (node.millisWhenLastPush + FORCE_MQTT_PUSH < currentMillis) {
+    pushChanges(node);
+  }
+}
+
+void sampleCounter(onewireNode &node, unsigned long currentMillis) {
+  // only read on the 1-Wire task, the totals and rates are updated on loop() where they're published.
+  sampleEngines[node.bus].submit(node.id, [](OneWireMaster &ds, onewireNode *node, OneWireTransaction &txn) {
+    uint32_t counts[2];
+    if (node == nullptr || !readCounters(ds, *node, counts)) return false;
+    txn.result = esp_timer_get_time();
+    memcpy(txn.data, counts, sizeof(counts));
+    return true;
+  }, onCountersRead);
+}
+
+void sampleVoltages(onewireNode &node, unsigned long currentMillis) {
+  sampleEngines[node.bus].submit(node.id, [](OneWireMaster &ds, onewireNode *node, OneWireTransaction &) {
+    if (node == nullptr) return false;
+    return sampleDS2450(ds, *node);
+  }, onVoltagesRead);
+}
+
+#endif
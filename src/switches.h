@@ -0,0 +1,80 @@
+#ifndef Switches_h
+#define Switches_h
+
+#include <OneWireMaster.h>
+#include "onewire.h"
+#include "ds2405.h"
+#include "ds2406.h"
+#include "ds2408.h"
+#include "ds2413.h"
+#include "tinyowc.h"
+
+/**
+ * Number of output channels of an addressable switch, 0 if the family isn't a switch.
+ */
+uint8_t switchChannels(uint8_t familyId) {
+  auto &family = deviceFamily(familyId);
+  return family.has(FAMILY_SWITCH) ? family.channels : 0;
+}
+
+/**
+ * Set the outputs of any addressable switch, bit n of state is channel n and 1 means on.
+ * @return false if the switch couldn't be written.
+ */
+bool setActuator(OneWireMaster &ds, onewireNode &node, uint8_t state) {
+  switch (node.familyId) {
+    case DS2408:
+      return setState(ds, node, ~state) >= 0;  // invert, low means On (reversed logic)
+    case DS2413:
+      return setDS2413State(ds, node, ~state) >= 0;
+    case DS2406:
+      return setDS2406State(ds, node, ~state);
+    case DS2405:
+      return setDS2405State(ds, node, state & 0x01);
+    default:
+      ESP_LOGW(TAG, "Device %s is not a switch!", node.idStr);
+      return false;
+  }
+}
+
+/**
+ * Read the output latches of the switch back and write them again if they differ from pinStates.
+ * A DS2408 is only read when it answered the conditional search, see reconcileState(). The output of a
+ * DS2405 can't be read without toggling it, so it's left as it is.
+ * @return 1 if the outputs had to be written again, 0 if they were as expected, -1 if the switch couldn't be read or corrected.
+ */
+int8_t reconcileActuator(OneWireMaster &ds, onewireNode &node) {
+  int16_t latch;
+
+  switch (node.familyId) {
+    case DS2408:
+      return node.alarming ? reconcileState(ds, node) : 0;
+    case DS2413:
+      latch = readDS2413(ds, node);
+      if (latch >= 0) latch = ds2413Latch(latch);
+      break;
+    case DS2406:
+      latch = readDS2406(ds, node);
+      if (latch >= 0) latch = ds2406Latch(latch);
+      break;
+    default:
+      return 0;
+  }
+
+  if (latch < 0) {
+    return -1;
+  }
+
+  uint8_t state = node.pinStates & 0x03;
+  if ((uint8_t)(~latch & 0x03) == state) {
+    return 0;
+  }
+
+  char outputs[8 + 1], wanted[8 + 1];
+  formatPinStates(~latch & 0x03, outputs);
+  formatPinStates(state, wanted);
+  ESP_LOGW(TAG, "%s %s outputs %s differ from the actuator state %s, writing them again.", deviceFamily(node.familyId).name, node.idStr, outputs, wanted);
+  return setActuator(ds, node, state) ? 1 : -1;
+}
+
+#endif
@@ -0,0 +1,120 @@
+#define TINYOWC_BENCHMARK
+#include <DS2480B.h>
+#include <DS2484.h>
+#include <SimDevices.h>
+#include <unity.h>
+#include "benchmark.h"
+
+// Bus benchmarks (src/benchmark.h) on simulated buses of different sizes. Results are printed
+// as JSON lines, run with "platformio test -e native -f test_benchmark -v" to see them.
+// The DS2480B runs at 115200 baud, the DS2484 at 400 kHz I2C.
+
+static SimBus *bus;
+static SimDS2480B *sim;
+static SimDS2484 *simI2C;
+static OneWireMaster *ds;
+static std::vector<SimDevice *> devices;
+static std::vector<onewireNode> nodes;
+
+// Mostly DS18B20 sensors, every tenth device is a DS2408 and every tenth a DS2423.
+static void populateBus(uint16_t count) {
+  for (uint16_t i = 0; i < count; i++) {
+    uint8_t rom[8];
+    SimDevice *device;
+
+    if (i % 10 == 1) {
+      SimDevice::makeRom(DS2408, i, rom);
+      device = new SimDS2408(rom);
+    } else if (i % 10 == 2) {
+      SimDevice::makeRom(DS2423, i, rom);
+      device = new SimDS2423(rom);
+    } else {
+      SimDevice::makeRom(i % 20 == 3 ? DS18S20 : DS18B20, i, rom);
+      device = new SimDS18x20(rom);
+      static_cast<SimDS18x20 *>(device)->setTemperature(20 + i % 7);
+    }
+
+    devices.push_back(device);
+    bus->attach(device);
+
+    onewireNode node;
+    populateNode(node, rom);
+    nodes.push_back(node);
+  }
+}
+
+void setUp(void) {
+  native::clock() = 0;
+  bus = new SimBus();
+  sim = new SimDS2480B(*bus);
+  simI2C = new SimDS2484(*bus);
+  simI2C->setClock(400000);
+
+  auto master = new DS2480B(*sim);
+  master->begin();
+  master->negotiateBaudRate();
+  ds = master;
+}
+
+void tearDown(void) {
+  delete ds;
+  delete sim;
+  delete simI2C;
+  delete bus;
+  for (auto device : devices) delete device;
+  devices.clear();
+  nodes.clear();
+}
+
+static void benchmark(uint16_t count) {
+  populateBus(count);
+
+  benchmarkSearch(*ds);
+  benchmarkBus(*ds, nodes);
+
+  for (auto &node : nodes) {
+    TEST_ASSERT_EQUAL_UINT32(0, node.errors);
+  }
+}
+
+void test_benchmark_1_device(void) { benchmark(1); }
+void test_benchmark_10_devices(void) { benchmark(10); }
+void test_benchmark_50_devices(void) { benchmark(50); }
+void test_benchmark_100_devices(void) { benchmark(100); }
+void test_benchmark_200_devices(void) { benchmark(200); }
+
+static void benchmarkDS2484(uint16_t count) {
+  delete ds;
+  auto master = new DS2484(*simI2C);
+  master->begin();
+  ds = master;
+  benchmark(count);
+}
+
+void test_benchmark_ds2484_1_device(void) { benchmarkDS2484(1); }
+void test_benchmark_ds2484_10_devices(void) { benchmarkDS2484(10); }
+void test_benchmark_ds2484_100_devices(void) { benchmarkDS2484(100); }
+
+void test_percentiles(void) {
+  BenchmarkResult result;
+  for (uint32_t i = 100; i > 0; i--) result.add(i);
+
+  TEST_ASSERT_EQUAL_UINT16(BENCHMARK_ITERATIONS, result.count);
+  TEST_ASSERT_EQUAL_UINT32(75, result.percentile(50));
+  TEST_ASSERT_EQUAL_UINT32(100, result.percentile(99));
+  TEST_ASSERT_EQUAL_UINT32(51, result.samples[0]);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_percentiles);
+  RUN_TEST(test_benchmark_1_device);
+  RUN_TEST(test_benchmark_10_devices);
+  RUN_TEST(test_benchmark_50_devices);
+  RUN_TEST(test_benchmark_100_devices);
+  RUN_TEST(test_benchmark_200_devices);
+  RUN_TEST(test_benchmark_ds2484_1_device);
+  RUN_TEST(test_benchmark_ds2484_10_devices);
+  RUN_TEST(test_benchmark_ds2484_100_devices);
+  return UNITY_END();
+}
@@ -0,0 +1,79 @@
+#include <unity.h>
+#include "counters.h"
+
+// Totals and rates of DS2423 counters (src/counters.h), times in microseconds.
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_first_read(void) {
+  PulseCounter counter;
+  counter.update(1000, 0);
+
+  TEST_ASSERT_TRUE(counter.valid);
+  TEST_ASSERT_EQUAL(1000, counter.total);
+  TEST_ASSERT_EQUAL_UINT32(1000, counter.last);
+  TEST_ASSERT_TRUE(counter.rate == 0);
+}
+
+void test_rate(void) {
+  PulseCounter counter;
+  counter.update(1000, 0);
+  counter.update(1030, 15000000);
+
+  TEST_ASSERT_EQUAL(1030, counter.total);
+  TEST_ASSERT_TRUE(counter.rate == 2);
+  TEST_ASSERT_TRUE(counter.averageRate == 2);
+}
+
+void test_wraparound(void) {
+  PulseCounter counter;
+  counter.update(0xFFFFFFF0, 0);
+  counter.update(0x10, 1000000);
+
+  TEST_ASSERT_EQUAL(0x100000010LL, counter.total);
+  TEST_ASSERT_TRUE(counter.rate == 32);
+}
+
+void test_moving_window(void) {
+  PulseCounter counter;
+  uint32_t value = 0;
+
+  // 10 pulses/s for a window, then 1 pulse/s.
+  for (uint8_t i = 0; i < COUNTER_WINDOW; i++) {
+    counter.update(value, i * 1000000LL);
+    value += 10;
+  }
+  TEST_ASSERT_TRUE(counter.averageRate == 10);
+
+  value -= 9;
+  counter.update(value, COUNTER_WINDOW * 1000000LL);
+  TEST_ASSERT_TRUE(counter.rate == 1);
+  // the window is now 6 seconds at 10 and one at 1 pulse/s.
+  TEST_ASSERT_TRUE(counter.averageRate == 61 / 7.0f);
+}
+
+void test_restore(void) {
+  PulseCounter counter;
+  counter.restore(0x500000000LL, 100);
+  TEST_ASSERT_TRUE(counter.valid);
+
+  // pulses counted while rebooting are added, the rate starts over.
+  counter.update(150, 0);
+  TEST_ASSERT_EQUAL(0x500000032LL, counter.total);
+  TEST_ASSERT_TRUE(counter.rate == 0);
+
+  counter.update(160, 5000000);
+  TEST_ASSERT_TRUE(counter.rate == 2);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_read);
+  RUN_TEST(test_rate);
+  RUN_TEST(test_wraparound);
+  RUN_TEST(test_moving_window);
+  RUN_TEST(test_restore);
+  return UNITY_END();
+}
@@ -0,0 +1,222 @@
+#include <SimDevices.h>
+#include <unity.h>
+#include <DS2480B.h>
+#include <random>
+
+// Compile time CRC tables (lib/DS2480B/src/OneWireCRC.h) against the implementations they
+// replaced, and CRC verification during DS2480B::block().
+
+// The Dallas lookup table and the bitwise CRC16 DS2480B.cpp used before.
+static const uint8_t dscrc_table[] = {
+    0,   94,  188, 226, 97,  63,  221, 131, 194, 156, 126, 32,  163, 253, 31,
+    65,  157, 195, 33,  127, 252, 162, 64,  30,  95,  1,   227, 189, 62,  96,
+    130, 220, 35,  125, 159, 193, 66,  28,  254, 160, 225, 191, 93,  3,   128,
+    222, 60,  98,  190, 224, 2,   92,  223, 129, 99,  61,  124, 34,  192, 158,
+    29,  67,  161, 255, 70,  24,  250, 164, 39,  121, 155, 197, 132, 218, 56,
+    102, 229, 187, 89,  7,   219, 133, 103, 57,  186, 228, 6,   88,  25,  71,
+    165, 251, 120, 38,  196, 154, 101, 59,  217, 135, 4,   90,  184, 230, 167,
+    249, 27,  69,  198, 152, 122, 36,  248, 166, 68,  26,  153, 199, 37,  123,
+    58,  100, 134, 216, 91,  5,   231, 185, 140, 210, 48,  110, 237, 179, 81,
+    15,  78,  16,  242, 172, 47,  113, 147, 205, 17,  79,  173, 243, 112, 46,
+    204, 146, 211, 141, 111, 49,  178, 236, 14,  80,  175, 241, 19,  77,  206,
+    144, 114, 44,  109, 51,  209, 143, 12,  82,  176, 238, 50,  108, 142, 208,
+    83,  13,  239, 177, 240, 174, 76,  18,  145, 207, 45,  115, 202, 148, 118,
+    40,  171, 245, 23,  73,  8,   86,  180, 234, 105, 55,  213, 139, 87,  9,
+    235, 181, 54,  104, 138, 212, 149, 203, 41,  119, 244, 170, 72,  22,  233,
+    183, 85,  11,  136, 214, 52,  106, 43,  117, 151, 201, 74,  20,  246, 168,
+    116, 42,  200, 150, 21,  75,  169, 247, 182, 232, 10,  84,  215, 137, 107,
+    53};
+
+static uint8_t legacyCrc8(const uint8_t *addr, uint8_t len) {
+  uint8_t crc = 0;
+  while (len--) crc = dscrc_table[crc ^ *addr++];
+  return crc;
+}
+
+static uint16_t legacyCrc16(const uint8_t *input, uint16_t len, uint16_t crc) {
+  static const uint8_t oddparity[16] = {0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0};
+
+  for (uint16_t i = 0; i < len; i++) {
+    uint16_t cdata = input[i];
+    cdata = (cdata ^ crc) & 0xff;
+    crc >>= 8;
+
+    if (oddparity[cdata & 0x0F] ^ oddparity[cdata >> 4]) crc ^= 0xC001;
+
+    cdata <<= 6;
+    crc ^= cdata;
+    cdata <<= 1;
+    crc ^= cdata;
+  }
+  return crc;
+}
+
+static std::mt19937 rng(27);
+
+static void randomBytes(uint8_t *buf, uint16_t len) {
+  for (uint16_t i = 0; i < len; i++) buf[i] = rng();
+}
+
+// Append the CRC16 inverted and LSB first, as the devices send it.
+static void appendCrc16(uint8_t *buf, uint16_t len) {
+  uint16_t crc = ~DS2480B::crc16(buf, len);
+  buf[len] = crc & 0xFF;
+  buf[len + 1] = crc >> 8;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_crc8_matches_legacy(void) {
+  uint8_t buf[64];
+
+  for (uint16_t i = 0; i < 256; i++) {
+    uint8_t value = i;
+    TEST_ASSERT_EQUAL_HEX8(dscrc_table[i], DS2480B::crc8(&value, 1));
+  }
+
+  for (uint16_t i = 0; i < 1000; i++) {
+    uint8_t len = rng() % sizeof(buf);
+    randomBytes(buf, len);
+    TEST_ASSERT_EQUAL_HEX8(legacyCrc8(buf, len), DS2480B::crc8(buf, len));
+  }
+}
+
+void test_crc16_matches_legacy(void) {
+  uint8_t buf[128];
+
+  for (uint16_t i = 0; i < 1000; i++) {
+    uint16_t len = rng() % sizeof(buf);
+    uint16_t seed = i % 2 ? rng() : 0;
+    randomBytes(buf, len);
+    TEST_ASSERT_EQUAL_HEX16(legacyCrc16(buf, len, seed), DS2480B::crc16(buf, len, seed));
+  }
+}
+
+void test_incremental_update(void) {
+  uint8_t buf[100];
+  randomBytes(buf, sizeof(buf));
+
+  OneWireCRC8 crc8;
+  OneWireCRC16 crc16;
+  crc8.update(buf, 37);
+  crc16.update(buf, 37);
+  for (uint8_t i = 37; i < sizeof(buf); i++) {
+    crc8.update(buf[i]);
+    crc16.update(buf[i]);
+  }
+
+  TEST_ASSERT_EQUAL_HEX8(DS2480B::crc8(buf, sizeof(buf)), crc8.value());
+  TEST_ASSERT_EQUAL_HEX16(DS2480B::crc16(buf, sizeof(buf)), crc16.value());
+}
+
+void test_residues(void) {
+  uint8_t rom[8];
+  SimDevice::makeRom(0x28, 0x123456, rom);
+  OneWireCRC8 crc8;
+  crc8.update(rom, sizeof(rom));
+  TEST_ASSERT_TRUE(crc8.isValid());
+
+  uint8_t page[34];
+  randomBytes(page, 32);
+  appendCrc16(page, 32);
+  OneWireCRC16 crc16;
+  crc16.update(page, sizeof(page));
+  TEST_ASSERT_TRUE(crc16.isValid());
+  TEST_ASSERT_TRUE(DS2480B::check_crc16(page, 32, page + 32));
+}
+
+void test_crc8_verifier(void) {
+  uint8_t buf[10 + 9];
+  randomBytes(buf, 10 + 8);
+  buf[18] = DS2480B::crc8(buf + 10, 8);
+
+  CRC8Verifier good(10, 8);
+  bool valid = true;
+  for (uint8_t value : buf) valid = good.received(value) && valid;
+  TEST_ASSERT_TRUE(valid);
+
+  buf[12] ^= 0x10;
+  CRC8Verifier bad(10, 8);
+  valid = true;
+  for (uint8_t value : buf) valid = bad.received(value) && valid;
+  TEST_ASSERT_FALSE(valid);
+
+  // the skipped bytes aren't checked.
+  buf[12] ^= 0x10;
+  buf[3] ^= 0x01;
+  CRC8Verifier skipped(10, 8);
+  valid = true;
+  for (uint8_t value : buf) valid = skipped.received(value) && valid;
+  TEST_ASSERT_TRUE(valid);
+}
+
+void test_crc16_verifier_segments(void) {
+  // 3 skipped bytes, a 10 byte segment and two 6 byte segments, each followed by its CRC16.
+  uint8_t buf[3 + 12 + 8 + 8];
+  randomBytes(buf, sizeof(buf));
+  appendCrc16(buf + 3, 10);
+  appendCrc16(buf + 15, 6);
+  appendCrc16(buf + 23, 6);
+
+  CRC16Verifier good(3, 10, 6);
+  for (uint8_t value : buf) TEST_ASSERT_TRUE(good.received(value));
+
+  // corrupt the second segment, the check fails on its last CRC byte.
+  buf[17] ^= 0x80;
+  CRC16Verifier bad(3, 10, 6);
+  for (uint16_t i = 0; i < sizeof(buf); i++) {
+    TEST_ASSERT_EQUAL(i != 22, bad.received(buf[i]));
+  }
+}
+
+void test_block_aborts_after_failed_chunk(void) {
+  native::clock() = 0;
+  SimBus bus;
+  SimDS2480B sim(bus);
+  DS2480B ds(sim);
+  uint8_t rom[8];
+  SimDevice::makeRom(DS2423, 1, rom);
+  SimDS2423 counter(rom);
+  bus.attach(&counter);
+  ds.begin();
+  ds.negotiateBaudRate();
+
+  // MATCH ROM, READ MEMORY + COUNTER of pages 14 and 15, 9 + 3 + 2 * 42 bytes.
+  uint8_t buf[96];
+  auto prepare = [&]() {
+    memset(buf, 0xFF, sizeof(buf));
+    buf[0] = MATCH_ROM;
+    memcpy(buf + 1, rom, 8);
+    buf[9] = 0xA5;
+    buf[10] = 0xC0;
+    buf[11] = 0x01;
+    ds.reset();
+    ds.resetStats();
+  };
+
+  prepare();
+  CRC16Verifier good(9, 43, 40);
+  TEST_ASSERT_TRUE(ds.block(buf, sizeof(buf), &good));
+  TEST_ASSERT_EQUAL_UINT32(sizeof(buf), ds.getStats().bytesReceived);
+
+  prepare();
+  sim.corruptNext(1);
+  CRC16Verifier bad(9, 43, 40);
+  TEST_ASSERT_FALSE(ds.block(buf, sizeof(buf), &bad));
+  TEST_ASSERT_EQUAL(ONEWIRE_CRC_ERROR, ds.getStatus());
+  // the second chunk was never sent.
+  TEST_ASSERT_EQUAL_UINT32(DS2480B_BLOCK_SIZE, ds.getStats().bytesReceived);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc8_matches_legacy);
+  RUN_TEST(test_crc16_matches_legacy);
+  RUN_TEST(test_incremental_update);
+  RUN_TEST(test_residues);
+  RUN_TEST(test_crc8_verifier);
+  RUN_TEST(test_crc16_verifier_segments);
+  RUN_TEST(test_block_aborts_after_failed_chunk);
+  return UNITY_END();
+}
@@ -0,0 +1,738 @@
+#include <DS2480B.h>
+#include <DS2484.h>
+#include <SimDevices.h>
+#include <unity.h>
+#include "ds18x20.h"
+#include "ds2408.h"
+#include "ds2423.h"
+#include "ds2450.h"
+#include "onewire.h"
+#include "switches.h"
+
+// Device drivers in src/ against simulated devices, with each of the bus masters.
+
+static SimBus *bus;
+static SimDS2480B *sim;
+static SimDS2484 *simI2C;
+static OneWireMaster *ds;
+static std::vector<SimDevice *> devices;
+static bool useDS2484 = false;
+
+// Flip a bit in the next count bytes read from the bus.
+static void corruptNext(uint32_t count) {
+  if (useDS2484) {
+    simI2C->corruptNext(count);
+  } else {
+    sim->corruptNext(count);
+  }
+}
+
+template <typename T>
+static T *addDevice(uint8_t family, uint64_t serial, onewireNode &node) {
+  uint8_t rom[8];
+  SimDevice::makeRom(family, serial, rom);
+  auto device = new T(rom);
+  devices.push_back(device);
+  bus->attach(device);
+  populateNode(node, rom);
+  return device;
+}
+
+void setUp(void) {
+  native::clock() = 0;
+  bus = new SimBus();
+  sim = new SimDS2480B(*bus);
+  simI2C = new SimDS2484(*bus);
+
+  if (useDS2484) {
+    simI2C->setClock(400000);
+    auto master = new DS2484(*simI2C);
+    master->begin();
+    ds = master;
+  } else {
+    auto master = new DS2480B(*sim);
+    master->begin();
+    master->negotiateBaudRate();
+    ds = master;
+  }
+}
+
+void tearDown(void) {
+  delete ds;
+  delete sim;
+  delete simI2C;
+  delete bus;
+  for (auto device : devices) delete device;
+  devices.clear();
+  oneWireNodes.clear();
+  indexNodes();
+  counterStates.clear();
+  analogStates.clear();
+}
+
+void test_device_families(void) {
+  onewireNode sensor, board, unknown;
+  uint8_t rom[8];
+  SimDevice::makeRom(DS18B20, 1, rom);
+  populateNode(sensor, rom);
+  SimDevice::makeRom(DS2408, 2, rom);
+  populateNode(board, rom);
+  SimDevice::makeRom(0x01, 3, rom);
+  populateNode(unknown, rom);
+
+  TEST_ASSERT_EQUAL_STRING("DS18B20", deviceFamily(sensor.familyId).name);
+  TEST_ASSERT_TRUE(isTemperatureSensor(sensor.familyId));
+  TEST_ASSERT_FALSE(sensor.overdrive);
+  TEST_ASSERT_TRUE(board.overdrive);
+  TEST_ASSERT_EQUAL_INT(2, switchChannels(DS2413));
+  TEST_ASSERT_EQUAL_INT(0, switchChannels(DS2423));
+
+  // a family that isn't supported has no name, scanBus() ignores it.
+  TEST_ASSERT_FALSE(deviceFamily(unknown.familyId).supported());
+  TEST_ASSERT_EQUAL_STRING("", deviceFamily(unknown.familyId).name);
+}
+
+void test_ds18b20_read_conversion(void) {
+  onewireNode node, other;
+  auto sensor = addDevice<SimDS18x20>(DS18B20, 1, node);
+  addDevice<SimDS18x20>(DS18B20, 2, other)->setTemperature(-3);
+  sensor->setTemperature(21.5625);
+
+  startSimultaneousConversion(*ds);
+  TEST_ASSERT_TRUE(sensor->isConverting());
+  delay(DS18B20_12BIT_TIME);
+
+  TEST_ASSERT_EQUAL_INT(345, readConversion(*ds, node));
+  TEST_ASSERT_EQUAL_INT(-48, readConversion(*ds, other));
+  TEST_ASSERT_EQUAL_UINT32(1, node.success);
+  TEST_ASSERT_EQUAL_UINT32(0, node.errors);
+}
+
+void test_ds18b20_resolution(void) {
+  onewireNode node;
+  auto sensor = addDevice<SimDS18x20>(DS18B20, 1, node);
+  sensor->setTemperature(21.5625);
+
+  setResolution(*ds, DS18B20_9BIT);
+  TEST_ASSERT_EQUAL(93750, sensor->conversionTime());
+
+  startConversion(*ds, node.id);
+  delay(DS18B20_9BIT_TIME);
+  TEST_ASSERT_EQUAL_INT(344, readConversion(*ds, node));
+}
+
+void test_ds18b20_set_resolution(void) {
+  onewireNode node, other;
+  auto sensor = addDevice<SimDS18x20>(DS18B20, 1, node);
+  auto otherSensor = addDevice<SimDS18x20>(DS18B20, 2, other);
+  TEST_ASSERT_TRUE(probeSensor(*ds, node));
+
+  TEST_ASSERT_TRUE(setResolution(*ds, node, 9));
+  TEST_ASSERT_EQUAL_UINT8(9, node.resolution);
+  TEST_ASSERT_EQUAL_HEX8(DS18B20_9BIT, sensor->getEeprom()[2]);
+  // the alarm registers are kept, and the other sensor isn't touched.
+  TEST_ASSERT_EQUAL_UINT8(75, sensor->getEeprom()[0]);
+  TEST_ASSERT_EQUAL_UINT8(70, sensor->getEeprom()[1]);
+  TEST_ASSERT_EQUAL_HEX8(DS18B20_12BIT, otherSensor->getScratchpad()[CONFIGURATION]);
+  TEST_ASSERT_EQUAL_UINT16(DS18B20_9BIT_TIME, conversionTime(node));
+}
+
+void test_ds18s20_resolution_fixed(void) {
+  onewireNode node;
+  addDevice<SimDS18x20>(DS18S20, 1, node);
+
+  TEST_ASSERT_FALSE(setResolution(*ds, node, 9));
+  TEST_ASSERT_EQUAL_UINT16(DS18B20_12BIT_TIME, conversionTime(node));
+}
+
+void test_alarm_limits(void) {
+  onewireNode node;
+  node.lowLimit = 22;
+  node.highLimit = 24.5;
+  TEST_ASSERT_EQUAL_INT8(21, alarmLow(node));
+  TEST_ASSERT_EQUAL_INT8(24, alarmHigh(node));
+
+  // a missing limit never alarms.
+  node.lowLimit = UNSET_TEMPERATURE;
+  node.highLimit = UNSET_TEMPERATURE;
+  TEST_ASSERT_EQUAL_INT8(-128, alarmLow(node));
+  TEST_ASSERT_EQUAL_INT8(127, alarmHigh(node));
+}
+
+void test_alarm_search(void) {
+  onewireNode cold, warm, inside, noLimits;
+  auto coldSensor = addDevice<SimDS18x20>(DS18B20, 1, cold);
+  auto warmSensor = addDevice<SimDS18x20>(DS18S20, 2, warm);
+  auto insideSensor = addDevice<SimDS18x20>(DS18B20, 3, inside);
+  auto noLimitsSensor = addDevice<SimDS18x20>(DS18B20, 4, noLimits);
+
+  cold.lowLimit = warm.lowLimit = inside.lowLimit = 22;
+  cold.highLimit = warm.highLimit = inside.highLimit = 24;
+  coldSensor->setTemperature(21.9375);
+  warmSensor->setTemperature(24.5);
+  insideSensor->setTemperature(22);
+  noLimitsSensor->setTemperature(-20);
+
+  oneWireNodes = {cold, warm, inside, noLimits};
+  indexNodes();
+  for (auto &node : oneWireNodes) {
+    TEST_ASSERT_TRUE(probeSensor(*ds, node));
+    TEST_ASSERT_TRUE(setAlarmLimits(*ds, node));
+  }
+  // TH and TL are copied to the EEPROM.
+  TEST_ASSERT_EQUAL_INT8(21, (int8_t)coldSensor->getEeprom()[1]);
+  TEST_ASSERT_EQUAL_INT8(24, (int8_t)coldSensor->getEeprom()[0]);
+
+  TEST_ASSERT_TRUE(convertTemperatures(*ds, DS18B20_12BIT_TIME, false));
+  TEST_ASSERT_TRUE(findAlarmingSensors(*ds));
+  TEST_ASSERT_TRUE(oneWireNodes[0].alarming);
+  TEST_ASSERT_TRUE(oneWireNodes[1].alarming);
+  TEST_ASSERT_FALSE(oneWireNodes[2].alarming);
+  TEST_ASSERT_FALSE(oneWireNodes[3].alarming);
+
+  // the bit by bit search finds the same devices.
+  uint8_t addr[8];
+  uint8_t found = 0;
+  ds->reset_search();
+  while (ds->search_bitwise(addr, false)) found++;
+  TEST_ASSERT_EQUAL_UINT8(2, found);
+
+  // back inside the limits, nothing alarms.
+  coldSensor->setTemperature(23);
+  warmSensor->setTemperature(23);
+  for (auto &node : oneWireNodes) node.alarming = false;
+  TEST_ASSERT_TRUE(convertTemperatures(*ds, DS18B20_12BIT_TIME, false));
+  TEST_ASSERT_TRUE(findAlarmingSensors(*ds));
+  for (auto &node : oneWireNodes) TEST_ASSERT_FALSE(node.alarming);
+}
+
+void test_ds18b20_conversion_not_done(void) {
+  onewireNode node;
+  auto sensor = addDevice<SimDS18x20>(DS18B20, 1, node);
+  sensor->setTemperature(10);
+
+  startConversion(*ds, node.id);
+  delay(100);
+  // still the power-on value of 85 degrees.
+  TEST_ASSERT_EQUAL_INT(85 * 16, readConversion(*ds, node));
+}
+
+void test_ds18b20_probe(void) {
+  onewireNode node, parasite;
+  addDevice<SimDS18x20>(DS18B20, 1, node);
+  addDevice<SimDS18x20>(DS18B20, 2, parasite)->setParasite(true);
+  setResolution(*ds, DS18B20_10BIT);
+
+  TEST_ASSERT_TRUE(probeSensor(*ds, node));
+  TEST_ASSERT_TRUE(probeSensor(*ds, parasite));
+  TEST_ASSERT_FALSE(node.parasite);
+  TEST_ASSERT_TRUE(parasite.parasite);
+  TEST_ASSERT_EQUAL_UINT8(10, node.resolution);
+  TEST_ASSERT_EQUAL_UINT16(DS18B20_10BIT_TIME, conversionTime(node));
+}
+
+void test_convert_polls_external_power(void) {
+  onewireNode node;
+  auto sensor = addDevice<SimDS18x20>(DS18B20, 1, node);
+  sensor->setTemperature(21.5625);
+  setResolution(*ds, DS18B20_9BIT);
+  TEST_ASSERT_TRUE(probeSensor(*ds, node));
+
+  auto started = native::clock();
+  TEST_ASSERT_TRUE(convertTemperatures(*ds, conversionTime(node), node.parasite));
+  auto elapsed = native::clock() - started;
+
+  // done soon after the 93.75 ms conversion, not after the worst case time.
+  TEST_ASSERT_FALSE(sensor->isConverting());
+  TEST_ASSERT_TRUE(elapsed >= 93750);
+  TEST_ASSERT_TRUE(elapsed < 93750 + 10000);
+  TEST_ASSERT_EQUAL_INT(344, readConversion(*ds, node));
+}
+
+void test_convert_parasite_power(void) {
+  onewireNode node;
+  auto sensor = addDevice<SimDS18x20>(DS18B20, 1, node);
+  sensor->setParasite(true);
+  sensor->setTemperature(-3);
+  TEST_ASSERT_TRUE(probeSensor(*ds, node));
+
+  // a parasite powered sensor can't answer read slots, the bus is held at the strong pullup for the whole time.
+  auto started = native::clock();
+  TEST_ASSERT_TRUE(convertTemperatures(*ds, conversionTime(node), node.parasite));
+  TEST_ASSERT_TRUE(native::clock() - started >= DS18B20_12BIT_TIME * 1000LL);
+  TEST_ASSERT_FALSE(bus->isStrongPullup());
+  TEST_ASSERT_EQUAL_INT(-48, readConversion(*ds, node));
+  TEST_ASSERT_EQUAL_UINT32(1, sensor->getConversions());
+}
+
+void test_ds18s20_count_remain(void) {
+  onewireNode node;
+  auto sensor = addDevice<SimDS18x20>(DS18S20, 1, node);
+  sensor->setTemperature(23.3125);
+
+  startConversion(*ds, node.id);
+  delay(750);
+  TEST_ASSERT_EQUAL_INT(373, readConversion(*ds, node));
+}
+
+void test_ds18b20_retries_crc_error(void) {
+  onewireNode node;
+  auto sensor = addDevice<SimDS18x20>(DS18B20, 1, node);
+  sensor->setTemperature(19);
+
+  startConversion(*ds, node.id);
+  delay(750);
+  corruptNext(1);
+  TEST_ASSERT_EQUAL_INT(19 * 16, readConversion(*ds, node));
+  TEST_ASSERT_EQUAL_UINT32(1, node.errors);
+  TEST_ASSERT_EQUAL_UINT32(1, node.success);
+}
+
+void test_ds18b20_missing_gives_up(void) {
+  onewireNode node;
+  uint8_t rom[8];
+  SimDevice::makeRom(DS18B20, 1, rom);
+  populateNode(node, rom);
+
+  TEST_ASSERT_EQUAL_INT(UNSET_TEMPERATURE, readConversion(*ds, node));
+  TEST_ASSERT_EQUAL_UINT32(1, node.errors);
+}
+
+void test_ds2408_set_and_get_state(void) {
+  onewireNode node;
+  auto sw = addDevice<SimDS2408>(DS2408, 0x29E1, node);
+
+  TEST_ASSERT_EQUAL_INT(0xA5, setState(*ds, node, 0xA5));
+  TEST_ASSERT_EQUAL_HEX8(0xA5, sw->getLatch());
+  TEST_ASSERT_EQUAL_INT(0xA5, getState(*ds, node));
+
+  sw->setInputs(0xFE);
+  TEST_ASSERT_EQUAL_INT(0xA4, getState(*ds, node));
+}
+
+void test_ds2408_overdrive(void) {
+  onewireNode node;
+  auto sw = addDevice<SimDS2408>(DS2408, 0x29E1, node);
+  TEST_ASSERT_TRUE(node.overdrive);
+
+  TEST_ASSERT_EQUAL_INT(0x0F, setState(*ds, node, 0x0F));
+  TEST_ASSERT_TRUE(sw->isOverdrive());
+  TEST_ASSERT_EQUAL_INT(0x0F, getState(*ds, node));
+}
+
+void test_ds2408_two_boards(void) {
+  onewireNode first, second;
+  auto firstSw = addDevice<SimDS2408>(DS2408, 0xE1F1E3, first);
+  auto secondSw = addDevice<SimDS2408>(DS2408, 2, second);
+
+  TEST_ASSERT_EQUAL_INT(0x0F, setState(*ds, first, 0x0F));
+  TEST_ASSERT_EQUAL_INT(0xF0, setState(*ds, second, 0xF0));
+  TEST_ASSERT_EQUAL_HEX8(0x0F, firstSw->getLatch());
+  TEST_ASSERT_EQUAL_HEX8(0xF0, secondSw->getLatch());
+
+  secondSw->setInputs(0x7F);
+  TEST_ASSERT_EQUAL_INT(0x0F, getState(*ds, first));
+  TEST_ASSERT_EQUAL_INT(0x70, getState(*ds, second));
+  TEST_ASSERT_EQUAL_UINT32(0, first.errors + second.errors);
+}
+
+void test_ds2408_crc_retry(void) {
+  onewireNode node;
+  auto sw = addDevice<SimDS2408>(DS2408, 1, node);
+  sw->setInputs(0xA5);
+
+  // the corrupted read is retried after a RESUME.
+  corruptNext(1);
+  TEST_ASSERT_EQUAL_INT(0xA5, getState(*ds, node));
+  TEST_ASSERT_EQUAL_UINT32(1, node.errors);
+  TEST_ASSERT_EQUAL_UINT32(1, node.success);
+}
+
+void test_ds2408_write_retry(void) {
+  onewireNode node, other;
+  auto sw = addDevice<SimDS2408>(DS2408, 1, node);
+  auto otherSw = addDevice<SimDS2408>(DS2408, 2, other);
+
+  // a corrupted confirmation is written again after a RESUME, the other board isn't touched.
+  corruptNext(1);
+  TEST_ASSERT_EQUAL_INT(0x3C, setState(*ds, node, 0x3C));
+  TEST_ASSERT_EQUAL_HEX8(0x3C, sw->getLatch());
+  TEST_ASSERT_EQUAL_HEX8(0xFF, otherSw->getLatch());
+  TEST_ASSERT_EQUAL_UINT32(1, node.errors);
+}
+
+void test_ds2408_reset(void) {
+  onewireNode node;
+  auto sw = addDevice<SimDS2408>(DS2408, 1, node);
+  sw->setInputs(0x00);
+
+  ds2408_reset(*ds, node);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, sw->getLatch());
+  TEST_ASSERT_EQUAL_HEX8(0x85, sw->getControl());
+}
+
+void test_ds2408_activity_search(void) {
+  onewireNode first, second;
+  auto firstSw = addDevice<SimDS2408>(DS2408, 1, first);
+  auto secondSw = addDevice<SimDS2408>(DS2408, 2, second);
+
+  // power cycled boards answer until they are configured.
+  oneWireNodes = {first, second};
+  indexNodes();
+  TEST_ASSERT_TRUE(findActiveBoards(*ds));
+  TEST_ASSERT_TRUE(oneWireNodes[0].alarming && oneWireNodes[1].alarming);
+
+  for (auto &node : oneWireNodes) {
+    ds2408_reset(*ds, node);
+    TEST_ASSERT_EQUAL_INT(0, reconcileState(*ds, node));
+    node.alarming = false;
+  }
+  TEST_ASSERT_TRUE(findActiveBoards(*ds));
+  TEST_ASSERT_FALSE(oneWireNodes[0].alarming || oneWireNodes[1].alarming);
+
+  // an input change is latched until the board has been read back.
+  secondSw->setInputs(0xFE);
+  secondSw->setInputs(0xFF);
+  TEST_ASSERT_TRUE(findActiveBoards(*ds));
+  TEST_ASSERT_FALSE(oneWireNodes[0].alarming);
+  TEST_ASSERT_TRUE(oneWireNodes[1].alarming);
+  TEST_ASSERT_EQUAL_INT(0, reconcileState(*ds, oneWireNodes[1]));
+  TEST_ASSERT_EQUAL_HEX8(0, secondSw->getActivity());
+  TEST_ASSERT_EQUAL_UINT32(1, firstSw->getChannelWrites());
+}
+
+void test_ds2408_reconcile(void) {
+  onewireNode node;
+  auto sw = addDevice<SimDS2408>(DS2408, 1, node);
+  ds2408_reset(*ds, node);
+
+  // the latches are written again when they differ from the actuator state.
+  bitSet(node.pinStates, 2);
+  TEST_ASSERT_EQUAL_INT(1, reconcileState(*ds, node));
+  TEST_ASSERT_EQUAL_HEX8(0xFB, sw->getLatch());
+  TEST_ASSERT_EQUAL_HEX8(0, sw->getActivity());
+  TEST_ASSERT_EQUAL_INT(0, reconcileState(*ds, node));
+  TEST_ASSERT_EQUAL_HEX8(0x85, sw->getControl());
+}
+
+void test_ds2413_set_and_read(void) {
+  onewireNode node;
+  auto sw = addDevice<SimDS2413>(DS2413, 1, node);
+
+  // PIOB on, the pin is pulled low.
+  auto status = setDS2413State(*ds, node, 0x01);
+  TEST_ASSERT_EQUAL_INT(0x1, ds2413Latch(status));
+  TEST_ASSERT_EQUAL_INT(0x1, ds2413Pins(status));
+  TEST_ASSERT_EQUAL_HEX8(0x01, sw->getLatch());
+
+  // PIOA is off, but held low from the outside.
+  sw->setInputs(0x02);
+  status = readDS2413(*ds, node);
+  TEST_ASSERT_EQUAL_INT(0x1, ds2413Latch(status));
+  TEST_ASSERT_EQUAL_INT(0x0, ds2413Pins(status));
+}
+
+void test_ds2413_crc_retry(void) {
+  onewireNode node;
+  auto sw = addDevice<SimDS2413>(DS2413, 1, node);
+
+  // a corrupted confirmation is written again after RESUME.
+  corruptNext(1);
+  TEST_ASSERT_TRUE(setDS2413State(*ds, node, 0x00) >= 0);
+  TEST_ASSERT_EQUAL_HEX8(0x00, sw->getLatch());
+  TEST_ASSERT_EQUAL_UINT32(1, node.errors);
+
+  corruptNext(1);
+  TEST_ASSERT_TRUE(readDS2413(*ds, node) >= 0);
+  TEST_ASSERT_EQUAL_UINT32(2, node.errors);
+}
+
+void test_ds2406_set_and_read(void) {
+  onewireNode node;
+  auto sw = addDevice<SimDS2406>(DS2406, 1, node);
+
+  TEST_ASSERT_TRUE(setDS2406State(*ds, node, 0x02));
+  TEST_ASSERT_EQUAL_HEX8(0x02, sw->getLatch());
+  TEST_ASSERT_EQUAL_INT(0x02, ds2406Latch(readDS2406(*ds, node)));
+  TEST_ASSERT_EQUAL_UINT32(1, sw->getWrites());
+}
+
+void test_ds2406_crc_retry(void) {
+  onewireNode node;
+  auto sw = addDevice<SimDS2406>(DS2406, 1, node);
+
+  // the CRC16 the DS2406 sends back is corrupted, the status is written once more.
+  corruptNext(1);
+  TEST_ASSERT_TRUE(setDS2406State(*ds, node, 0x00));
+  TEST_ASSERT_EQUAL_HEX8(0x00, sw->getLatch());
+  TEST_ASSERT_EQUAL_UINT32(1, node.errors);
+
+  corruptNext(1);
+  TEST_ASSERT_EQUAL_INT(0x00, ds2406Latch(readDS2406(*ds, node)));
+  TEST_ASSERT_EQUAL_UINT32(2, node.errors);
+}
+
+void test_ds2405_toggle(void) {
+  onewireNode node;
+  auto sw = addDevice<SimDS2405>(DS2405, 1, node);
+
+  TEST_ASSERT_TRUE(setDS2405State(*ds, node, true));
+  TEST_ASSERT_TRUE(sw->isOn());
+  TEST_ASSERT_EQUAL_UINT32(1, sw->getToggles());
+
+  // already on, the first MATCH ROM turns it off and the second on again.
+  TEST_ASSERT_TRUE(setDS2405State(*ds, node, true));
+  TEST_ASSERT_TRUE(sw->isOn());
+  TEST_ASSERT_EQUAL_UINT32(3, sw->getToggles());
+
+  TEST_ASSERT_TRUE(setDS2405State(*ds, node, false));
+  TEST_ASSERT_FALSE(sw->isOn());
+}
+
+void test_set_actuator(void) {
+  onewireNode board, pio, dual, single;
+  auto boardSw = addDevice<SimDS2408>(DS2408, 1, board);
+  auto pioSw = addDevice<SimDS2413>(DS2413, 2, pio);
+  auto dualSw = addDevice<SimDS2406>(DS2406, 3, dual);
+  auto singleSw = addDevice<SimDS2405>(DS2405, 4, single);
+
+  TEST_ASSERT_EQUAL_INT(8, switchChannels(DS2408));
+  TEST_ASSERT_EQUAL_INT(0, switchChannels(DS18B20));
+
+  // bit n is channel n, 1 means on.
+  TEST_ASSERT_TRUE(setActuator(*ds, board, 0x81));
+  TEST_ASSERT_TRUE(setActuator(*ds, pio, 0x01));
+  TEST_ASSERT_TRUE(setActuator(*ds, dual, 0x02));
+  TEST_ASSERT_TRUE(setActuator(*ds, single, 0x01));
+  TEST_ASSERT_EQUAL_HEX8(0x7E, boardSw->getLatch());
+  TEST_ASSERT_EQUAL_HEX8(0x02, pioSw->getLatch());
+  TEST_ASSERT_EQUAL_HEX8(0x01, dualSw->getLatch());
+  TEST_ASSERT_TRUE(singleSw->isOn());
+}
+
+void test_reconcile_actuator(void) {
+  onewireNode pio, dual, single;
+  auto pioSw = addDevice<SimDS2413>(DS2413, 1, pio);
+  auto dualSw = addDevice<SimDS2406>(DS2406, 2, dual);
+  addDevice<SimDS2405>(DS2405, 3, single);
+
+  TEST_ASSERT_EQUAL_INT(0, reconcileActuator(*ds, pio));
+  TEST_ASSERT_EQUAL_INT(0, reconcileActuator(*ds, dual));
+
+  // latches lost, e.g. after a power loss, are written again.
+  bitSet(pio.pinStates, 1);
+  bitSet(dual.pinStates, 0);
+  TEST_ASSERT_EQUAL_INT(1, reconcileActuator(*ds, pio));
+  TEST_ASSERT_EQUAL_INT(1, reconcileActuator(*ds, dual));
+  TEST_ASSERT_EQUAL_HEX8(0x01, pioSw->getLatch());
+  TEST_ASSERT_EQUAL_HEX8(0x02, dualSw->getLatch());
+  TEST_ASSERT_EQUAL_UINT32(1, pioSw->getWrites());
+
+  // a DS2405 isn't touched.
+  TEST_ASSERT_EQUAL_INT(0, reconcileActuator(*ds, single));
+}
+
+void test_ds2423_counters(void) {
+  onewireNode node;
+  auto counter = addDevice<SimDS2423>(DS2423, 1, node);
+  counter->setCounter(0, 123456);
+  counter->setCounter(1, 0xE3E3E3);
+
+  TEST_ASSERT_TRUE(getCounters(*ds, node));
+  TEST_ASSERT_EQUAL_UINT32(123456, node.counters[0]);
+  TEST_ASSERT_EQUAL_UINT32(0xE3E3E3, node.counters[1]);
+  TEST_ASSERT_EQUAL_UINT32(1, node.success);
+}
+
+void test_ds2423_standard_speed(void) {
+  onewireNode node;
+  auto counter = addDevice<SimDS2423>(DS2423, 1, node);
+  counter->count(1, 42);
+  node.overdrive = false;
+
+  TEST_ASSERT_TRUE(getCounters(*ds, node));
+  TEST_ASSERT_EQUAL_UINT32(0, node.counters[0]);
+  TEST_ASSERT_EQUAL_UINT32(42, node.counters[1]);
+}
+
+void test_ds2423_crc_retry(void) {
+  onewireNode node;
+  auto counter = addDevice<SimDS2423>(DS2423, 1, node);
+  counter->setCounter(0, 7);
+  counter->setCounter(1, 9);
+
+  // a corrupted counter A is read again, together with counter B.
+  corruptNext(1);
+  TEST_ASSERT_TRUE(getCounters(*ds, node));
+  TEST_ASSERT_EQUAL_UINT32(7, node.counters[0]);
+  TEST_ASSERT_EQUAL_UINT32(9, node.counters[1]);
+  TEST_ASSERT_EQUAL_UINT32(1, node.errors);
+}
+
+void test_ds2423_page_retry(void) {
+  onewireNode node;
+  auto counter = addDevice<SimDS2423>(DS2423, 1, node);
+  counter->setCounter(0, 7);
+  counter->setCounter(1, 9);
+
+  // the 42 bytes of counter A's page are valid, only counter B's page is read again.
+  getCounters(*ds, node);
+  counter->getMemory()[15 * 32] = 0x42;
+  counter->setCounter(0, 8);
+  TEST_ASSERT_TRUE(getCounters(*ds, node));
+  TEST_ASSERT_EQUAL_UINT32(8, node.counters[0]);
+}
+
+void test_ds2423_gives_up(void) {
+  onewireNode node;
+  auto counter = addDevice<SimDS2423>(DS2423, 1, node);
+  counter->setCounter(0, 1);
+  node.counters[0] = node.counters[1] = 5;
+
+  // both counters are kept when they can't be read.
+  corruptNext(1000);
+  TEST_ASSERT_FALSE(getCounters(*ds, node));
+  TEST_ASSERT_EQUAL_UINT32(5, node.counters[0]);
+  TEST_ASSERT_EQUAL_UINT32(5, node.counters[1]);
+  TEST_ASSERT_EQUAL_UINT32(MAX_CONSECUTIVE_RETRIES, node.errors);
+}
+
+void test_ds2423_sample_rates(void) {
+  onewireNode node;
+  auto counter = addDevice<SimDS2423>(DS2423, 1, node);
+  counter->setCounter(0, 100);
+
+  TEST_ASSERT_TRUE(sampleCounters(*ds, node));
+  native::advance(10000000);
+  counter->count(0, 50);
+  counter->count(1, 5);
+  TEST_ASSERT_TRUE(sampleCounters(*ds, node));
+
+  // the time of each sample is taken after its read, so the rates are off by the difference in read time.
+  auto &pulses = counterState(node).pulses;
+  TEST_ASSERT_EQUAL(150, pulses[0].total);
+  TEST_ASSERT_TRUE(pulses[0].rate > 4.95 && pulses[0].rate < 5.05);
+  TEST_ASSERT_TRUE(pulses[1].rate > 0.495 && pulses[1].rate < 0.505);
+}
+
+void test_ds2450_configure(void) {
+  onewireNode node;
+  auto adc = addDevice<SimDS2450>(DS2450, 1, node);
+  node.resolution = 10;
+  node.inputRanges = 0x05;
+
+  TEST_ASSERT_TRUE(configureDS2450(*ds, node));
+  auto memory = adc->getMemory();
+  TEST_ASSERT_EQUAL_HEX8(0x0A, memory[8]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, memory[9]);   // 5.12 V, power-on flag cleared
+  TEST_ASSERT_EQUAL_HEX8(0x00, memory[11]);  // 2.56 V
+  TEST_ASSERT_EQUAL_HEX8(0x01, memory[13]);
+  TEST_ASSERT_EQUAL_HEX8(0x40, memory[0x1C]);
+  TEST_ASSERT_EQUAL_UINT32(0, node.errors);
+}
+
+void test_ds2450_sample(void) {
+  onewireNode node;
+  auto adc = addDevice<SimDS2450>(DS2450, 1, node);
+  node.resolution = 16;
+  node.inputRanges = 0x0E;
+  adc->setInput(0, 1.28);
+  adc->setInput(1, 3.84);
+  adc->setInput(2, 0);
+  adc->setInput(3, 5.12);
+
+  TEST_ASSERT_TRUE(configureDS2450(*ds, node));
+  auto started = native::clock();
+  TEST_ASSERT_TRUE(sampleDS2450(*ds, node));
+
+  // one conversion of all channels, waited for by polling.
+  TEST_ASSERT_EQUAL_UINT32(1, adc->getConversions());
+  TEST_ASSERT_TRUE(native::clock() - started >= adc->conversionTime(0x0F));
+  auto &voltages = analogState(node).voltages;
+  TEST_ASSERT_TRUE(voltages[0] > 1.279 && voltages[0] < 1.281);
+  TEST_ASSERT_TRUE(voltages[1] > 3.839 && voltages[1] < 3.841);
+  TEST_ASSERT_TRUE(voltages[2] == 0);
+  TEST_ASSERT_TRUE(voltages[3] > 5.119 && voltages[3] < 5.12);
+}
+
+void test_ds2450_crc_retry(void) {
+  onewireNode node;
+  auto adc = addDevice<SimDS2450>(DS2450, 1, node);
+  adc->setInput(0, 2);
+  node.inputRanges = 0x00;
+
+  TEST_ASSERT_TRUE(configureDS2450(*ds, node));
+  TEST_ASSERT_TRUE(convertDS2450(*ds, node));
+  corruptNext(1);
+  TEST_ASSERT_TRUE(readDS2450(*ds, node));
+  TEST_ASSERT_TRUE(analogState(node).voltages[0] > 1.99 && analogState(node).voltages[0] <= 2);
+  TEST_ASSERT_EQUAL_UINT32(1, node.errors);
+}
+
+void test_ds2450_power_loss(void) {
+  onewireNode node;
+  auto adc = addDevice<SimDS2450>(DS2450, 1, node);
+  adc->setInput(2, 4);
+  TEST_ASSERT_TRUE(configureDS2450(*ds, node));
+
+  // back at the power-on values, 8 bits and the 2.56 V range that can't convert 4 V.
+  for (uint8_t channel = 0; channel < 4; channel++) {
+    adc->getMemory()[8 + channel * 2] = 0x08;
+    adc->getMemory()[9 + channel * 2] = 0x8C;
+  }
+
+  TEST_ASSERT_TRUE(sampleDS2450(*ds, node));
+  TEST_ASSERT_EQUAL_UINT32(2, adc->getConversions());
+  TEST_ASSERT_EQUAL_HEX8(0x01, adc->getMemory()[13]);
+  TEST_ASSERT_TRUE(analogState(node).voltages[2] > 3.99 && analogState(node).voltages[2] < 4.01);
+}
+
+static void runTests(void) {
+  RUN_TEST(test_device_families);
+  RUN_TEST(test_ds18b20_read_conversion);
+  RUN_TEST(test_ds18b20_resolution);
+  RUN_TEST(test_ds18b20_set_resolution);
+  RUN_TEST(test_ds18s20_resolution_fixed);
+  RUN_TEST(test_alarm_limits);
+  RUN_TEST(test_alarm_search);
+  RUN_TEST(test_ds18b20_conversion_not_done);
+  RUN_TEST(test_ds18b20_probe);
+  RUN_TEST(test_convert_polls_external_power);
+  RUN_TEST(test_convert_parasite_power);
+  RUN_TEST(test_ds18s20_count_remain);
+  RUN_TEST(test_ds18b20_retries_crc_error);
+  RUN_TEST(test_ds18b20_missing_gives_up);
+  RUN_TEST(test_ds2408_set_and_get_state);
+  RUN_TEST(test_ds2408_overdrive);
+  RUN_TEST(test_ds2408_two_boards);
+  RUN_TEST(test_ds2408_crc_retry);
+  RUN_TEST(test_ds2408_write_retry);
+  RUN_TEST(test_ds2408_reset);
+  RUN_TEST(test_ds2408_activity_search);
+  RUN_TEST(test_ds2408_reconcile);
+  RUN_TEST(test_ds2413_set_and_read);
+  RUN_TEST(test_ds2413_crc_retry);
+  RUN_TEST(test_ds2406_set_and_read);
+  RUN_TEST(test_ds2406_crc_retry);
+  RUN_TEST(test_ds2405_toggle);
+  RUN_TEST(test_set_actuator);
+  RUN_TEST(test_reconcile_actuator);
+  RUN_TEST(test_ds2423_counters);
+  RUN_TEST(test_ds2423_standard_speed);
+  RUN_TEST(test_ds2423_crc_retry);
+  RUN_TEST(test_ds2423_page_retry);
+  RUN_TEST(test_ds2423_gives_up);
+  RUN_TEST(test_ds2423_sample_rates);
+  RUN_TEST(test_ds2450_configure);
+  RUN_TEST(test_ds2450_sample);
+  RUN_TEST(test_ds2450_crc_retry);
+  RUN_TEST(test_ds2450_power_loss);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  runTests();
+  useDS2484 = true;
+  runTests();
+  return UNITY_END();
+}
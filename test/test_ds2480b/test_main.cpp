@@ -0,0 +1,245 @@
+#include <DS2480B.h>
+#include <SimDevices.h>
+#include <unity.h>
+#include <set>
+
+// DS2480B library against the simulated DS2480B, host link and bus level behaviour.
+
+static SimBus *bus;
+static SimDS2480B *sim;
+static DS2480B *ds;
+static std::vector<SimDevice *> devices;
+
+static SimDS18x20 *addSensor(uint64_t serial) {
+  uint8_t rom[8];
+  SimDevice::makeRom(DS18B20, serial, rom);
+  auto device = new SimDS18x20(rom);
+  devices.push_back(device);
+  bus->attach(device);
+  return device;
+}
+
+static SimDS2408 *addSwitch(uint64_t serial) {
+  uint8_t rom[8];
+  SimDevice::makeRom(DS2408, serial, rom);
+  auto device = new SimDS2408(rom);
+  devices.push_back(device);
+  bus->attach(device);
+  return device;
+}
+
+void setUp(void) {
+  native::clock() = 0;
+  bus = new SimBus();
+  sim = new SimDS2480B(*bus);
+  ds = new DS2480B(*sim);
+  ds->begin();
+}
+
+void tearDown(void) {
+  delete ds;
+  delete sim;
+  delete bus;
+  for (auto device : devices) delete device;
+  devices.clear();
+}
+
+void test_negotiate_baud_rate(void) {
+  TEST_ASSERT_EQUAL_UINT32(115200, ds->negotiateBaudRate());
+  TEST_ASSERT_EQUAL_UINT32(115200, sim->getChipBaudRate());
+  TEST_ASSERT_EQUAL_UINT32(115200, ds->getBaudRate());
+}
+
+void test_negotiate_baud_rate_falls_back(void) {
+  sim->setMaxBaudRate(57600);
+  TEST_ASSERT_EQUAL_UINT32(57600, ds->negotiateBaudRate());
+
+  addSensor(1);
+  TEST_ASSERT_EQUAL(1, ds->reset());
+}
+
+void test_reset_status(void) {
+  TEST_ASSERT_EQUAL(0, ds->reset());
+  TEST_ASSERT_EQUAL(ONEWIRE_NO_PRESENCE, ds->getStatus());
+
+  addSensor(1);
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  TEST_ASSERT_EQUAL(ONEWIRE_OK, ds->getStatus());
+
+  bus->setShorted(true);
+  TEST_ASSERT_EQUAL(0, ds->reset());
+  TEST_ASSERT_EQUAL(ONEWIRE_SHORTED, ds->getStatus());
+}
+
+void test_disconnected_times_out(void) {
+  addSensor(1);
+  sim->setConnected(false);
+
+  int64_t started = native::clock();
+  TEST_ASSERT_EQUAL(0, ds->reset());
+  TEST_ASSERT_EQUAL(ONEWIRE_TIMEOUT, ds->getStatus());
+  TEST_ASSERT_LESS_THAN(started + 20000, native::clock());
+}
+
+void test_lost_reply_is_short_read(void) {
+  addSensor(1);
+  ds->reset();
+  ds->skip();
+
+  uint8_t buf[10];
+  sim->dropNext(1);
+  TEST_ASSERT_FALSE(ds->read_bytes(buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL(ONEWIRE_SHORT_READ, ds->getStatus());
+}
+
+void test_search_finds_all_devices(void) {
+  std::set<std::vector<uint8_t>> expected;
+  for (uint64_t i = 0; i < 20; i++) {
+    auto device = addSensor(0x9E3779B97F4AULL * (i + 1));
+    expected.insert(std::vector<uint8_t>(device->rom, device->rom + 8));
+  }
+  addSwitch(0x42);
+  expected.insert(std::vector<uint8_t>(devices.back()->rom, devices.back()->rom + 8));
+
+  std::vector<std::vector<uint8_t>> accelerated, bitwise;
+  uint8_t rom[8];
+
+  ds->reset_search();
+  while (ds->search(rom)) accelerated.push_back(std::vector<uint8_t>(rom, rom + 8));
+  ds->reset_search();
+  while (ds->search_bitwise(rom)) bitwise.push_back(std::vector<uint8_t>(rom, rom + 8));
+
+  TEST_ASSERT_EQUAL(expected.size(), accelerated.size());
+  TEST_ASSERT_TRUE(expected == std::set<std::vector<uint8_t>>(accelerated.begin(), accelerated.end()));
+  TEST_ASSERT_TRUE(accelerated == bitwise);
+}
+
+void test_accelerated_search_round_trips(void) {
+  for (uint64_t i = 1; i <= 10; i++) addSensor(i * 1000003);
+
+  uint8_t rom[8];
+  ds->resetStats();
+  ds->reset_search();
+  while (ds->search(rom)) {}
+
+  // per device: reset, SEARCH ROM and the 16 search accelerator bytes. Plus the final reset.
+  TEST_ASSERT_LESS_OR_EQUAL(3 * 10 + 1, ds->getStats().roundTrips);
+}
+
+void test_command_mode_byte_is_escaped(void) {
+  // ROM with both mode switch bytes in it, TH and TL set to them as well.
+  auto sensor = addSensor(0xE3E1E3E1E3ULL);
+
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  ds->select(sensor->rom);
+  uint8_t write[] = {0x4E, 0xE3, 0xE1, 0x7F};
+  TEST_ASSERT_TRUE(ds->write_bytes(write, sizeof(write)));
+
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  ds->select(sensor->rom);
+  ds->write(0xBE);
+  uint8_t scratchpad[9];
+  TEST_ASSERT_TRUE(ds->read_bytes(scratchpad, sizeof(scratchpad)));
+
+  TEST_ASSERT_EQUAL_HEX8(0xE3, scratchpad[2]);
+  TEST_ASSERT_EQUAL_HEX8(0xE1, scratchpad[3]);
+  TEST_ASSERT_EQUAL_HEX8(DS2480B::crc8(scratchpad, 8), scratchpad[8]);
+}
+
+void test_block_is_chunked(void) {
+  addSensor(1);
+  ds->reset();
+  ds->skip();
+
+  uint8_t buf[100];
+  ds->resetStats();
+  TEST_ASSERT_TRUE(ds->read_bytes(buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL_UINT32(2, ds->getStats().roundTrips);
+}
+
+void test_corrupted_byte_fails_crc(void) {
+  auto sensor = addSensor(7);
+
+  ds->reset();
+  ds->select(sensor->rom);
+  ds->write(0xBE);
+  sim->corruptNext(1);
+  uint8_t scratchpad[9];
+  TEST_ASSERT_TRUE(ds->read_bytes(scratchpad, sizeof(scratchpad)));
+  TEST_ASSERT_NOT_EQUAL(DS2480B::crc8(scratchpad, 8), scratchpad[8]);
+}
+
+void test_overdrive_select(void) {
+  addSensor(1);
+  auto sw = addSwitch(2);
+
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  ds->selectOverdrive(sw->rom);
+  TEST_ASSERT_EQUAL(SPEED_OVERDRIVE, ds->getSpeed());
+  TEST_ASSERT_TRUE(sim->isOverdriveSpeed());
+  TEST_ASSERT_TRUE(sw->isOverdrive());
+
+  uint8_t buf[13] = {0xF0, 0x88, 0x00};
+  TEST_ASSERT_TRUE(ds->block(buf, 3));
+  TEST_ASSERT_TRUE(ds->read_bytes(buf + 3, 10));
+  TEST_ASSERT_TRUE(DS2480B::check_crc16(buf, 11, &buf[11]));
+
+  // a standard reset brings everything back to standard speed.
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  TEST_ASSERT_FALSE(sw->isOverdrive());
+}
+
+void test_faster_link_is_faster(void) {
+  addSensor(1);
+  uint8_t buf[64];
+
+  ds->reset();
+  ds->skip();
+  int64_t started = native::clock();
+  ds->read_bytes(buf, sizeof(buf));
+  int64_t slow = native::clock() - started;
+
+  ds->negotiateBaudRate();
+  ds->reset();
+  ds->skip();
+  started = native::clock();
+  ds->read_bytes(buf, sizeof(buf));
+  int64_t fast = native::clock() - started;
+
+  // 9600 baud is slower than the 1-Wire bus (560us per byte), at 115200 baud the bus is the limit.
+  TEST_ASSERT_GREATER_OR_EQUAL(64 * 1041, slow);
+  TEST_ASSERT_LESS_OR_EQUAL(64 * 560 + 2000, fast);
+}
+
+void test_strong_pullup(void) {
+  auto sensor = addSensor(1);
+  ds->negotiateBaudRate();
+
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  ds->select(sensor->rom);
+  TEST_ASSERT_TRUE(ds->writeStrongPullup(0x44));
+  TEST_ASSERT_TRUE(sensor->isConverting());
+  TEST_ASSERT_TRUE(bus->isStrongPullup());
+
+  ds->endStrongPullup();
+  TEST_ASSERT_FALSE(bus->isStrongPullup());
+  TEST_ASSERT_EQUAL(ONEWIRE_OK, ds->getStatus());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_negotiate_baud_rate);
+  RUN_TEST(test_negotiate_baud_rate_falls_back);
+  RUN_TEST(test_reset_status);
+  RUN_TEST(test_disconnected_times_out);
+  RUN_TEST(test_lost_reply_is_short_read);
+  RUN_TEST(test_search_finds_all_devices);
+  RUN_TEST(test_accelerated_search_round_trips);
+  RUN_TEST(test_command_mode_byte_is_escaped);
+  RUN_TEST(test_block_is_chunked);
+  RUN_TEST(test_corrupted_byte_fails_crc);
+  RUN_TEST(test_overdrive_select);
+  RUN_TEST(test_faster_link_is_faster);
+  RUN_TEST(test_strong_pullup);
+  return UNITY_END();
+}
@@ -0,0 +1,229 @@
+#include <DS2484.h>
+#include <SimDevices.h>
+#include <unity.h>
+#include <set>
+
+// DS2484 library against the simulated DS2484, I2C and bus level behaviour.
+
+static SimBus *bus;
+static SimDS2484 *sim;
+static DS2484 *ds;
+static std::vector<SimDevice *> devices;
+
+static SimDS18x20 *addSensor(uint64_t serial) {
+  uint8_t rom[8];
+  SimDevice::makeRom(DS18B20, serial, rom);
+  auto device = new SimDS18x20(rom);
+  devices.push_back(device);
+  bus->attach(device);
+  return device;
+}
+
+static SimDS2408 *addSwitch(uint64_t serial) {
+  uint8_t rom[8];
+  SimDevice::makeRom(DS2408, serial, rom);
+  auto device = new SimDS2408(rom);
+  devices.push_back(device);
+  bus->attach(device);
+  return device;
+}
+
+void setUp(void) {
+  native::clock() = 0;
+  bus = new SimBus();
+  sim = new SimDS2484(*bus);
+  sim->setClock(400000);
+  ds = new DS2484(*sim);
+}
+
+void tearDown(void) {
+  delete ds;
+  delete sim;
+  delete bus;
+  for (auto device : devices) delete device;
+  devices.clear();
+}
+
+void test_begin(void) {
+  TEST_ASSERT_TRUE(ds->begin());
+  // active pullup enabled, standard speed.
+  TEST_ASSERT_EQUAL_HEX8(DS2484_CONFIG_APU, sim->getConfig());
+  TEST_ASSERT_EQUAL_UINT32(400000, ds->getLinkSpeed());
+}
+
+void test_begin_without_ds2484(void) {
+  sim->setConnected(false);
+  TEST_ASSERT_FALSE(ds->begin());
+}
+
+void test_reset_status(void) {
+  ds->begin();
+  TEST_ASSERT_EQUAL(0, ds->reset());
+  TEST_ASSERT_EQUAL(ONEWIRE_NO_PRESENCE, ds->getStatus());
+
+  addSensor(1);
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  TEST_ASSERT_EQUAL(ONEWIRE_OK, ds->getStatus());
+
+  bus->setShorted(true);
+  TEST_ASSERT_EQUAL(0, ds->reset());
+  TEST_ASSERT_EQUAL(ONEWIRE_SHORTED, ds->getStatus());
+}
+
+void test_disconnected_times_out(void) {
+  addSensor(1);
+  ds->begin();
+  sim->setConnected(false);
+
+  TEST_ASSERT_EQUAL(0, ds->reset());
+  TEST_ASSERT_EQUAL(ONEWIRE_TIMEOUT, ds->getStatus());
+}
+
+void test_search_finds_all_devices(void) {
+  std::set<std::vector<uint8_t>> expected;
+  for (uint64_t i = 0; i < 20; i++) {
+    auto device = addSensor(0x9E3779B97F4AULL * (i + 1));
+    expected.insert(std::vector<uint8_t>(device->rom, device->rom + 8));
+  }
+  addSwitch(0x42);
+  expected.insert(std::vector<uint8_t>(devices.back()->rom, devices.back()->rom + 8));
+  ds->begin();
+
+  std::vector<std::vector<uint8_t>> triplet, bitwise;
+  uint8_t rom[8];
+
+  ds->reset_search();
+  while (ds->search(rom)) triplet.push_back(std::vector<uint8_t>(rom, rom + 8));
+  ds->reset_search();
+  while (ds->search_bitwise(rom)) bitwise.push_back(std::vector<uint8_t>(rom, rom + 8));
+
+  TEST_ASSERT_EQUAL(expected.size(), triplet.size());
+  TEST_ASSERT_TRUE(expected == std::set<std::vector<uint8_t>>(triplet.begin(), triplet.end()));
+  TEST_ASSERT_TRUE(triplet == bitwise);
+}
+
+void test_triplet_search_bus_time(void) {
+  for (uint64_t i = 1; i <= 10; i++) addSensor(i * 1000003);
+  ds->begin();
+
+  uint8_t rom[8];
+  ds->reset_search();
+  sim->resetStats();
+  while (ds->search(rom)) {}
+
+  // per device: SEARCH ROM and one triplet (3 time slots) per ROM bit.
+  TEST_ASSERT_EQUAL_UINT32(10 * (8 + 64 * 3), sim->getStats().busBits);
+}
+
+void test_search_on_empty_bus(void) {
+  ds->begin();
+  uint8_t rom[8];
+  TEST_ASSERT_FALSE(ds->search(rom));
+}
+
+void test_read_write(void) {
+  auto sensor = addSensor(0xE3E1E3E1E3ULL);
+  ds->begin();
+
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  ds->select(sensor->rom);
+  uint8_t write[] = {0x4E, 0x12, 0x34, 0x7F};
+  TEST_ASSERT_TRUE(ds->write_bytes(write, sizeof(write)));
+
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  ds->select(sensor->rom);
+  ds->write(0xBE);
+  uint8_t scratchpad[9];
+  TEST_ASSERT_TRUE(ds->read_bytes(scratchpad, sizeof(scratchpad)));
+
+  TEST_ASSERT_EQUAL_HEX8(0x12, scratchpad[2]);
+  TEST_ASSERT_EQUAL_HEX8(0x34, scratchpad[3]);
+  TEST_ASSERT_EQUAL_HEX8(DS2484::crc8(scratchpad, 8), scratchpad[8]);
+}
+
+void test_verifier_stops_after_failed_crc(void) {
+  uint8_t rom[8];
+  SimDevice::makeRom(DS2423, 1, rom);
+  auto counter = new SimDS2423(rom);
+  devices.push_back(counter);
+  bus->attach(counter);
+  ds->begin();
+
+  // MATCH ROM, READ MEMORY + COUNTER of pages 14 and 15, 9 + 3 + 2 * 42 bytes.
+  uint8_t buf[96];
+  memset(buf, 0xFF, sizeof(buf));
+  buf[0] = MATCH_ROM;
+  memcpy(buf + 1, rom, 8);
+  buf[9] = 0xA5;
+  buf[10] = 0xC0;
+  buf[11] = 0x01;
+  CRC16Verifier crc(9, 43, 40);
+
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  sim->resetStats();
+  sim->corruptNext(1);
+  TEST_ASSERT_FALSE(ds->block(buf, sizeof(buf), &crc));
+  TEST_ASSERT_EQUAL(ONEWIRE_CRC_ERROR, ds->getStatus());
+  // the second page was never read.
+  TEST_ASSERT_EQUAL_UINT32((9 + 3 + 42) * 8, sim->getStats().busBits);
+}
+
+void test_overdrive_select(void) {
+  addSensor(1);
+  auto sw = addSwitch(2);
+  ds->begin();
+
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  ds->selectOverdrive(sw->rom);
+  TEST_ASSERT_EQUAL(SPEED_OVERDRIVE, ds->getSpeed());
+  TEST_ASSERT_TRUE(sim->isOverdriveSpeed());
+  TEST_ASSERT_TRUE(sw->isOverdrive());
+
+  uint8_t buf[13] = {0xF0, 0x88, 0x00};
+  memset(buf + 3, 0xFF, 10);
+  TEST_ASSERT_TRUE(ds->block(buf, sizeof(buf)));
+  TEST_ASSERT_TRUE(DS2484::check_crc16(buf, 11, &buf[11]));
+
+  // the reset is done at standard speed, which brings everything back to standard speed.
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  TEST_ASSERT_FALSE(sim->isOverdriveSpeed());
+  TEST_ASSERT_FALSE(sw->isOverdrive());
+}
+
+void test_strong_pullup(void) {
+  auto sensor = addSensor(1);
+  ds->begin();
+
+  TEST_ASSERT_EQUAL(1, ds->reset());
+  ds->select(sensor->rom);
+  TEST_ASSERT_TRUE(ds->writeStrongPullup(0x44));
+  TEST_ASSERT_TRUE(sensor->isConverting());
+  TEST_ASSERT_TRUE(bus->isStrongPullup());
+
+  ds->endStrongPullup();
+  TEST_ASSERT_FALSE(bus->isStrongPullup());
+  TEST_ASSERT_EQUAL_HEX8(DS2484_CONFIG_APU, sim->getConfig());
+
+  // the next 1-Wire command ends it as well.
+  ds->reset();
+  ds->select(sensor->rom);
+  ds->writeStrongPullup(0x44);
+  ds->reset();
+  TEST_ASSERT_FALSE(bus->isStrongPullup());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin);
+  RUN_TEST(test_begin_without_ds2484);
+  RUN_TEST(test_reset_status);
+  RUN_TEST(test_disconnected_times_out);
+  RUN_TEST(test_search_finds_all_devices);
+  RUN_TEST(test_triplet_search_bus_time);
+  RUN_TEST(test_search_on_empty_bus);
+  RUN_TEST(test_read_write);
+  RUN_TEST(test_verifier_stops_after_failed_crc);
+  RUN_TEST(test_overdrive_select);
+  RUN_TEST(test_strong_pullup);
+  return UNITY_END();
+}
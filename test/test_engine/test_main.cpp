@@ -0,0 +1,242 @@
+#include <DS2480B.h>
+#include <SimDevices.h>
+#include <unity.h>
+#include "actuators.h"
+#include "ds18x20.h"
+#include "ds2408.h"
+#include "onewire.h"
+#include "onewireengine.h"
+
+// OneWireEngine against a simulated bus: the reset/select/write/read/CRC sequences of the transaction
+// descriptors, their retries, custom operations, the completions and the actuator writes.
+
+static SimBus *bus;
+static SimDS2480B *sim;
+static OneWireMaster *ds;
+static OneWireEngine *engine;
+static std::vector<SimDevice *> devices;
+static OneWireTransaction done;
+static uint8_t completions;
+
+static const uint8_t readScratchpadCommand[] = {READ_SCRATCHPAD};
+static const uint8_t readRegistersCommand[] = {READ_PIO_REGISTERS, PIO_LOGIC_STATE_REGISTER, 0x00};
+
+template <typename T>
+static T *addDevice(uint8_t family, uint64_t serial) {
+  uint8_t rom[8];
+  SimDevice::makeRom(family, serial, rom);
+  auto device = new T(rom);
+  devices.push_back(device);
+  bus->attach(device);
+
+  onewireNode node;
+  populateNode(node, rom);
+  oneWireNodes.push_back(node);
+  indexNodes();
+  return device;
+}
+
+static void onComplete(OneWireTransaction &txn) {
+  done = txn;
+  completions++;
+}
+
+// Run the queued transactions and deliver their completions.
+static void run() {
+  engine->waitUntilIdle();
+  engine->dispatchCompletions();
+}
+
+void setUp(void) {
+  native::clock() = 0;
+  bus = new SimBus();
+  sim = new SimDS2480B(*bus);
+
+  auto master = new DS2480B(*sim);
+  master->begin();
+  master->negotiateBaudRate();
+  ds = master;
+
+  engine = new OneWireEngine(*ds);
+  engine->begin();
+  done = OneWireTransaction();
+  completions = 0;
+}
+
+void tearDown(void) {
+  native::deleteTasks();
+  delete engine;
+  delete ds;
+  delete sim;
+  delete bus;
+  for (auto device : devices) delete device;
+  devices.clear();
+  oneWireNodes.clear();
+  indexNodes();
+}
+
+void test_descriptor_crc8(void) {
+  auto sensor = addDevice<SimDS18x20>(DS18B20, 1);
+  sensor->setTemperature(21.5);
+  auto &node = oneWireNodes[0];
+  startConversion(*ds, node.id);
+  delay(750);
+
+  TEST_ASSERT_TRUE(engine->submit(node.id, TXN_RESET | TXN_SELECT | TXN_CRC8, readScratchpadCommand, 1, 9, onComplete));
+  TEST_ASSERT_FALSE(engine->isIdle());
+  run();
+
+  TEST_ASSERT_EQUAL_UINT8(1, completions);
+  TEST_ASSERT_TRUE(done.success);
+  TEST_ASSERT_EQUAL_HEX8(READ_SCRATCHPAD, done.data[0]);
+  TEST_ASSERT_EQUAL_INT(344, scratchpadToRaw(DS18B20, done.data + 1));
+  TEST_ASSERT_EQUAL_UINT32(1, node.success);
+  TEST_ASSERT_EQUAL_UINT32(0, node.errors);
+}
+
+void test_descriptor_crc16(void) {
+  auto board = addDevice<SimDS2408>(DS2408, 1);
+  board->setInputs(0x5A);
+  auto &node = oneWireNodes[0];
+
+  TEST_ASSERT_TRUE(engine->submit(node.id, TXN_RESET | TXN_SELECT | TXN_CRC16, readRegistersCommand, 3, 10, onComplete));
+  run();
+
+  TEST_ASSERT_TRUE(done.success);
+  TEST_ASSERT_EQUAL_HEX8(0x5A, done.data[3]);  // PIO logic state
+}
+
+void test_descriptor_skip(void) {
+  addDevice<SimDS18x20>(DS18B20, 1)->setTemperature(-3);
+  startConversion(*ds, oneWireNodes[0].id);
+  delay(750);
+
+  uint8_t none[8] = {};
+  TEST_ASSERT_TRUE(engine->submit(none, TXN_RESET | TXN_SKIP | TXN_CRC8, readScratchpadCommand, 1, 9, onComplete));
+  run();
+
+  TEST_ASSERT_TRUE(done.success);
+  TEST_ASSERT_EQUAL_INT(-48, scratchpadToRaw(DS18B20, done.data + 1));
+}
+
+void test_descriptor_retries_crc_error(void) {
+  addDevice<SimDS18x20>(DS18B20, 1)->setTemperature(19);
+  auto &node = oneWireNodes[0];
+  startConversion(*ds, node.id);
+  delay(750);
+
+  sim->corruptNext(1);
+  TEST_ASSERT_TRUE(engine->submit(node.id, TXN_RESET | TXN_SELECT | TXN_CRC8, readScratchpadCommand, 1, 9, onComplete));
+  run();
+
+  TEST_ASSERT_TRUE(done.success);
+  TEST_ASSERT_EQUAL_INT(19 * 16, scratchpadToRaw(DS18B20, done.data + 1));
+  TEST_ASSERT_EQUAL_UINT32(1, node.errors);
+  TEST_ASSERT_EQUAL_UINT32(1, node.success);
+}
+
+void test_descriptor_gives_up(void) {
+  addDevice<SimDS2408>(DS2408, 1);
+  auto &node = oneWireNodes[0];
+
+  // every read is corrupted, the first try and each retry fail.
+  sim->corruptNext(1000);
+  TEST_ASSERT_TRUE(engine->submit(node.id, TXN_RESET | TXN_SELECT | TXN_CRC16, readRegistersCommand, 3, 10, onComplete));
+  run();
+  TEST_ASSERT_FALSE(done.success);
+  TEST_ASSERT_EQUAL_UINT32(MAX_CONSECUTIVE_RETRIES + 1, node.errors);
+}
+
+void test_descriptor_no_presence(void) {
+  uint8_t rom[8];
+  SimDevice::makeRom(DS18B20, 1, rom);
+
+  // no retries when nothing answers the reset.
+  TEST_ASSERT_TRUE(engine->submit(rom, TXN_RESET | TXN_SELECT | TXN_CRC8, readScratchpadCommand, 1, 9, onComplete));
+  run();
+  TEST_ASSERT_FALSE(done.success);
+  TEST_ASSERT_EQUAL(ONEWIRE_NO_PRESENCE, done.status);
+}
+
+void test_descriptor_too_long(void) {
+  uint8_t rom[8] = {};
+  uint8_t data[ONEWIRE_TXN_DATA_SIZE] = {};
+  TEST_ASSERT_FALSE(engine->submit(rom, TXN_RESET | TXN_SKIP, data, ONEWIRE_TXN_DATA_SIZE, 1, onComplete));
+  TEST_ASSERT_TRUE(engine->isIdle());
+}
+
+void test_operation(void) {
+  addDevice<SimDS18x20>(DS18B20, 1)->setTemperature(25);
+  auto &node = oneWireNodes[0];
+  onewireNode *found = nullptr;
+
+  TEST_ASSERT_TRUE(engine->submit(node.id, [&found](OneWireMaster &ds, onewireNode *node, OneWireTransaction &txn) {
+    found = node;
+    txn.result = 42;
+    return true;
+  }, onComplete));
+  run();
+
+  TEST_ASSERT_EQUAL_PTR(&node, found);
+  TEST_ASSERT_TRUE(done.success);
+  TEST_ASSERT_EQUAL_INT(42, done.result);
+}
+
+void test_urgent_first(void) {
+  uint8_t order[3] = {};
+  uint8_t count = 0;
+
+  for (uint8_t i = 1; i <= 2; i++) {
+    engine->submit(nullptr, [&order, &count, i](OneWireMaster &, onewireNode *, OneWireTransaction &) {
+      order[count++] = i;
+      return true;
+    });
+  }
+  engine->submit(nullptr, [&order, &count](OneWireMaster &, onewireNode *, OneWireTransaction &) {
+    order[count++] = 3;
+    return true;
+  }, nullptr, true);
+  run();
+
+  TEST_ASSERT_EQUAL_UINT8(3, count);
+  TEST_ASSERT_EQUAL_UINT8(3, order[0]);
+  TEST_ASSERT_EQUAL_UINT8(1, order[1]);
+  TEST_ASSERT_EQUAL_UINT8(2, order[2]);
+}
+
+void test_actuator_plans_kept(void) {
+  auto board = addDevice<SimDS2408>(DS2408, 1);
+  addDevice<SimDS18x20>(DS18B20, 2);
+  memcpy(oneWireNodes[1].actuatorId, oneWireNodes[0].id, 8);
+  oneWireNodes[1].actuatorPin = 3;
+
+  ActuatorManager actuators;
+  actuators.begin(*engine, 0);
+  actuators.indexBindings(oneWireNodes);
+  TEST_ASSERT_TRUE(actuators.planPin(oneWireNodes[0].id, 3, true));
+
+  // a binding changed before the end of the cycle doesn't lose the plan.
+  oneWireNodes[1].actuatorPin = 4;
+  actuators.indexBindings(oneWireNodes);
+  TEST_ASSERT_EQUAL_UINT8(1, actuators.flush(oneWireNodes, onComplete));
+  run();
+
+  TEST_ASSERT_TRUE(done.success);
+  TEST_ASSERT_EQUAL_HEX8(0x08, oneWireNodes[0].pinStates);
+  TEST_ASSERT_EQUAL_HEX8((uint8_t)~0x08, board->getLatch());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_descriptor_crc8);
+  RUN_TEST(test_descriptor_crc16);
+  RUN_TEST(test_descriptor_skip);
+  RUN_TEST(test_descriptor_retries_crc_error);
+  RUN_TEST(test_descriptor_gives_up);
+  RUN_TEST(test_descriptor_no_presence);
+  RUN_TEST(test_descriptor_too_long);
+  RUN_TEST(test_operation);
+  RUN_TEST(test_urgent_first);
+  RUN_TEST(test_actuator_plans_kept);
+  return UNITY_END();
+}
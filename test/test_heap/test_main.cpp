@@ -0,0 +1,258 @@
+#define TINYOWC_HEAP_STATS
+#include <DS2480B.h>
+#include <SimDevices.h>
+#include <string>
+#include <unity.h>
+#include "actuators.h"
+#include "ds18x20.h"
+#include "ds2408.h"
+#include "ds2423.h"
+#include "ds2450.h"
+#include "heapstats.h"
+#include "lineprotocol.h"
+#include "onewire.h"
+#include "onewireengine.h"
+#include "sampling.h"
+#include "switches.h"
+
+// Heap allocations of a sampling cycle (src/heapstats.h), against a simulated bus with every family.
+// The cycle is queued on the engine as actOnSensors() in main.cpp does, with the sample hooks and
+// completions of sampling.h. pushChanges() formats the point of the node instead of sending it.
+
+static SimBus *bus;
+static SimDS2480B *sim;
+static OneWireMaster *ds;
+static OneWireEngine *engine;
+static ActuatorManager actuators;
+static std::vector<SimDevice *> devices;
+static SimDS18x20 *sensors[4];
+static InfluxLine line;
+static bool conversionDone;
+static bool cycleDone;
+static uint16_t pushed;
+
+template <typename T>
+static T *addDevice(uint8_t family, uint64_t serial) {
+  uint8_t rom[8];
+  SimDevice::makeRom(family, serial, rom);
+  auto device = new T(rom);
+  devices.push_back(device);
+  bus->attach(device);
+
+  onewireNode node;
+  populateNode(node, rom);
+  setNodeName(node, "boiler room");
+  oneWireNodes.push_back(node);
+  return device;
+}
+
+// The first three sensors drive pin 0 of the DS2408, the DS2413 and the DS2406.
+static void bindSensor(onewireNode &sensor, const onewireNode &actuator) {
+  memcpy(sensor.actuatorId, actuator.id, 8);
+  sensor.actuatorPin = 0;
+  sensor.lowLimit = 21;
+  sensor.highLimit = 25;
+}
+
+void setUp(void) {
+  native::clock() = 0;
+  bus = new SimBus();
+  sim = new SimDS2480B(*bus);
+
+  auto master = new DS2480B(*sim);
+  master->begin();
+  master->negotiateBaudRate();
+  ds = master;
+
+  for (uint8_t i = 0; i < 4; i++) {
+    sensors[i] = addDevice<SimDS18x20>(DS18B20, 10 + i);
+    sensors[i]->setTemperature(20 + i);
+  }
+  addDevice<SimDS2408>(DS2408, 20);
+  addDevice<SimDS2413>(DS2413, 21);
+  addDevice<SimDS2406>(DS2406, 22);
+  addDevice<SimDS2423>(DS2423, 23)->setCounter(0, 1000);
+  addDevice<SimDS2450>(DS2450, 24)->setInput(0, 1.5);
+
+  for (uint8_t i = 0; i < 3; i++) {
+    bindSensor(oneWireNodes[i], oneWireNodes[4 + i]);
+  }
+  counterState(oneWireNodes[7]).unitsPerPulse[0] = 0.001;
+  indexNodes();
+  TEST_ASSERT_TRUE(configureDS2450(*ds, oneWireNodes[8]));
+
+  engine = new OneWireEngine(*ds);
+  engine->begin();
+  actuators.begin(*engine, 0);
+  actuators.indexBindings(oneWireNodes);
+  beginSampling(engine, &actuators, 1);
+  engine->reserve(oneWireNodes.size() + 6);
+}
+
+void tearDown(void) {
+  native::deleteTasks();
+  delete engine;
+  delete ds;
+  delete sim;
+  delete bus;
+  for (auto device : devices) delete device;
+  devices.clear();
+  oneWireNodes.clear();
+  indexNodes();
+}
+
+// Run the queued transactions and their completions, until nothing more is queued.
+static void runEngine() {
+  do {
+    engine->waitUntilIdle();
+    engine->dispatchCompletions();
+  } while (!engine->isIdle());
+}
+
+void pushChanges(onewireNode &node) {
+  auto &family = deviceFamily(node.familyId);
+  auto addFields = family.has(FAMILY_TEMPERATURE) ? addTemperatureFields
+                 : family.has(FAMILY_SWITCH) ? addSwitchFields
+                 : family.has(FAMILY_COUNTER) ? addCounterFields
+                 : addVoltageFields;
+  TEST_ASSERT_TRUE(formatInfluxLine(line, node, family.name, addFields));
+  node.millisWhenLastPush = millis();
+  pushed++;
+}
+
+// The sample hooks of the families, as in familyHookTable.
+static const struct {
+  uint8_t familyId;
+  void (*sample)(onewireNode &node, unsigned long currentMillis);
+} hooks[] = {
+  {DS18B20, sampleTemperature},
+  {DS2408, sampleSwitch},
+  {DS2413, sampleSwitch},
+  {DS2406, sampleSwitch},
+  {DS2423, sampleCounter},
+  {DS2450, sampleVoltages},
+};
+
+// One cycle: the conversion, the conditional search, a reading per node and the actuator writes planned meanwhile.
+static void sampleCycle() {
+  uint16_t time = DS18B20_12BIT_TIME;
+  bool parasitePowered = false;
+
+  conversionDone = false;
+  cycleDone = false;
+  TEST_ASSERT_TRUE(engine->submit(nullptr, [time, parasitePowered](OneWireMaster &ds, onewireNode *, OneWireTransaction &) {
+    return convertTemperatures(ds, time, parasitePowered);
+  }, [](OneWireTransaction &txn) {
+    conversionDone = txn.success;
+  }));
+  runEngine();
+  TEST_ASSERT_TRUE(conversionDone);
+
+  uint8_t busIndex = 0;
+  engine->submit(nullptr, [busIndex](OneWireMaster &ds, onewireNode *, OneWireTransaction &) {
+    if (findActiveBoards(ds)) return true;
+
+    for (auto &node : oneWireNodes) {
+      if (node.familyId == DS2408 && node.bus == busIndex) node.alarming = true;
+    }
+    return false;
+  });
+  auto currentMillis = millis();
+  for (auto &node : oneWireNodes) {
+    for (auto &hook : hooks) {
+      if (hook.familyId == node.familyId) hook.sample(node, currentMillis);
+    }
+  }
+  engine->submit(nullptr, [](OneWireMaster &, onewireNode *, OneWireTransaction &) {
+    return true;
+  }, [](OneWireTransaction &) {
+    flushActuators();
+    cycleDone = true;
+  });
+  runEngine();
+  TEST_ASSERT_TRUE(cycleDone);
+}
+
+// The bound sensors fall below and rise above their limits every other cycle, switching the actuators.
+static void setTemperatures(uint32_t cycle) {
+  for (uint8_t i = 0; i < 3; i++) {
+    sensors[i]->setTemperature(cycle & 0x01 ? 30 : 18);
+  }
+}
+
+void test_probe_counts(void) {
+  HeapProbe probe;
+  probe.begin();
+  std::string text(100, 'x');
+  TEST_ASSERT_TRUE(probe.allocations() >= 1);
+}
+
+void test_steady_cycle(void) {
+  // the first cycle may set up state, e.g. the switches get their first write.
+  setTemperatures(0);
+  sampleCycle();
+  for (uint8_t i = 4; i < 7; i++) {
+    TEST_ASSERT_EQUAL_HEX8(0x01, oneWireNodes[i].pinStates);
+  }
+
+  HeapProbe probe;
+  probe.begin();
+  pushed = 0;
+  for (uint32_t cycle = 1; cycle <= 3; cycle++) {
+    setTemperatures(cycle);
+    sampleCycle();
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, probe.allocations());
+
+  // the bound sensors, the counter and the DS2450 read each cycle, and the three switches written. The
+  // temperature of the fourth sensor doesn't change, it isn't pushed.
+  TEST_ASSERT_EQUAL_UINT16(3 * 5 + 3 * 3, pushed);
+  for (uint8_t i = 4; i < 7; i++) {
+    TEST_ASSERT_EQUAL_HEX8(0x00, oneWireNodes[i].pinStates);
+  }
+  for (auto &node : oneWireNodes) {
+    TEST_ASSERT_EQUAL_UINT32(0, node.errors);
+  }
+}
+
+void test_influx_line(void) {
+  auto &node = oneWireNodes[0];
+  node.temperature = 21.5;
+
+  TEST_ASSERT_TRUE(formatInfluxLine(line, node, "temperature", addTemperatureFields));
+  std::string expected = std::string("temperature,device_id=") + node.idStr + ",device_name=boiler\\ room value=21.50";
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), line.c_str());
+
+  auto &counter = oneWireNodes[7];
+  counter.counters[0] = 1200;
+  TEST_ASSERT_TRUE(formatInfluxLine(line, counter, "counters", addCounterFields));
+  TEST_ASSERT_NOT_NULL(strstr(line.c_str(), " counter0=1200i,counter1=0i,rate0=0.00,rate1=0.00"));
+  TEST_ASSERT_NOT_NULL(strstr(line.c_str(), ",amountRate0=0.00"));
+
+  // no fields, or cut at the end of the buffer, isn't a point.
+  TEST_ASSERT_FALSE(formatInfluxLine(line, node, "temperature", nullptr));
+  line.begin("long");
+  std::string name(INFLUX_LINE_SIZE, 'x');
+  line.addTag("device_name", name.c_str());
+  line.addFloat("value", 1);
+  TEST_ASSERT_FALSE(line.valid());
+}
+
+void test_pin_states(void) {
+  char pins[8 + 1];
+  formatPinStates(0x05, pins);
+  TEST_ASSERT_EQUAL_STRING("101", pins);
+  formatPinStates(0x00, pins);
+  TEST_ASSERT_EQUAL_STRING("0", pins);
+  formatPinStates(0xFF, pins);
+  TEST_ASSERT_EQUAL_STRING("11111111", pins);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_probe_counts);
+  RUN_TEST(test_steady_cycle);
+  RUN_TEST(test_influx_line);
+  RUN_TEST(test_pin_states);
+  return UNITY_END();
+}
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <unity.h>
+#include "onewire.h"
+
+// Layout and lookup of onewireNode (src/onewire.h), a node is copied and found without heap allocations.
+
+static uint32_t allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  if (void *p = malloc(size)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static void addNodes(std::vector<onewireNode> &nodes, uint16_t count) {
+  for (uint16_t i = 0; i < count; i++) {
+    uint8_t rom[8] = {DS18B20, (uint8_t)i, (uint8_t)(i >> 8), 0, 0, 0, 0, 0};
+    onewireNode node;
+    populateNode(node, rom);
+    setNodeName(node, "bedroom");
+    nodes.push_back(node);
+  }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {
+  oneWireNodes.clear();
+  scannedOneWireNodes.clear();
+  indexNodes();
+  counterStates.clear();
+  analogStates.clear();
+}
+
+void test_node_size(void) {
+  // two cache lines, the DS2423 and DS2450 state is kept in counterStates and analogStates.
+  TEST_ASSERT_TRUE(sizeof(onewireNode) <= 128);
+  TEST_ASSERT_TRUE(sizeof(PulseCounter) <= 96);
+  // the state of a sampling cycle comes before the configuration.
+  // measured on an instance, offsetof isn't defined for onewireNode, it isn't standard layout.
+  onewireNode node;
+  auto offset = reinterpret_cast<const char *>(&node.idStr) - reinterpret_cast<const char *>(&node);
+  TEST_ASSERT_TRUE(offset <= 2 * 64);
+}
+
+void test_family_state(void) {
+  uint8_t rom[8] = {DS2423, 1, 0, 0, 0, 0, 0, 0};
+  addNodes(oneWireNodes, 2);
+  onewireNode node;
+  populateNode(node, rom);
+  oneWireNodes.push_back(node);
+  indexNodes();
+
+  // only the counter gets an entry, copies of its node share it.
+  TEST_ASSERT_EQUAL_UINT32(1, counterStates.size());
+  TEST_ASSERT_EQUAL_UINT32(0, analogStates.size());
+  TEST_ASSERT_EQUAL_UINT8(NO_FAMILY_STATE, oneWireNodes[0].familyState);
+  counterState(oneWireNodes[2]).unitsPerPulse[0] = 0.001f;
+  TEST_ASSERT_EQUAL_FLOAT(0.001f, counterState(node).unitsPerPulse[0]);
+
+  // a const node without an entry reads zeros and adds none.
+  const onewireNode &other = oneWireNodes[1];
+  TEST_ASSERT_EQUAL_FLOAT(0, analogState(other).voltages[0]);
+  TEST_ASSERT_EQUAL_UINT32(0, analogStates.size());
+
+  // found again after the vectors are rebuilt.
+  oneWireNodes.erase(oneWireNodes.begin());
+  indexNodes();
+  TEST_ASSERT_EQUAL_UINT32(1, counterStates.size());
+  TEST_ASSERT_EQUAL_FLOAT(0.001f, counterState(oneWireNodes[1]).unitsPerPulse[0]);
+}
+
+void test_populate_node(void) {
+  onewireNode node;
+  uint8_t rom[8] = {0x28, 0xEE, 0xA8, 0x9B, 0x19, 0x16, 0x02, 0x62};
+
+  allocations = 0;
+  populateNode(node, rom);
+  TEST_ASSERT_EQUAL_UINT32(0, allocations);
+
+  TEST_ASSERT_EQUAL_STRING("28.EEA89B19160262", node.idStr);
+  TEST_ASSERT_TRUE(node.rom == romKey(rom));
+  TEST_ASSERT_EQUAL_HEX8(0x62, node.id[7]);
+}
+
+void test_node_name(void) {
+  onewireNode node;
+
+  setNodeName(node, "a name longer than twenty characters");
+  TEST_ASSERT_EQUAL_STRING("a name longer than t", node.name);
+  setNodeName(node, nullptr);
+  TEST_ASSERT_EQUAL_STRING("", node.name);
+}
+
+void test_pin_states(void) {
+  onewireNode node;
+
+  bitSet(node.pinStates, 0);
+  bitSet(node.pinStates, 7);
+  TEST_ASSERT_EQUAL_HEX8(0x81, node.pinStates);
+  TEST_ASSERT_TRUE(bitRead(node.pinStates, 7));
+}
+
+void test_copy_counts(void) {
+  addNodes(scannedOneWireNodes, 200);
+
+  // one allocation for the vector, none for the nodes.
+  allocations = 0;
+  oneWireNodes = scannedOneWireNodes;
+  TEST_ASSERT_EQUAL_UINT32(1, allocations);
+
+  // and none at all once the capacity is there, e.g. after a rescan.
+  allocations = 0;
+  oneWireNodes = scannedOneWireNodes;
+  onewireNode copy = oneWireNodes[100];
+  TEST_ASSERT_EQUAL_UINT32(0, allocations);
+  TEST_ASSERT_EQUAL_STRING("bedroom", copy.name);
+}
+
+void test_get_node(void) {
+  addNodes(oneWireNodes, 10);
+  uint8_t rom[8] = {DS18B20, 7, 0, 0, 0, 0, 0, 0};
+
+  // the index is authoritative, nodes aren't found before it's built.
+  TEST_ASSERT_NULL(getOneWireNode(rom));
+  indexNodes();
+  auto node = getOneWireNode(rom);
+  TEST_ASSERT_NOT_NULL(node);
+  TEST_ASSERT_EQUAL_HEX8(7, node->id[1]);
+
+  rom[7] = 1;
+  TEST_ASSERT_NULL(getOneWireNode(rom));
+}
+
+void test_node_index(void) {
+  addNodes(oneWireNodes, 200);
+  indexNodes();
+
+  allocations = 0;
+  for (auto &node : oneWireNodes) {
+    TEST_ASSERT_EQUAL_PTR(&node, getOneWireNode(node.id));
+    TEST_ASSERT_EQUAL_PTR(&node, getOneWireNode(node.idStr));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, allocations);
+  uint8_t missing[8] = {DS18B20, 0xC8, 0, 0, 0, 0, 0, 0};
+  TEST_ASSERT_NULL(getOneWireNode(missing));
+
+  // a changed setting doesn't move the node.
+  setNodeName(oneWireNodes[5], "kitchen");
+  TEST_ASSERT_EQUAL_STRING("kitchen", getOneWireNode(oneWireNodes[5].id)->name);
+
+  // a list replaced in the same storage gives the right nodes once indexed again.
+  std::reverse(oneWireNodes.begin(), oneWireNodes.end());
+  oneWireNodes.pop_back();
+  indexNodes();
+  for (auto &node : oneWireNodes) {
+    TEST_ASSERT_EQUAL_PTR(&node, getOneWireNode(node.id));
+  }
+  uint8_t removed[8] = {DS18B20, 0, 0, 0, 0, 0, 0, 0};
+  TEST_ASSERT_NULL(getOneWireNode(removed));
+}
+
+void test_parse_id(void) {
+  uint8_t addr[8] = {};
+  uint8_t expected[8] = {0x29, 0x29, 0xE1, 0x03, 0x00, 0x00, 0x00, 0x9C};
+
+  allocations = 0;
+  TEST_ASSERT_TRUE(parseId("29.29E1030000009C", addr));
+  TEST_ASSERT_EQUAL_UINT32(0, allocations);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, addr, 8);
+  TEST_ASSERT_TRUE(parseId("29.29e1030000009c", addr));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, addr, 8);
+
+  // anything else leaves the address as it was.
+  uint8_t before[8];
+  memcpy(before, addr, 8);
+  TEST_ASSERT_FALSE(parseId("29.29E1030000009", addr));
+  TEST_ASSERT_FALSE(parseId("29.29E1030000009C0", addr));
+  TEST_ASSERT_FALSE(parseId("2929E1030000009C0", addr));
+  TEST_ASSERT_FALSE(parseId("29.29G1030000009C", addr));
+  TEST_ASSERT_FALSE(parseId("", addr));
+  TEST_ASSERT_FALSE(parseId(nullptr, addr));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(before, addr, 8);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_node_size);
+  RUN_TEST(test_family_state);
+  RUN_TEST(test_populate_node);
+  RUN_TEST(test_node_name);
+  RUN_TEST(test_pin_states);
+  RUN_TEST(test_copy_counts);
+  RUN_TEST(test_get_node);
+  RUN_TEST(test_node_index);
+  RUN_TEST(test_parse_id);
+  return UNITY_END();
+}